@@ -0,0 +1,122 @@
+// Serializes a chat request with a ~200 KB conversation through JsonWriter and through an
+// nlohmann::json DOM, and prints the time per request of both.
+//
+// Usage: json_writer_bench [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "JsonWriter.h"
+#include "json.hpp"
+
+namespace {
+
+struct BenchMessage {
+    std::string role;
+    std::string content;
+};
+
+// 40 messages of about 5 KB: prose with quotes, backslashes, newlines, tabs and non-ASCII text,
+// the characters the escaping has to handle.
+std::vector<BenchMessage> makeConversation() {
+    const std::string paragraph =
+        "The \"quick\" brown fox jumps over the lazy dog.\n"
+        "Path: C:\\Users\\fox\\notes.txt\tcolumn 2\n"
+        "Unicode: naïve café, 中文字符, emoji 🦊\n"
+        "Code: if (a < b && c > d) { return \"x\"; }\n";
+    std::vector<BenchMessage> messages;
+    for (int i = 0; i < 40; ++i) {
+        BenchMessage msg{i % 2 == 0 ? "user" : "assistant", ""};
+        while (msg.content.size() < 5000) {
+            msg.content += paragraph;
+        }
+        messages.push_back(std::move(msg));
+    }
+    return messages;
+}
+
+std::string serializeWithWriter(const std::vector<BenchMessage>& messages) {
+    size_t content_bytes = 0;
+    for (const auto& msg : messages) {
+        content_bytes += msg.content.size();
+    }
+    std::string body;
+    body.reserve(content_bytes + 512);
+    JsonWriter writer(body);
+    writer.beginObject();
+    writer.key("model");
+    writer.value("gpt-4o");
+    writer.key("messages");
+    writer.beginArray();
+    for (const auto& msg : messages) {
+        writer.beginObject();
+        writer.key("role");
+        writer.value(msg.role);
+        writer.key("content");
+        writer.value(msg.content);
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.key("temperature");
+    writer.value(0.7);
+    writer.key("stream");
+    writer.value(true);
+    writer.endObject();
+    return body;
+}
+
+std::string serializeWithDom(const std::vector<BenchMessage>& messages) {
+    nlohmann::json body;
+    body["model"] = "gpt-4o";
+    body["messages"] = nlohmann::json::array();
+    for (const auto& msg : messages) {
+        body["messages"].push_back({{"role", msg.role}, {"content", msg.content}});
+    }
+    body["temperature"] = 0.7;
+    body["stream"] = true;
+    return body.dump();
+}
+
+// Median microseconds per call of `serialize` over `iterations` calls.
+template <typename Serialize>
+double medianMicroseconds(size_t iterations, Serialize serialize, size_t& checksum) {
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    for (size_t i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        std::string body = serialize();
+        samples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        checksum += body.size();
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+    if (iterations == 0) {
+        std::cerr << "Usage: json_writer_bench [iterations]" << std::endl;
+        return 1;
+    }
+    std::vector<BenchMessage> messages = makeConversation();
+    std::string writer_body = serializeWithWriter(messages);
+    if (nlohmann::json::parse(writer_body) != nlohmann::json::parse(serializeWithDom(messages))) {
+        std::cerr << "Error: JsonWriter and nlohmann::json produced different documents." << std::endl;
+        return 1;
+    }
+
+    size_t checksum = 0;
+    double dom_us = medianMicroseconds(iterations, [&]() { return serializeWithDom(messages); }, checksum);
+    double writer_us = medianMicroseconds(iterations, [&]() { return serializeWithWriter(messages); }, checksum);
+    double megabytes = static_cast<double>(writer_body.size()) / (1024.0 * 1024.0);
+    std::cout << "Request body: " << messages.size() << " messages, " << writer_body.size() << " bytes; median of " << iterations << " runs" << std::endl;
+    std::cout << "nlohmann::json DOM + dump: " << dom_us << " us (" << megabytes / (dom_us / 1e6) << " MB/s)" << std::endl;
+    std::cout << "JsonWriter:                " << writer_us << " us (" << megabytes / (writer_us / 1e6) << " MB/s)" << std::endl;
+    std::cout << "Speedup: " << dom_us / writer_us << "x (checksum " << checksum << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,131 @@
+// Times the ProviderTraits helpers for every provider: encoding a conversation, serializing the
+// sampling parameters, and reading usage, text and the end marker from streamed events. Stream text
+// is also read through a braced JsonPath built at the call site, for comparison with the constexpr
+// trait paths. Prints the best of several runs in nanoseconds per call.
+//
+// Usage: provider_traits_bench [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "JsonExtractor.h"
+#include "JsonWriter.h"
+#include "ProviderTraits.h"
+
+namespace {
+
+constexpr int kRuns = 7;
+
+// Best-of-kRuns nanoseconds per call of `f`, which returns a value folded into `sink`.
+template <typename F>
+double bestNanoseconds(size_t iterations, F f, size_t& sink) {
+    double best = 0.0;
+    for (int run = 0; run < kRuns; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            sink += f();
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / static_cast<double>(iterations);
+        best = run == 0 ? ns : std::min(best, ns);
+    }
+    return best;
+}
+
+void report(const char* name, double ns) {
+    std::printf("%-36s %10.1f ns\n", name, ns);
+}
+
+// 40 short turns alternating user and assistant, after a system message.
+std::vector<Message> makeConversation() {
+    std::vector<Message> messages = {{"system", "You are a helpful assistant. Answer briefly."}};
+    for (int i = 0; i < 40; ++i) {
+        messages.push_back({i % 2 == 0 ? "user" : "assistant", "Turn " + std::to_string(i) + ": the \"quick\" brown fox jumps over the lazy dog.\n"});
+    }
+    return messages;
+}
+
+template <typename Traits>
+size_t encodeConversation(const std::vector<Message>& messages) {
+    std::string body;
+    body.reserve(4096);
+    JsonWriter writer(body);
+    writer.beginArray();
+    for (const auto& msg : messages) {
+        ProviderTraits::encodeMessage<Traits>(writer, msg);
+    }
+    writer.endArray();
+    return body.size();
+}
+
+template <typename Traits>
+size_t serializeParams(const GenerationParams& params) {
+    std::string body;
+    JsonWriter writer(body);
+    writer.beginObject();
+    ProviderTraits::writeSamplingParams<Traits>(writer, params);
+    writer.endObject();
+    return body.size();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    if (iterations == 0) {
+        std::fprintf(stderr, "Usage: provider_traits_bench [iterations]\n");
+        return 1;
+    }
+    using namespace ProviderTraits;
+    size_t sink = 0;
+
+    const std::vector<Message> messages = makeConversation();
+    const size_t encode_iterations = std::max<size_t>(iterations / 50, 1);
+    std::printf("Encoding %zu messages (ns per conversation):\n", messages.size());
+    report("  openai chat", bestNanoseconds(encode_iterations, [&] { return encodeConversation<OpenAIChat>(messages); }, sink));
+    report("  gemini", bestNanoseconds(encode_iterations, [&] { return encodeConversation<Gemini>(messages); }, sink));
+    report("  ollama", bestNanoseconds(encode_iterations, [&] { return encodeConversation<Ollama>(messages); }, sink));
+    report("  llama.cpp", bestNanoseconds(encode_iterations, [&] { return encodeConversation<LlamaCpp>(messages); }, sink));
+
+    GenerationParams params;
+    params.temperature = 0.7;
+    params.top_p = 0.9;
+    params.top_k = 40;
+    params.max_tokens = 512;
+    params.seed = 42;
+    params.presence_penalty = 0.1;
+    params.frequency_penalty = 0.2;
+    params.stop = {"###", "END"};
+    std::printf("Sampling parameters:\n");
+    report("  openai chat", bestNanoseconds(iterations, [&] { return serializeParams<OpenAIChat>(params); }, sink));
+    report("  openai responses", bestNanoseconds(iterations, [&] { return serializeParams<OpenAIResponses>(params); }, sink));
+    report("  gemini", bestNanoseconds(iterations, [&] { return serializeParams<Gemini>(params); }, sink));
+    report("  ollama", bestNanoseconds(iterations, [&] { return serializeParams<Ollama>(params); }, sink));
+    report("  llama.cpp", bestNanoseconds(iterations, [&] { return serializeParams<LlamaCpp>(params); }, sink));
+
+    const std::string chunk = R"({"id":"chatcmpl-1","object":"chat.completion.chunk","created":1,"model":"gpt","choices":[{"index":0,"delta":{"content":"Hello there"},"finish_reason":null}],"usage":null})";
+    const std::string final_chunk = R"({"id":"chatcmpl-1","object":"chat.completion.chunk","created":1,"model":"gpt","choices":[],"usage":{"prompt_tokens":120,"completion_tokens":40,"total_tokens":160,"prompt_tokens_details":{"cached_tokens":64}}})";
+    const std::string gemini = R"({"candidates":[{"content":{"parts":[{"text":"Hello"}],"role":"model"},"finishReason":"STOP","index":0}],"usageMetadata":{"promptTokenCount":120,"candidatesTokenCount":40,"totalTokenCount":160,"cachedContentTokenCount":64},"modelVersion":"gemini"})";
+    const std::string ndjson = R"({"model":"llama3.2","created_at":"2024-01-01T00:00:00Z","message":{"role":"assistant","content":" world"},"done":false})";
+    const std::string ndjson_final = R"({"model":"llama3.2","created_at":"2024-01-01T00:00:00Z","message":{"role":"assistant","content":""},"done":true,"prompt_eval_count":26,"eval_count":290})";
+
+    const size_t event_iterations = iterations * 5;
+    std::printf("Stream events:\n");
+    report("  openai usage (delta chunk)", bestNanoseconds(event_iterations, [&] { return static_cast<size_t>(parseUsage<OpenAIChat>(chunk).has_value()); }, sink));
+    report("  openai usage (final chunk)", bestNanoseconds(event_iterations, [&] { return static_cast<size_t>(parseUsage<OpenAIChat>(final_chunk)->cached_tokens); }, sink));
+    report("  gemini usage", bestNanoseconds(event_iterations, [&] { return static_cast<size_t>(parseUsage<Gemini>(gemini)->cached_tokens); }, sink));
+    report("  ollama usage (delta line)", bestNanoseconds(event_iterations, [&] { return static_cast<size_t>(parseUsage<Ollama>(ndjson).has_value()); }, sink));
+    report("  ollama usage (final line)", bestNanoseconds(event_iterations, [&] { return static_cast<size_t>(parseUsage<Ollama>(ndjson_final)->completion_tokens); }, sink));
+    report("  openai end marker", bestNanoseconds(event_iterations, [&] { return static_cast<size_t>(isFinalStreamEvent<OpenAIChat>(chunk)); }, sink));
+    report("  gemini end marker", bestNanoseconds(event_iterations, [&] { return static_cast<size_t>(isFinalStreamEvent<Gemini>(gemini)); }, sink));
+    report("  ollama end marker", bestNanoseconds(event_iterations, [&] { return static_cast<size_t>(isFinalStreamEvent<Ollama>(ndjson_final)); }, sink));
+    report("  openai text, trait path", bestNanoseconds(event_iterations, [&] { return JsonExtractor::getString(chunk, OpenAIChat::stream_text)->size(); }, sink));
+    report("  openai text, braced path", bestNanoseconds(event_iterations, [&] { return JsonExtractor::getString(chunk, {"choices", 0, "delta", "content"})->size(); }, sink));
+    report("  ollama text, trait path", bestNanoseconds(event_iterations, [&] { return JsonExtractor::getString(ndjson, Ollama::stream_text)->size(); }, sink));
+    report("  ollama text, braced path", bestNanoseconds(event_iterations, [&] { return JsonExtractor::getString(ndjson, {"message", "content"})->size(); }, sink));
+
+    std::printf("(checksum %zu)\n", sink);
+    return 0;
+}
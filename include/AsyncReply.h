@@ -0,0 +1,57 @@
+#ifndef HAICL_ASYNC_REPLY_H
+#define HAICL_ASYNC_REPLY_H
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <optional>
+#include <thread>
+#include "IAIModel.h"
+#include "UsageStats.h"
+
+// Outcome of a request started with IAIModel::sendMessageAsync().
+struct ReplySummary {
+    std::optional<Message> reply; // Empty on errors or when cancelled
+    bool cancelled = false;       // The request was cancelled before the reply was complete
+    std::optional<TokenUsage> usage;
+    TurnTiming timing;
+};
+
+// Handle to a request running in the background (see IAIModel::sendMessageAsync()).
+// Like a future from std::async, destroying a handle whose request is still running cancels the
+// request and waits for its thread to finish.
+class ReplyHandle {
+public:
+    ReplyHandle(ReplyHandle&& other) noexcept = default;
+    ReplyHandle& operator=(ReplyHandle&& other) noexcept;
+    ~ReplyHandle();
+
+    // Asks the request to stop. A streamed reply stops at the next received piece, a request still
+    // waiting for the server within about a second; the summary then reports `cancelled`.
+    void cancel();
+
+    // Returns true once the summary is available.
+    bool done() const;
+
+    // Waits up to `timeout` for the request; returns true if it is done.
+    bool waitFor(std::chrono::milliseconds timeout) const;
+
+    // Waits for the request and returns its summary.
+    const ReplySummary& wait() const;
+
+    // The summary as a future, e.g. to wait for several requests together.
+    std::shared_future<ReplySummary> future() const { return result_; }
+
+private:
+    friend class IAIModel;
+
+    ReplyHandle(std::shared_ptr<std::atomic<bool>> cancelled, std::shared_future<ReplySummary> result, std::thread worker);
+    void finish();
+
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+    std::shared_future<ReplySummary> result_;
+    std::thread worker_;
+};
+
+#endif // HAICL_ASYNC_REPLY_H
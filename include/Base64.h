@@ -0,0 +1,18 @@
+#ifndef HAICL_BASE64_H
+#define HAICL_BASE64_H
+
+#include <string>
+#include <string_view>
+
+namespace Base64 {
+
+// Decodes standard base64 (RFC 4648, '=' padding optional) into `out`.
+// Returns false on characters outside the alphabet.
+bool decode(std::string_view input, std::string& out);
+
+// Encodes `input` as standard base64 with '=' padding.
+std::string encode(std::string_view input);
+
+} // namespace Base64
+
+#endif // HAICL_BASE64_H
@@ -0,0 +1,80 @@
+#ifndef HAICL_BPE_TOKENIZER_H
+#define HAICL_BPE_TOKENIZER_H
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Byte-level BPE tokenizer compatible with tiktoken rank files (e.g. cl100k_base.tiktoken,
+// o200k_base.tiktoken): one "<base64 token bytes> <rank>" pair per line, where the rank doubles as
+// the token id and the merge priority.
+//
+// Text is split into pieces by a hand-written equivalent of the cl100k or o200k pre-tokenization
+// regex (ASCII letter runs are scanned 16 bytes at a time with SSE2), each piece is looked up in an
+// open-addressing rank table and, if it is not a token by itself, merged by rank. Results for
+// pieces that needed merging are kept in an LRU cache.
+//
+// The Unicode letter, number and case classes of the regexes are approximated by code point ranges
+// covering the common scripts, so counts can differ slightly from tiktoken on other text (combining
+// marks, for example, count as letters).
+class BpeTokenizer {
+public:
+    // Pre-tokenization regex. o200k splits words at lower-to-upper case changes ("HelloWorld" is
+    // "Hello" + "World") and keeps contractions attached to the word ("don't" stays one piece).
+    enum class Pattern { Cl100k, O200k };
+
+    explicit BpeTokenizer(size_t cache_capacity = 8192);
+
+    // Loads a tiktoken rank file. Returns false (and reports the problem) if it cannot be read or parsed.
+    // The pattern is picked from the vocabulary size: o200k for vocabularies of about 200k tokens,
+    // cl100k otherwise; setPattern() overrides it.
+    bool loadRankFile(const std::string& path);
+
+    bool isLoaded() const { return !slots_.empty(); }
+    size_t vocabularySize() const { return token_count_; }
+
+    Pattern pattern() const { return pattern_; }
+    void setPattern(Pattern pattern) { pattern_ = pattern; }
+
+    // Encodes `text` into token ids.
+    std::vector<uint32_t> encode(std::string_view text);
+
+    // Counts the tokens of `text`. Pieces that are a single token are counted without producing ids;
+    // only pieces that need merging go through a small scratch buffer.
+    size_t count(std::string_view text);
+
+    // Splits `text` into pre-tokenization pieces (exposed for diagnostics).
+    static std::vector<std::string_view> pretokenize(std::string_view text, Pattern pattern = Pattern::Cl100k);
+
+private:
+    struct Slot {
+        uint64_t hash = 0;
+        uint32_t offset = 0;
+        uint32_t length = 0;
+        int32_t rank = -1; // -1 marks an empty slot
+    };
+
+    std::string token_bytes_; // Arena holding the bytes of every token
+    std::vector<Slot> slots_;
+    uint64_t slot_mask_ = 0;
+    size_t token_count_ = 0;
+    Pattern pattern_ = Pattern::Cl100k;
+
+    // LRU cache of piece -> tokens for pieces that required merging.
+    size_t cache_capacity_;
+    std::list<std::pair<std::string, std::vector<uint32_t>>> lru_;
+    std::unordered_map<std::string, decltype(lru_)::iterator> lru_index_;
+    std::mutex cache_mutex_;
+
+    int32_t rankOf(std::string_view bytes) const;
+    void insertRank(std::string_view bytes, int32_t rank);
+    void encodePiece(std::string_view piece, std::vector<uint32_t>& out);
+    void mergePiece(std::string_view piece, std::vector<uint32_t>& out) const;
+};
+
+#endif // HAICL_BPE_TOKENIZER_H
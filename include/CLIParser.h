@@ -14,6 +14,28 @@ struct CommandLineArgs {
     std::string load_history_file = "";
     std::string save_history_file = "";
     std::vector<std::string> model_params; // Keep as vector<string> for CLI11 parsing
+    int candidates = 0; // Alternative replies per request (0 = use model_params)
+    bool show_stats = false;
+    bool count_tokens = false;
+    bool compact = false;
+    bool no_cache = false; // Bypass the response cache entirely
+    bool refresh_cache = false; // Ignore cached replies but store fresh ones
+    bool semantic_cache = false;
+    bool tools = false; // Offer the configured local tools to the model
+    std::string json_schema_file = ""; // Structured output: JSON Schema the reply must match
+    std::vector<std::string> stop_strings; // Stop sequences, sent to the provider and enforced client-side
+    std::string stop_regex = ""; // Client-side: end the reply before the first match
+    int max_chars = 0; // Client-side: end the reply after this many characters (0 = unlimited)
+    bool first_code_block = false; // Client-side: end the reply with its first complete code block
+    std::string tokenizer_file = ""; // tiktoken rank file, overrides config
+
+    // bench-models subcommand
+    bool bench_models = false;
+    std::vector<std::string> bench_targets; // "provider/model" pairs
+    std::string bench_prompts_file = ""; // One prompt per line; empty = built-in set
+    int bench_runs = 3; // Times each prompt is sent to each target
+    int bench_concurrency = 1; // Concurrent requests per target
+    std::string bench_report_file = ""; // JSON report destination ("-" = standard output)
 };
 
 class CLIParser {
@@ -0,0 +1,65 @@
+#ifndef HAICL_CACHING_MODEL_H
+#define HAICL_CACHING_MODEL_H
+
+#include <functional>
+#include <memory>
+#include "IAIModel.h"
+#include "ResponseCache.h"
+#include "SemanticCache.h"
+
+// IAIModel decorator that answers repeated requests from a ResponseCache before they reach the
+// network. By default only deterministic requests (temperature 0) are cached, since sampled
+// replies are expected to differ between calls.
+//
+// With a SemanticCache, single-turn prompts that miss the exact cache are also embedded and matched
+// against earlier prompts by similarity (opt-in, so this applies regardless of temperature).
+class CachingModel : public IAIModel {
+public:
+    // refresh: Never answer from the cache, but store the fresh replies.
+    // deterministic_only: Only cache requests with temperature set to 0.
+    // cache, semantic_cache: Either may be null to disable that kind of caching.
+    CachingModel(std::unique_ptr<IAIModel> inner, std::shared_ptr<ResponseCache> cache, bool refresh, bool deterministic_only,
+                 std::shared_ptr<SemanticCache> semantic_cache = nullptr);
+
+    std::optional<Message> sendMessage(const std::vector<Message>& messages, const GenerationParams& params) override;
+    // Requests for several candidates bypass both caches, which hold a single reply per prompt.
+    std::optional<std::vector<Message>> sendMessageCandidates(const std::vector<Message>& messages, const GenerationParams& params) override;
+    // Cache hits are delivered as a single delta.
+    std::optional<Message> sendMessageStreaming(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback& on_delta) override;
+    std::string modelName() const override { return inner_->modelName(); }
+    std::string providerName() const override { return inner_->providerName(); }
+    std::string replyProviderName() const override { return inner_->replyProviderName(); }
+    std::string replyModelName() const override { return inner_->replyModelName(); }
+    std::string cacheScope() const override { return inner_->cacheScope(); }
+    // Cache hits cost no tokens and are reported as zero usage.
+    std::optional<TokenUsage> lastUsage() const override;
+    bool lastReplyFromCache() const override { return last_was_hit_; }
+    bool lastReplyIncomplete() const override { return !last_was_hit_ && inner_->lastReplyIncomplete(); }
+    void invalidateConversationCache(size_t first_changed_index = 0) override { inner_->invalidateConversationCache(first_changed_index); }
+    bool setCachedPrefix(size_t message_count) override { return inner_->setCachedPrefix(message_count); }
+    // Requests offering tools are never cached: replies may be tool calls with local side effects.
+    bool setTools(const std::vector<ToolDefinition>& tools) override;
+    bool continuesAssistantMessage() const override { return inner_->continuesAssistantMessage(); }
+    nlohmann::json exportConversationState() const override { return inner_->exportConversationState(); }
+    void importConversationState(const nlohmann::json& state) override { inner_->importConversationState(state); }
+    std::optional<EmbeddingMatrix> embedBatch(const std::vector<std::string>& texts) override { return inner_->embedBatch(texts); }
+    std::string embeddingModelName() const override { return inner_->embeddingModelName(); }
+
+private:
+    std::unique_ptr<IAIModel> inner_;
+    std::shared_ptr<ResponseCache> cache_;
+    std::shared_ptr<SemanticCache> semantic_cache_;
+    bool refresh_;
+    bool deterministic_only_;
+    bool last_was_hit_ = false;
+    bool tools_enabled_ = false;
+
+    bool isCacheable(const GenerationParams& params) const;
+    // Answers from the caches if possible; otherwise gets the reply from `send` and stores it.
+    std::optional<Message> sendThroughCaches(const std::vector<Message>& messages, const GenerationParams& params,
+                                             const std::function<std::optional<Message>()>& send);
+    // Replies that do not match the requested JSON Schema are not stored, so a retry asks the model again.
+    static bool isStorable(const Message& reply, const GenerationParams& params);
+};
+
+#endif // HAICL_CACHING_MODEL_H
@@ -16,7 +16,11 @@ public:
     std::string getString(const std::string& key, const std::string& default_value = "") const;
     int getInt(const std::string& key, int default_value = 0) const;
     bool getBool(const std::string& key, bool default_value = false) const;
-    std::map<std::string, std::string> getModelParams(const std::string& model_type) const;
+    double getDouble(const std::string& key, double default_value = 0.0) const;
+    // Returns the raw value at a dotted key (e.g. "tools.definitions") with JSON types preserved, or null.
+    nlohmann::json getJson(const std::string& key) const;
+    // Returns the raw "<model_type>.model_params" object with JSON types preserved, or an empty object.
+    nlohmann::json getModelParams(const std::string& model_type) const;
 
 private:
     nlohmann::json config_;
@@ -0,0 +1,107 @@
+#ifndef HAICL_CONTEXT_WINDOW_H
+#define HAICL_CONTEXT_WINDOW_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "IAIModel.h"
+
+// Counts (or estimates) the number of tokens in a piece of text.
+using TokenCounter = std::function<size_t(const std::string& text)>;
+
+// Sits between the REPL and IAIModel::sendMessage and keeps the messages sent each turn under a
+// token budget. System messages, a designated leading prefix and the last N messages are pinned;
+// the oldest remaining messages are dropped first.
+//
+// Token counts are cached per message and only recomputed for new or edited messages. Trimming
+// uses hysteresis (when the budget is exceeded, the window shrinks to a lower watermark), so the
+// start of the window moves rarely and the request prefix stays stable for provider and local
+// prefix caches in between.
+class ContextWindowManager {
+public:
+    // budget_tokens: Maximum tokens to send per request (0 = unbounded).
+    // keep_last_messages: Number of most recent messages that are never trimmed.
+    // trim_to_ratio: Fraction of the budget to shrink to once it is exceeded, in (0, 1].
+    ContextWindowManager(size_t budget_tokens, size_t keep_last_messages, double trim_to_ratio = 0.75, TokenCounter counter = nullptr);
+
+    // Returns the known context window size of `model_name` in tokens, or 0 if unknown.
+    static size_t contextLimitForModel(const std::string& model_name);
+
+    // Rough token estimate used when no tokenizer is available: ~4 bytes per token for ASCII text,
+    // one token per non-ASCII character.
+    static size_t estimateTokens(const std::string& text);
+
+    // Returns the messages to send for `conversation`, trimmed to fit the budget.
+    // The returned reference stays valid until the next call. While the window does not move,
+    // messages appended since the previous call are added to the previous selection.
+    const std::vector<Message>& select(const std::vector<Message>& conversation);
+
+    // Drops cached token counts for messages at or after `first_changed_index`, and the summary if it covers them.
+    void invalidate(size_t first_changed_index = 0);
+
+    // Pins the first `message_count` messages (e.g. a provider-side cached prefix).
+    void setPinnedPrefix(size_t message_count);
+
+    // Replaces the token counter (e.g. with a BPE tokenizer); all cached counts are dropped.
+    void setTokenCounter(TokenCounter counter);
+
+    // Replaces the unpinned messages before `covered_count` with `summary` in every selection
+    // (see ConversationCompactor). The summary is prepended to the user message that follows it, if
+    // any, and is dropped again when a covered message is edited.
+    void setSummary(size_t covered_count, Message summary);
+    // Number of leading conversation messages covered by the installed summary (0 if none).
+    size_t summarizedCount() const { return summarized_count_; }
+    const Message& summary() const { return summary_; }
+
+    // True if message `index` of `conversation` is never trimmed or summarized.
+    bool isPinned(const std::vector<Message>& conversation, size_t index) const;
+
+    size_t budget() const { return budget_tokens_; }
+    // Number of messages left out of the last selection (trimmed or summarized).
+    size_t trimmedCount() const { return trimmed_count_; }
+    // Estimated tokens of the last selection.
+    size_t selectedTokens() const { return selected_tokens_; }
+    // True if the last select() moved the start of the window compared to the previous call.
+    bool windowMoved() const { return window_moved_; }
+    // If the window moved, the first position in the selected messages that differs from the previous selection.
+    size_t firstChangedIndex() const { return first_changed_index_; }
+
+    // Maps a conversation index to its position in the last selection (for messages that were left out,
+    // the position they would have had). Used to translate edits for the model's own caches.
+    size_t windowIndexOf(size_t conversation_index) const;
+
+private:
+    struct CachedCount {
+        size_t content_size; // Detects a message replaced at the same index
+        size_t tokens;
+    };
+
+    size_t budget_tokens_;
+    size_t keep_last_messages_;
+    double trim_to_ratio_;
+    TokenCounter counter_;
+    size_t pinned_prefix_ = 0;
+
+    size_t summarized_count_ = 0;
+    Message summary_;
+    size_t summary_tokens_ = 0;
+    bool summary_changed_ = false;
+
+    std::vector<CachedCount> token_counts_;
+    // Index of the first unpinned message currently sent.
+    size_t window_start_ = 0;
+    std::vector<Message> window_;
+    // Conversation indices of the messages in window_ (empty when nothing is trimmed).
+    std::vector<size_t> window_indices_;
+    // Number of conversation messages window_ was built from (0 = rebuild on the next select()).
+    size_t window_source_count_ = 0;
+    size_t first_changed_index_ = 0;
+    size_t trimmed_count_ = 0;
+    size_t selected_tokens_ = 0;
+    bool window_moved_ = false;
+
+    size_t messageTokens(const std::vector<Message>& conversation, size_t index);
+};
+
+#endif // HAICL_CONTEXT_WINDOW_H
@@ -0,0 +1,65 @@
+#ifndef HAICL_CONVERSATION_COMPACTOR_H
+#define HAICL_CONVERSATION_COMPACTOR_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "IAIModel.h"
+#include "ContextWindow.h"
+
+// Opt-in compaction of long interactive sessions. Once the messages sent per turn exceed a token
+// threshold, the oldest unpinned turns are summarized by the model on a background thread while
+// the REPL keeps going; the finished summary is then installed into the ContextWindowManager in
+// place of those turns. The conversation itself (and so the history file) keeps every original turn.
+class ConversationCompactor {
+public:
+    // model: A separate model instance used only for summarizing (models are not thread-safe).
+    // threshold_tokens: Compaction starts once a selection exceeds this many tokens.
+    // keep_last_messages: Number of most recent messages that are never summarized (at least 1, the new user turn).
+    ConversationCompactor(std::unique_ptr<IAIModel> model, const GenerationParams& params, size_t threshold_tokens, size_t keep_last_messages);
+    ~ConversationCompactor();
+
+    ConversationCompactor(const ConversationCompactor&) = delete;
+    ConversationCompactor& operator=(const ConversationCompactor&) = delete;
+
+    // Starts summarizing in the background if the last selection of `context_window` exceeded the
+    // threshold and no job is running. Returns true if a job was started.
+    bool maybeStart(const std::vector<Message>& conversation, const ContextWindowManager& context_window);
+
+    // Installs a finished summary into `context_window` without blocking.
+    // Returns the number of messages newly covered by the summary (0 if nothing was ready).
+    size_t installFinished(ContextWindowManager& context_window);
+
+    // Discards the result of the running job, e.g. after the conversation was edited or replaced.
+    void cancel();
+
+    bool running() const;
+    size_t threshold() const { return threshold_tokens_; }
+
+private:
+    struct Result {
+        size_t covered_count;
+        size_t previously_covered;
+        std::optional<Message> reply;
+    };
+
+    std::unique_ptr<IAIModel> model_;
+    GenerationParams params_;
+    size_t threshold_tokens_;
+    size_t keep_last_messages_;
+
+    std::thread worker_;
+    mutable std::mutex mutex_;
+    bool running_ = false;
+    bool cancelled_ = false;
+    std::optional<Result> result_;
+
+    // Builds the summarization request for the messages being compacted, folding in the previous summary.
+    static std::string buildPrompt(const Message& previous_summary, const std::vector<const Message*>& messages);
+};
+
+#endif // HAICL_CONVERSATION_COMPACTOR_H
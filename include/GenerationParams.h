@@ -0,0 +1,68 @@
+#ifndef HAICL_GENERATION_PARAMS_H
+#define HAICL_GENERATION_PARAMS_H
+
+#include <optional>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+// Provider-neutral generation parameters, parsed and validated once at startup
+// from config.json ("<provider>.model_params") and --param overrides.
+// Each provider maps these onto its own wire fields (e.g. max_tokens -> maxOutputTokens for Gemini).
+struct GenerationParams {
+    std::optional<double> temperature;
+    std::optional<double> top_p;
+    std::optional<int> top_k;
+    std::optional<int> max_tokens;
+    std::optional<long long> seed;
+    std::optional<double> presence_penalty;
+    std::optional<double> frequency_penalty;
+    std::vector<std::string> stop;
+    // Number of alternative replies generated in one request ("n"); see IAIModel::sendMessageCandidates().
+    std::optional<int> candidate_count;
+    // JSON Schema the reply must conform to ("json_schema"; null if unset), sent to the provider's
+    // structured output mode.
+    nlohmann::json json_schema;
+    // Parameters HAICL does not know about, forwarded verbatim with their JSON types preserved.
+    nlohmann::json extra = nlohmann::json::object();
+
+    // Sets a parameter from an already typed JSON value (as found in config.json).
+    // Returns false and fills `error` if the key is known and the value is invalid.
+    bool set(const std::string& key, const nlohmann::json& value, std::string& error);
+
+    // Sets a parameter from a "--param key=value" string. The value is interpreted as JSON
+    // when it parses as such (numbers, booleans, arrays...), otherwise as a plain string.
+    bool setFromString(const std::string& key, const std::string& value, std::string& error);
+
+    // Builds parameters from a "model_params" JSON object.
+    // Returns empty and fills `error` on the first invalid entry.
+    static std::optional<GenerationParams> fromJson(const nlohmann::json& params, std::string& error);
+
+    // Returns the parameters as a "model_params" object with only the set fields. Keys are sorted,
+    // so equal parameters always serialize identically (used for cache keys).
+    nlohmann::json toJson() const;
+
+    bool operator==(const GenerationParams& other) const;
+    bool operator!=(const GenerationParams& other) const { return !(*this == other); }
+};
+
+// Caches a provider's serialized form of GenerationParams so the fragment is only
+// rebuilt when the parameters actually change between requests.
+class GenerationParamsFragment {
+public:
+    // Returns the cached fragment for `params`, calling `serialize(params)` to rebuild it if needed.
+    template <typename Serializer>
+    const std::string& get(const GenerationParams& params, Serializer serialize) {
+        if (!params_ || *params_ != params) {
+            fragment_ = serialize(params);
+            params_ = params;
+        }
+        return fragment_;
+    }
+
+private:
+    std::optional<GenerationParams> params_;
+    std::string fragment_;
+};
+
+#endif // HAICL_GENERATION_PARAMS_H
@@ -3,22 +3,94 @@
 
 #include "IAIModel.h"
 #include "HttpClient.h"
+#include "JsonWriter.h"
+#include "MessagePrefixCache.h"
 #include "json.hpp"
 #include <string>
 #include <vector>
 #include <map>
+#include <chrono>
 
 class GoogleAIModel : public IAIModel {
 public:
-    GoogleAIModel(const std::string& api_key, const std::string& base_url, const std::string& model_name);
+    // cache_prefix_messages: If non-zero, the first N messages of the conversation are uploaded once as a
+    // Gemini `cachedContents` resource and referenced by later requests instead of being resent.
+    // cache_ttl_seconds: Lifetime requested for that resource; it is recreated transparently on expiry.
+    GoogleAIModel(const std::string& api_key, const std::string& base_url, const std::string& model_name, size_t cache_prefix_messages = 0, int cache_ttl_seconds = 3600);
 
-    std::optional<Message> sendMessage(const std::vector<Message>& messages, const std::map<std::string, std::string>& model_params) override;
+    std::optional<Message> sendMessage(const std::vector<Message>& messages, const GenerationParams& params) override;
+    // All `candidateCount` candidates come from one generateContent request.
+    std::optional<std::vector<Message>> sendMessageCandidates(const std::vector<Message>& messages, const GenerationParams& params) override;
+    // Streams the first candidate with streamGenerateContent. Tool calls are not streamed.
+    std::optional<Message> sendMessageStreaming(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback& on_delta) override;
+    void invalidateConversationCache(size_t first_changed_index = 0) override;
+    std::optional<TokenUsage> lastUsage() const override;
+    std::string modelName() const override { return model_name_; }
+    std::string providerName() const override { return "google"; }
+    std::string cacheScope() const override { return base_url_; }
+    bool setCachedPrefix(size_t message_count) override;
+    bool setTools(const std::vector<ToolDefinition>& tools) override;
+    std::optional<EmbeddingMatrix> embedBatch(const std::vector<std::string>& texts) override;
+    std::string embeddingModelName() const override { return embedding_model_; }
+    void setEmbeddingModel(const std::string& model_name) { embedding_model_ = model_name; }
+    nlohmann::json exportConversationState() const override;
+    void importConversationState(const nlohmann::json& state) override;
 
 private:
     std::string api_key_;
     std::string base_url_;
     std::string model_name_;
     HttpClient http_client_;
+    GenerationParamsFragment params_fragment_;
+    // Serialized "tools" member (function declarations), spliced into every request that does not use
+    // the context cache; a cache holds the tools it was created with.
+    std::string tools_fragment_;
+    std::string tools_digest_; // Sha256::hex() of tools_fragment_, or empty without tools
+    MessagePrefixCache message_cache_;
+    std::optional<TokenUsage> last_usage_;
+    std::string embedding_model_ = "text-embedding-004";
+
+    // A server-side cachedContents resource holding the first `message_count` messages.
+    struct ContextCache {
+        std::string name; // e.g. "cachedContents/abc123"
+        size_t message_count;
+        std::chrono::system_clock::time_point expire_time;
+        std::string tools_digest; // tools_digest_ when it was created
+    };
+    size_t cache_prefix_messages_;
+    int cache_ttl_seconds_;
+    std::optional<ContextCache> context_cache_;
+    // Prefix length for which cache creation was rejected (e.g. below the provider's minimum size),
+    // so it is not retried on every turn.
+    size_t failed_cache_prefix_ = 0;
+
+    // Makes sure a live cache exists for the designated prefix of `messages`, creating it if needed.
+    bool ensureContextCache(const std::vector<Message>& messages);
+    // Deletes the current cache resource (best effort) and forgets it.
+    void dropContextCache();
+    // Set when the caller's delta callback stopped the last streamed request.
+    bool stream_aborted_ = false;
+
+    // Sends the conversation through the context cache if one is configured, streaming if `on_delta` is set.
+    std::optional<std::vector<Message>> send(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback* on_delta);
+    // Sends messages[first_message..], referencing `cached_content` for the messages before it if set.
+    std::optional<std::vector<Message>> generateContent(const std::vector<Message>& messages, size_t first_message, const std::string& cached_content, const GenerationParams& params, const DeltaCallback* on_delta);
+    // Posts a streamGenerateContent request and assembles the streamed first candidate.
+    std::optional<std::vector<Message>> streamContent(const std::string& url, const std::string& request_body, const DeltaCallback& on_delta);
+    // Reads every candidate of a generateContent reply, in order.
+    std::optional<std::vector<Message>> parseCandidates(const std::string& raw_response);
+    // Reads one candidate: its text parts and function calls.
+    static std::optional<Message> parseCandidate(std::string_view candidate);
+
+
+    // Encodes messages[first_message..], grouping consecutive tool results into one user turn.
+    static void encodeMessages(JsonWriter& writer, const std::vector<Message>& messages, size_t first_message);
+
+    // Serializes the "tools" member declaring `tools` as functions, without the enclosing braces.
+    static std::string serializeTools(const std::vector<ToolDefinition>& tools);
+
+    // Serializes `params` into this provider's wire fields, reused across requests.
+    static std::string serializeParams(const GenerationParams& params);
 };
 
 #endif // HAICL_GOOGLE_AI_MODEL_H
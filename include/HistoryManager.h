@@ -36,9 +36,22 @@ public:
     // Returns true on success, false on failure.
     bool modifyMessage(const std::string& filename, size_t message_index, const std::string& new_content);
 
+    // Saves provider-side conversation state (see IAIModel::exportConversationState) next to a history file.
+    // filename: The name of the history file the state belongs to.
+    // state: The state to persist; a null state removes any previously saved state.
+    // Returns true on success, false on failure.
+    bool saveConversationState(const std::string& filename, const nlohmann::json& state);
+
+    // Loads the provider-side conversation state saved next to a history file.
+    // Returns the state, or empty if none was saved or it cannot be parsed.
+    std::optional<nlohmann::json> loadConversationState(const std::string& filename) const;
+
 private:
     fs::path history_dir_;
 
+    // Helper to get the path of the state file belonging to a history file.
+    fs::path getStatePath(const std::string& filename) const;
+
     // Helper to get a timestamped filename.
     std::string getTimestampedFilename() const;
 
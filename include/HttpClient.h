@@ -1,7 +1,10 @@
 #ifndef HAICL_HTTP_CLIENT_H
 #define HAICL_HTTP_CLIENT_H
 
+#include <atomic>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <map>
 #include <optional>
 #include "json.hpp"
@@ -11,6 +14,9 @@ size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp);
 
 class HttpClient {
 public:
+    // Receives a streamed response body piece by piece as it arrives; returning false aborts the transfer
+    using ChunkCallback = std::function<bool(std::string_view chunk)>;
+
     // Performs an HTTP POST request
     // url: The URL to send the request to
     // headers: A map of HTTP headers (e.g., {"Content-Type", "application/json"})
@@ -18,15 +24,65 @@ public:
     // Returns an optional JSON object representing the response, or empty if an error occurs
     std::optional<nlohmann::json> post(const std::string& url, const std::map<std::string, std::string>& headers, const nlohmann::json& body);
 
+    // Performs an HTTP POST request with an already serialized JSON body
+    // body: The request body, sent as-is without any intermediate copy
+    // Returns an optional JSON object representing the response, or empty if an error occurs
+    std::optional<nlohmann::json> postSerialized(const std::string& url, const std::map<std::string, std::string>& headers, const std::string& body);
+
+    // Performs an HTTP POST request with an already serialized JSON body and returns the raw response body
+    // Lets callers extract the fields they need without parsing the whole response into a DOM
+    // Returns the response body, or empty if the request fails or the server does not answer with HTTP 200
+    std::optional<std::string> postSerializedRaw(const std::string& url, const std::map<std::string, std::string>& headers, const std::string& body);
+
+    // Performs an HTTP POST request with an already serialized JSON body and hands the response body to
+    // `on_chunk` while it is still being received (e.g. server-sent events)
+    // Returns true if the whole response arrived with HTTP 200; false on errors or if `on_chunk` aborted it
+    bool postStreaming(const std::string& url, const std::map<std::string, std::string>& headers, const std::string& body, const ChunkCallback& on_chunk);
+
     // Performs an HTTP GET request
     // url: The URL to send the request to
     // headers: A map of HTTP headers
     // Returns an optional JSON object representing the response, or empty if an error occurs
     std::optional<nlohmann::json> get(const std::string& url, const std::map<std::string, std::string>& headers);
 
+    // Performs an HTTP DELETE request
+    // url: The URL of the resource to delete
+    // headers: A map of HTTP headers
+    // Returns an optional JSON object representing the response, or empty if an error occurs
+    std::optional<nlohmann::json> del(const std::string& url, const std::map<std::string, std::string>& headers);
+
+    // While it exists, requests started on the current thread abort as soon as `*cancelled` turns true,
+    // also while still waiting for the first byte of the response. Like a streaming request stopped by
+    // its callback, an aborted request fails without reporting an error.
+    class CancelScope {
+    public:
+        explicit CancelScope(const std::atomic<bool>* cancelled);
+        ~CancelScope();
+        CancelScope(const CancelScope&) = delete;
+        CancelScope& operator=(const CancelScope&) = delete;
+
+    private:
+        const std::atomic<bool>* previous_;
+    };
+
+    // Returns true if requests on the current thread have been cancelled (see CancelScope)
+    static bool cancelRequested();
+
+    // Returns the HTTP status of the last request made on the current thread, or 0 if it received no
+    // response (connection errors, cancellation)
+    static long lastStatusCode();
+
+    // Initializes libcurl once per process; must precede any other libcurl call
+    static void ensureCurlInitialized();
+
+    // Parses a raw response body into JSON, reporting parse errors
+    // Returns empty if `response` is empty or not valid JSON
+    static std::optional<nlohmann::json> parseResponse(const std::optional<std::string>& response);
+
 private:
-    // Helper function to perform a generic HTTP request
-    std::optional<nlohmann::json> performRequest(const std::string& url, const std::map<std::string, std::string>& headers, const std::optional<std::string>& post_fields, const std::string& method);
+    // Helper function to perform a generic HTTP request, returning the raw response body
+    // If `on_chunk` is set, a successful response body is passed to it instead of being returned
+    std::optional<std::string> performRequest(const std::string& url, const std::map<std::string, std::string>& headers, const std::string* post_fields, const std::string& method, const ChunkCallback* on_chunk = nullptr);
 };
 
 #endif // HAICL_HTTP_CLIENT_H
@@ -1,29 +1,164 @@
 #ifndef HAICL_IAI_MODEL_H
 #define HAICL_IAI_MODEL_H
 
+#include <functional>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include "json.hpp"
+#include "GenerationParams.h"
+#include "UsageStats.h"
+#include "VectorMath.h"
 
+// A function call requested by the model.
+struct ToolCall {
+    std::string id; // Provider-assigned id echoed back with the result (may be empty for Gemini)
+    std::string name;
+    std::string arguments; // JSON object text
+};
+
+// A function the model may call, described to it by name, purpose and JSON Schema of the arguments.
+struct ToolDefinition {
+    std::string name;
+    std::string description;
+    nlohmann::json parameters = nlohmann::json::object();
+};
+
+// Plain text messages are written as Message{role, content}; the tool fields have default member
+// initializers so that form stays free of -Wmissing-field-initializers warnings.
 struct Message {
     std::string role;
     std::string content;
+    // Assistant messages: tool calls requested by the model (the content may then be empty).
+    std::vector<ToolCall> tool_calls{};
+    // Tool results (role "tool"): the call this message answers.
+    std::string tool_call_id{};
+    std::string tool_name{};
 
-    // Helper for JSON serialization/deserialization
+    // Helper for JSON serialization/deserialization. Tool fields only live within a single turn
+    // and are not persisted.
     NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Message, role, content)
 };
 
+struct ReplySummary;
+class ReplyHandle;
+
 class IAIModel {
 public:
+    // Receives each piece of reply text as it is generated; returning false aborts the request.
+    using DeltaCallback = std::function<bool(std::string_view delta)>;
+    // Receives the outcome of an asynchronous request (see sendMessageAsync()).
+    using CompletionCallback = std::function<void(const ReplySummary& summary)>;
+
     virtual ~IAIModel() = default;
 
     // Sends a message to the AI model and returns the response.
     // messages: A vector of Message objects representing the conversation history.
-    // model_params: A map of model-specific parameters (e.g., "temperature", "max_tokens").
+    // params: Validated generation parameters (e.g., temperature, max_tokens), mapped by each provider to its wire format.
     // Returns an optional Message object representing the AI's reply, or empty if an error occurs.
-    virtual std::optional<Message> sendMessage(const std::vector<Message>& messages, const std::map<std::string, std::string>& model_params) = 0;
+    virtual std::optional<Message> sendMessage(const std::vector<Message>& messages, const GenerationParams& params) = 0;
+
+    // Like sendMessage(), but returns every candidate reply when params.candidate_count asks for
+    // several. Providers that support it generate all candidates in a single request (one round
+    // trip, one pass over the prompt); the default returns just the sendMessage() reply.
+    virtual std::optional<std::vector<Message>> sendMessageCandidates(const std::vector<Message>& messages, const GenerationParams& params) {
+        std::optional<Message> reply = sendMessage(messages, params);
+        if (!reply) {
+            return std::nullopt;
+        }
+        return std::vector<Message>{std::move(*reply)};
+    }
+
+    // Like sendMessage(), but streams the reply: `on_delta` sees the text while it is being generated
+    // and can abort the request early (e.g. once the output is known to be unusable), which stops the
+    // generation and its cost. Returns the complete reply, or empty on errors or when aborted.
+    // Models that cannot stream deliver the whole reply as a single delta.
+    virtual std::optional<Message> sendMessageStreaming(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback& on_delta) {
+        std::optional<Message> reply = sendMessage(messages, params);
+        if (!reply || !on_delta(reply->content)) {
+            return std::nullopt;
+        }
+        return reply;
+    }
+
+    // Starts sendMessageStreaming() on a background thread and returns at once with a handle to wait
+    // for, poll or cancel the request (see AsyncReply.h). `on_delta` (optional) sees the reply text as
+    // it arrives and `on_complete` (optional) the final summary; both run on the background thread.
+    // The model must outlive the handle and must not be used for other requests until it is done.
+    ReplyHandle sendMessageAsync(std::vector<Message> messages, GenerationParams params, DeltaCallback on_delta = nullptr, CompletionCallback on_complete = nullptr);
+
+    // Offers `tools` to the model in subsequent requests (empty disables tool calling). Replies may then
+    // carry tool_calls instead of text; the caller runs them and sends the results back as "tool"
+    // messages. Returns false if the model does not support tool calling.
+    virtual bool setTools(const std::vector<ToolDefinition>& tools) { return tools.empty(); }
+
+    // Returns true if, given a conversation that ends with an assistant message, the model extends that
+    // message instead of answering it with a new one (assistant prefill).
+    virtual bool continuesAssistantMessage() const { return false; }
+
+    // Returns the name of the underlying model (e.g. "gpt-4o"), used for context limits and reporting.
+    virtual std::string modelName() const = 0;
+
+    // Returns the provider identifier (e.g. "openai", "google").
+    virtual std::string providerName() const = 0;
+
+    // Return the provider and model that generated the most recent reply, which its usage is
+    // accounted to. Models that pass requests on to one of several others (e.g. a router) report
+    // the one that answered; all others report themselves.
+    virtual std::string replyProviderName() const { return providerName(); }
+    virtual std::string replyModelName() const { return modelName(); }
+
+    // Returns provider-level settings besides the model name and parameters that affect replies
+    // (e.g. the endpoint or a configured system prompt). Part of response cache keys.
+    virtual std::string cacheScope() const { return ""; }
+
+    // Embeds every text in `texts` with the provider's embeddings endpoint and model (see
+    // embeddingModelName()), sending many inputs per HTTP request. Row i of the result is the
+    // embedding of texts[i]. Returns empty if the model does not support embeddings or a request failed.
+    virtual std::optional<EmbeddingMatrix> embedBatch(const std::vector<std::string>& texts) { (void)texts; return std::nullopt; }
+
+    // Embeds a single text (see embedBatch()).
+    std::optional<std::vector<float>> embed(const std::string& text) {
+        std::optional<EmbeddingMatrix> matrix = embedBatch({text});
+        if (!matrix || matrix->rows != 1) {
+            return std::nullopt;
+        }
+        return std::move(matrix->values);
+    }
+
+    // Returns the name of the model used by embed(), or empty if embeddings are not supported.
+    virtual std::string embeddingModelName() const { return ""; }
+
+    // Returns the token usage reported for the most recent successful sendMessage() call,
+    // or empty if the provider did not report any.
+    virtual std::optional<TokenUsage> lastUsage() const { return std::nullopt; }
+
+    // Returns true if the most recent reply was answered locally (e.g. from a response cache)
+    // without sending a request to the provider.
+    virtual bool lastReplyFromCache() const { return false; }
+
+    // Returns true if the most recent reply is only the start of what the model generated (e.g. a
+    // stream that broke and could not be resumed). Such replies are kept but must not be cached.
+    virtual bool lastReplyIncomplete() const { return false; }
+
+    // Tells the model that the conversation changed at or after `first_changed_index` in a way
+    // it cannot detect on its own (e.g. an earlier message was edited in place or a different
+    // conversation was loaded), so any per-conversation state derived from it must be dropped.
+    virtual void invalidateConversationCache(size_t first_changed_index = 0) { (void)first_changed_index; }
+
+    // Designates the first `message_count` messages of the conversation as a reusable prefix to be
+    // cached provider-side (0 disables). Returns false if the model does not support explicit caching.
+    virtual bool setCachedPrefix(size_t message_count) { (void)message_count; return false; }
+
+    // Returns provider-side conversation state worth persisting next to a history file
+    // (e.g. server-side response ids), or null if the model keeps none.
+    virtual nlohmann::json exportConversationState() const { return nullptr; }
+
+    // Restores state previously returned by exportConversationState() for the conversation
+    // that was just loaded. Unknown or mismatching state must be ignored.
+    virtual void importConversationState(const nlohmann::json& state) { (void)state; }
 };
 
 #endif // HAICL_IAI_MODEL_H
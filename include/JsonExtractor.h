@@ -0,0 +1,82 @@
+#ifndef HAICL_JSON_EXTRACTOR_H
+#define HAICL_JSON_EXTRACTOR_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// One step of a JSON path: an object key or an array index.
+struct JsonPathStep {
+    constexpr JsonPathStep() : index(0), is_index(false) {}
+    constexpr JsonPathStep(const char* object_key) : key(object_key), index(0), is_index(false) {}
+    constexpr JsonPathStep(std::string_view object_key) : key(object_key), index(0), is_index(false) {}
+    constexpr JsonPathStep(int array_index) : index(static_cast<size_t>(array_index)), is_index(true) {}
+    constexpr JsonPathStep(size_t array_index) : index(array_index), is_index(true) {}
+
+    std::string_view key;
+    size_t index;
+    bool is_index;
+};
+
+// A path of up to kMaxDepth steps, written as a braced list: {"choices", 0, "delta", "content"}.
+// A literal type, so paths can also be compile-time constants (see ProviderTraits.h).
+class JsonPath {
+public:
+    static constexpr size_t kMaxDepth = 6;
+
+    constexpr JsonPath() : steps_{}, size_(0) {}
+
+    // Keys are referenced, not copied: they must outlive the path.
+    template <typename... Steps, typename = std::enable_if_t<(sizeof...(Steps) > 0) && (std::is_constructible_v<JsonPathStep, const Steps&> && ...)>>
+    constexpr JsonPath(const Steps&... steps) : steps_{JsonPathStep(steps)...}, size_(sizeof...(Steps)) {
+        static_assert(sizeof...(Steps) <= kMaxDepth, "JsonPath is limited to kMaxDepth steps");
+    }
+
+    constexpr const JsonPathStep* begin() const { return steps_; }
+    constexpr const JsonPathStep* end() const { return steps_ + size_; }
+    constexpr size_t size() const { return size_; }
+    constexpr bool empty() const { return size_ == 0; }
+
+private:
+    JsonPathStep steps_[kMaxDepth];
+    size_t size_;
+};
+
+// On-demand field extraction from a raw JSON buffer.
+// Instead of building a DOM, the path is followed directly through the text: siblings that are not
+// on the path are skipped by scanning for structural characters 16 bytes at a time (SSE2), and only
+// the target value is decoded. The document is not validated beyond what is needed to reach the
+// target, so every function returns empty on anything unexpected and callers should fall back to a
+// full nlohmann::json parse in that case.
+namespace JsonExtractor {
+
+// Returns the raw text of the value at `path` (e.g. `"abc"`, `42`, `{...}`), or empty if not found.
+std::optional<std::string_view> findValue(std::string_view json, const JsonPath& path);
+
+// Returns the unescaped string at `path`, or empty if missing or not a string.
+std::optional<std::string> getString(std::string_view json, const JsonPath& path);
+
+// Returns the integer at `path`, or empty if missing or not an integer.
+std::optional<long long> getInteger(std::string_view json, const JsonPath& path);
+
+// Returns the number at `path`, or empty if missing or not a number.
+std::optional<double> getDouble(std::string_view json, const JsonPath& path);
+
+// Returns the raw text of every element of the JSON array `array` (e.g. a value returned by
+// findValue), or empty if it is not an array.
+std::optional<std::vector<std::string_view>> arrayElements(std::string_view array);
+
+// Parses the JSON array of numbers `array` (e.g. an embedding) and appends the values to `out` as
+// floats. Returns false if it is not an array of numbers; `out` may have been extended partially.
+bool appendFloats(std::string_view array, std::vector<float>& out);
+
+// Decodes the body of a JSON string literal (without quotes) into UTF-8.
+// Returns empty on malformed escape sequences.
+std::optional<std::string> unescape(std::string_view literal_body);
+
+} // namespace JsonExtractor
+
+#endif // HAICL_JSON_EXTRACTOR_H
@@ -0,0 +1,87 @@
+#ifndef HAICL_JSON_SCHEMA_VALIDATOR_H
+#define HAICL_JSON_SCHEMA_VALIDATOR_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "json.hpp"
+
+// Checks a JSON document against a JSON Schema while it is still being generated.
+// Text is fed in arbitrary pieces (e.g. streamed reply deltas) and parsed one character at a time;
+// feed() fails as soon as no continuation could make the document valid: a syntax error, a value of
+// the wrong type, a property the schema forbids, a string that cannot become one of the enum
+// values, too many array items... A diverging reply can so be abandoned without waiting for the rest.
+//
+// Checked keywords: type, properties, required, additionalProperties, items, enum, const,
+// minItems/maxItems, minLength/maxLength, minimum/maximum, exclusiveMinimum/exclusiveMaximum.
+// Other keywords (anyOf, $ref, pattern, format...) are accepted without being checked.
+// A surrounding Markdown code fence (```json ... ```) is tolerated.
+class JsonSchemaValidator {
+public:
+    explicit JsonSchemaValidator(nlohmann::json schema);
+
+    // The parser state points into the owned schema.
+    JsonSchemaValidator(const JsonSchemaValidator&) = delete;
+    JsonSchemaValidator& operator=(const JsonSchemaValidator&) = delete;
+
+    // Consumes the next piece of the document. Returns false once the document is known to be invalid.
+    bool feed(std::string_view text);
+
+    // Call after the last piece: returns false if the document is invalid or incomplete.
+    bool finish();
+
+    // Describes the first violation, starting with its location (e.g. "$.items[2].name: ...").
+    const std::string& error() const { return error_; }
+
+    // Validates a complete document. `error`, if given, receives the description of a violation.
+    static bool validate(const nlohmann::json& schema, std::string_view text, std::string* error = nullptr);
+
+private:
+    // What may come next inside the innermost container.
+    enum class Expect { Value, ValueOrEnd, Key, KeyOrEnd, Colon, CommaOrEnd };
+    // The scalar being read, if any.
+    enum class Token { None, String, Number, Literal };
+    enum class Phase { BeforeDocument, OpeningFence, InDocument, AfterDocument, ClosingFence };
+
+    struct Frame {
+        bool is_object;
+        const nlohmann::json* schema; // Null if unconstrained
+        Expect expect;
+        size_t count = 0;               // Members or items started so far
+        std::string key{};              // Current member's name (objects)
+        std::vector<std::string> keys{}; // Member names seen so far (objects)
+    };
+
+    nlohmann::json schema_;
+    std::vector<Frame> stack_;
+    Phase phase_ = Phase::BeforeDocument;
+    bool fenced_ = false;
+    int fence_ticks_ = 0;
+    Token token_ = Token::None;
+    std::string token_text_; // Raw text of the scalar (string contents without quotes)
+    const nlohmann::json* token_schema_ = nullptr;
+    bool token_is_key_ = false;
+    bool token_escaped_ = false; // The string contains escape sequences
+    bool token_prefix_checks_ = false; // The schema restricts the string's possible prefixes
+    bool in_escape_ = false;
+    std::string error_;
+
+    bool step(char c);
+    bool structural(char c);
+    bool beginValue(char c, const nlohmann::json* schema);
+    bool stringCharacter(char c);
+    bool endString();
+    bool endScalar();
+    bool checkScalar(const nlohmann::json& value);
+    bool closeContainer();
+    bool valueDone();
+
+    // Schema of the next value in the innermost container, or null if unconstrained.
+    const nlohmann::json* childSchema() const;
+    // Location of the value being read; `include_member` adds the innermost container's current member.
+    std::string path(bool include_member = true) const;
+    bool fail(const std::string& location, const std::string& message);
+};
+
+#endif // HAICL_JSON_SCHEMA_VALIDATOR_H
@@ -0,0 +1,56 @@
+#ifndef HAICL_JSON_WRITER_H
+#define HAICL_JSON_WRITER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Appends `text` to `out` as the body of a JSON string literal (without the surrounding quotes).
+// Runs of characters that need no escaping are located with SSE2/AVX2 where available and copied in bulk.
+void appendJsonEscaped(std::string& out, std::string_view text);
+
+// Minimal streaming JSON writer that serializes directly into a caller-owned buffer.
+// Used to build request bodies without materializing an nlohmann::json DOM.
+// The writer does not validate structure; callers are expected to emit well-formed sequences.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    // Writes an object key. Must be followed by exactly one value.
+    void key(std::string_view name);
+
+    void value(std::string_view text);
+    void value(const char* text);
+    void value(const std::string& text);
+    void value(bool flag);
+    void value(int number);
+    void value(long long number);
+    void value(double number);
+    void null();
+
+    // Writes an already serialized JSON value (e.g. a cached fragment) verbatim.
+    void rawValue(std::string_view json);
+
+    // Writes already serialized `"key":value` members verbatim into the current object.
+    // `members` must not start or end with a comma; an empty string is ignored.
+    void rawMembers(std::string_view members);
+
+    // Writes already serialized, comma-separated array elements verbatim into the current array.
+    // `elements` must not start or end with a comma; an empty string is ignored.
+    void rawElements(std::string_view elements);
+
+private:
+    std::string& out_;
+    // One entry per open container: true until the first element has been written.
+    std::vector<bool> first_in_scope_;
+    bool after_key_ = false;
+
+    void separate();
+};
+
+#endif // HAICL_JSON_WRITER_H
@@ -0,0 +1,76 @@
+#ifndef HAICL_LOCAL_MODEL_H
+#define HAICL_LOCAL_MODEL_H
+
+#include "IAIModel.h"
+#include "HttpClient.h"
+#include "JsonWriter.h"
+#include "MessagePrefixCache.h"
+#include "json.hpp"
+#include <string>
+#include <vector>
+
+// Models served on the local machine (or network) by Ollama or a llama.cpp server. No API key is needed.
+//
+// Ollama is spoken through its native /api/chat (streamed as one JSON object per line), which lets
+// every request say how long the model stays loaded afterwards (keep_alive), so consecutive turns do
+// not pay for reloading it. llama.cpp keeps its single model loaded anyway; its OpenAI-compatible
+// /v1/chat/completions is used with cache_prompt, so the KV cache of the shared conversation prefix
+// is reused between turns.
+class LocalModel : public IAIModel {
+public:
+    enum class Api { Ollama, LlamaCpp };
+
+    // keep_alive: Ollama duration the model stays loaded after a request (e.g. "30m", "-1" = until
+    //             the server stops; empty = server default). Ignored by llama.cpp.
+    // num_ctx: Context window to load the model with (0 = server default). llama.cpp fixes it when the
+    //          server starts (-c), so there it only informs the client-side context budget.
+    LocalModel(const std::string& base_url, const std::string& model_name, Api api, const std::string& keep_alive, int num_ctx);
+
+    std::optional<Message> sendMessage(const std::vector<Message>& messages, const GenerationParams& params) override;
+    std::optional<Message> sendMessageStreaming(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback& on_delta) override;
+    void invalidateConversationCache(size_t first_changed_index = 0) override { message_cache_.invalidate(first_changed_index); }
+    std::optional<TokenUsage> lastUsage() const override { return last_usage_; }
+    std::string modelName() const override { return model_name_; }
+    std::string providerName() const override { return "local"; }
+    std::string cacheScope() const override { return base_url_; }
+    // Both servers render the chat template themselves and leave a trailing assistant turn open.
+    bool continuesAssistantMessage() const override { return true; }
+
+    // Ollama /api/embed; llama.cpp /v1/embeddings (the server must run with --embeddings).
+    std::optional<EmbeddingMatrix> embedBatch(const std::vector<std::string>& texts) override;
+    std::string embeddingModelName() const override { return embedding_model_; }
+    void setEmbeddingModel(const std::string& model_name) { embedding_model_ = model_name; }
+
+    // The configured context window in tokens, or 0 if left to the server.
+    size_t contextLength() const { return num_ctx_ > 0 ? static_cast<size_t>(num_ctx_) : 0; }
+
+    // Parses "ollama" or "llamacpp"; empty if unknown.
+    static std::optional<Api> parseApi(const std::string& name);
+
+private:
+    std::string base_url_;
+    std::string model_name_;
+    Api api_;
+    std::string keep_alive_; // Serialized JSON value, empty for the server default
+    int num_ctx_;
+    HttpClient http_client_;
+    GenerationParamsFragment params_fragment_;
+    MessagePrefixCache message_cache_;
+    std::optional<TokenUsage> last_usage_;
+    std::string embedding_model_ = "nomic-embed-text";
+
+    // Sends the conversation, streaming the reply to `on_delta` if set.
+    std::optional<Message> send(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback* on_delta);
+    std::string buildRequest(const std::vector<Message>& messages, const GenerationParams& params, bool stream);
+    std::string chatUrl() const;
+
+    // Reads a complete (non-streamed) reply.
+    std::optional<Message> parseReply(const std::string& raw_response);
+    // Reads the usage of a complete reply or of the last streamed chunk.
+    std::optional<TokenUsage> parseUsage(std::string_view raw_response) const;
+
+    // Serializes `params` into the server's wire fields, reused across requests.
+    std::string serializeParams(const GenerationParams& params) const;
+};
+
+#endif // HAICL_LOCAL_MODEL_H
@@ -0,0 +1,113 @@
+#ifndef HAICL_MESSAGE_PREFIX_CACHE_H
+#define HAICL_MESSAGE_PREFIX_CACHE_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "IAIModel.h"
+#include "JsonWriter.h"
+
+// Caches the serialized form of the leading messages of a conversation, so that building the next
+// request only encodes the messages appended since the previous one instead of re-escaping the
+// whole history every turn.
+//
+// The cache recognizes its prefix by role and field sizes plus the tool-call count of every cached
+// message, and a full comparison of the last cached message only, so checking it stays O(messages)
+// rather than O(history size). That catches the usual REPL changes (a failed turn being popped and
+// replaced, a conversation growing); edits to earlier messages that keep their sizes (`modify`,
+// `load`, a moved context window) must be reported via invalidate(), as the REPL does.
+class MessagePrefixCache {
+public:
+    // Returns the comma-separated encodings of all `messages`, suitable for JsonWriter::rawElements().
+    // `encode_message(JsonWriter&, const Message&)` writes a single message and is only invoked for
+    // messages that are not already cached.
+    template <typename Encoder>
+    const std::string& encode(const std::vector<Message>& messages, Encoder encode_message) {
+        truncate(reusablePrefixLength(messages));
+        if (entries_.size() == messages.size()) {
+            return encoded_;
+        }
+        for (size_t i = entries_.size(); i < messages.size(); ++i) {
+            const Message& msg = messages[i];
+            if (!encoded_.empty()) {
+                encoded_ += ',';
+            }
+            JsonWriter writer(encoded_);
+            encode_message(writer, msg);
+            entries_.push_back({encoded_.size(), msg.role.size(), msg.content.size(), toolFieldsSize(msg), msg.tool_calls.size()});
+        }
+        last_message_ = messages.back();
+        last_message_valid_ = true;
+        return encoded_;
+    }
+
+    // Drops cached encodings of the message at `first_changed_index` and everything after it.
+    void invalidate(size_t first_changed_index = 0) {
+        if (first_changed_index < entries_.size()) {
+            truncate(first_changed_index);
+        }
+    }
+
+    // Number of messages whose encoding is currently cached.
+    size_t size() const { return entries_.size(); }
+
+private:
+    struct Entry {
+        size_t end_offset; // Offset in encoded_ just past this message's encoding
+        size_t role_size;
+        size_t content_size;
+        size_t tool_fields_size;
+        size_t tool_call_count;
+    };
+
+    std::string encoded_;
+    std::vector<Entry> entries_;
+    // Copy of the last cached message, compared in full to detect a replaced tail.
+    Message last_message_;
+    bool last_message_valid_ = false;
+
+    size_t reusablePrefixLength(const std::vector<Message>& messages) const {
+        size_t limit = std::min(entries_.size(), messages.size());
+        for (size_t i = 0; i < limit; ++i) {
+            const Entry& entry = entries_[i];
+            if (entry.role_size != messages[i].role.size() || entry.content_size != messages[i].content.size() ||
+                entry.tool_call_count != messages[i].tool_calls.size() || entry.tool_fields_size != toolFieldsSize(messages[i])) {
+                return i;
+            }
+        }
+        if (last_message_valid_ && limit > 0 && limit == entries_.size() && !sameMessage(messages[limit - 1], last_message_)) {
+            return limit - 1;
+        }
+        return limit;
+    }
+
+    // Combined size of the tool fields, so tool turns of equal text size are told apart.
+    static size_t toolFieldsSize(const Message& msg) {
+        size_t size = msg.tool_call_id.size() + msg.tool_name.size();
+        for (const auto& call : msg.tool_calls) {
+            size += call.id.size() + call.name.size() + call.arguments.size();
+        }
+        return size;
+    }
+
+    static bool sameMessage(const Message& a, const Message& b) {
+        if (a.role != b.role || a.content != b.content || a.tool_call_id != b.tool_call_id || a.tool_name != b.tool_name ||
+            a.tool_calls.size() != b.tool_calls.size()) {
+            return false;
+        }
+        return std::equal(a.tool_calls.begin(), a.tool_calls.end(), b.tool_calls.begin(), [](const ToolCall& x, const ToolCall& y) {
+            return x.id == y.id && x.name == y.name && x.arguments == y.arguments;
+        });
+    }
+
+    void truncate(size_t count) {
+        if (count < entries_.size()) {
+            entries_.resize(count);
+            encoded_.resize(count == 0 ? 0 : entries_.back().end_offset);
+            // The copy is of a message that is no longer cached; the remaining prefix is taken as intact.
+            last_message_valid_ = false;
+        }
+    }
+};
+
+#endif // HAICL_MESSAGE_PREFIX_CACHE_H
@@ -0,0 +1,61 @@
+#ifndef HAICL_MODEL_BENCHMARK_H
+#define HAICL_MODEL_BENCHMARK_H
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "IAIModel.h"
+#include "GenerationParams.h"
+#include "UsageStats.h"
+#include "json.hpp"
+
+// Compares the latency and throughput of several provider/model pairs on the same prompts
+// (haicl bench-models). All targets run at the same time; each target runs its requests on
+// `concurrency` workers, every worker with its own model instance.
+class ModelBenchmark {
+public:
+    struct Target {
+        std::string provider;
+        std::string model; // Empty for the provider's configured default
+        GenerationParams params;
+
+        // "provider/model", as given on the command line.
+        std::string label() const { return model.empty() ? provider : provider + "/" + model; }
+    };
+
+    // One request: failed requests only have a timing.
+    struct Sample {
+        bool ok = false;
+        TurnTiming timing;
+        std::optional<TokenUsage> usage;
+    };
+
+    struct Result {
+        Target target;
+        std::string model_name; // As reported by the model
+        std::vector<Sample> samples;
+    };
+
+    // Creates a fresh model for `target`, or nullptr on errors. Called on the calling thread only.
+    using ModelFactory = std::function<std::unique_ptr<IAIModel>(const Target& target)>;
+
+    // Sends every prompt `runs` times to every target. Returns empty if a model could not be created.
+    static std::optional<std::vector<Result>> run(const std::vector<Target>& targets, const std::vector<std::string>& prompts, size_t runs,
+                                                  size_t concurrency, const ModelFactory& create_model);
+
+    // A small fixed prompt set of short, list, code and long-form answers.
+    static std::vector<std::string> defaultPrompts();
+
+    // Parses "provider/model" (or just "provider"); empty if malformed.
+    static std::optional<Target> parseTarget(const std::string& spec);
+
+    // A plain-text comparison table with error rate and p50/p90/p99 of TTFT, total latency and tokens/s.
+    static std::string formatTable(const std::vector<Result>& results);
+
+    // The same statistics as a JSON report.
+    static nlohmann::ordered_json toJson(const std::vector<Result>& results, size_t prompt_count, size_t runs, size_t concurrency);
+};
+
+#endif // HAICL_MODEL_BENCHMARK_H
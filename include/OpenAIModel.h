@@ -2,23 +2,105 @@
 #define HAICL_OPENAI_MODEL_H
 
 #include "IAIModel.h"
+#include "BpeTokenizer.h"
 #include "HttpClient.h"
+#include "JsonWriter.h"
+#include "MessagePrefixCache.h"
 #include "json.hpp"
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 
 class OpenAIModel : public IAIModel {
 public:
-    OpenAIModel(const std::string& api_key, const std::string& base_url, const std::string& model_name);
+    // api_mode: "chat" for stateless /chat/completions, or "responses" for /responses with
+    // server-side conversation state chained through previous_response_id.
+    // system_prompt: Optional instructions always sent first, ahead of the conversation.
+    //
+    // Request bodies are laid out deterministically (fixed key order, system prompt first,
+    // parameters serialized once) so consecutive turns share a byte-identical prefix and
+    // qualify for provider-side prompt caching.
+    OpenAIModel(const std::string& api_key, const std::string& base_url, const std::string& model_name, const std::string& api_mode = "chat", const std::string& system_prompt = "");
 
-    std::optional<Message> sendMessage(const std::vector<Message>& messages, const std::map<std::string, std::string>& model_params) override;
+    std::optional<Message> sendMessage(const std::vector<Message>& messages, const GenerationParams& params) override;
+    // Chat completions return all `n` choices; the Responses API produces a single reply.
+    std::optional<std::vector<Message>> sendMessageCandidates(const std::vector<Message>& messages, const GenerationParams& params) override;
+    // Streams chat completions; the Responses API delivers its reply as a single delta.
+    // Tool calls are not streamed, so tool turns must use sendMessage().
+    std::optional<Message> sendMessageStreaming(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback& on_delta) override;
+    void invalidateConversationCache(size_t first_changed_index = 0) override;
+    nlohmann::json exportConversationState() const override;
+    void importConversationState(const nlohmann::json& state) override;
+    std::optional<TokenUsage> lastUsage() const override;
+    // Supported with chat completions only.
+    bool setTools(const std::vector<ToolDefinition>& tools) override;
+    std::string modelName() const override { return model_name_; }
+    std::string providerName() const override { return "openai"; }
+    std::string cacheScope() const override { return base_url_ + "\n" + system_prompt_; }
+
+    std::optional<EmbeddingMatrix> embedBatch(const std::vector<std::string>& texts) override;
+    std::string embeddingModelName() const override { return embedding_model_; }
+    // Selects the embeddings model and, optionally, a different OpenAI-compatible server for /embeddings.
+    // base64_encoding: Request encoding_format=base64 (compact; not supported by every compatible server).
+    void setEmbeddingModel(const std::string& model_name, const std::string& base_url = "", bool base64_encoding = false);
+
+    // Uses `tokenizer` (a loaded rank file matching this model's encoding) for countTokens(), which
+    // then stands in for the usage of replies whose server reported none (e.g. compatible servers).
+    void setTokenizer(std::shared_ptr<BpeTokenizer> tokenizer);
+    // Counts the prompt tokens `messages` (plus the configured system prompt) occupy in a chat
+    // completions request, including the per-message framing. Returns nullopt without a tokenizer.
+    std::optional<size_t> countTokens(const std::vector<Message>& messages) const;
 
 private:
     std::string api_key_;
     std::string base_url_;
     std::string model_name_;
+    bool use_responses_api_;
+    std::string system_prompt_;
+    // Encoded system message, spliced in front of every chat completions request.
+    std::string system_prompt_fragment_;
+    std::optional<TokenUsage> last_usage_;
     HttpClient http_client_;
+    GenerationParamsFragment params_fragment_;
+    // Serialized "tools" member, spliced into every chat completions request (empty without tools).
+    std::string tools_fragment_;
+    GenerationParamsFragment responses_params_fragment_;
+    MessagePrefixCache message_cache_;
+    std::shared_ptr<BpeTokenizer> tokenizer_;
+    std::string embedding_model_ = "text-embedding-3-small";
+    std::string embedding_base_url_;
+    bool embedding_base64_ = false;
+
+    // A stored response on the server, covering the first `message_count` conversation messages
+    // (including the assistant reply it produced).
+    struct ResponseLink {
+        size_t message_count;
+        std::string response_id;
+    };
+    // Ordered by message_count; the last link is the newest resumable point.
+    std::vector<ResponseLink> response_chain_;
+
+    // Serializes a chat completions request; `stream` asks for server-sent events.
+    std::string buildChatRequest(const std::vector<Message>& messages, const GenerationParams& params, bool stream);
+    std::optional<std::vector<Message>> sendChatCompletion(const std::vector<Message>& messages, const GenerationParams& params);
+    std::optional<Message> sendResponse(const std::vector<Message>& messages, const GenerationParams& params);
+    // Sends messages[first_message..] chained to `previous_response_id` (full replay if empty).
+    std::optional<Message> postResponse(const std::vector<Message>& messages, size_t first_message, const std::string& previous_response_id, const GenerationParams& params);
+    std::map<std::string, std::string> requestHeaders() const;
+    // If the server reported no usage for `replies`, counts it with the tokenizer (if any).
+    void countMissingUsage(const std::vector<Message>& messages, const std::vector<Message>& replies);
+
+    // Reads one chat completions choice: its text and/or tool calls.
+    static std::optional<Message> parseChoice(std::string_view choice);
+
+    // Decodes the embeddings of a /embeddings reply (float arrays or base64) into rows
+    // [first_row, first_row + count) of `matrix`.
+    static bool parseEmbeddings(const std::string& raw_response, size_t first_row, size_t count, EmbeddingMatrix& matrix);
+
+    // Serializes `params` into this provider's wire fields, reused across requests.
+    static std::string serializeParams(const GenerationParams& params);
+    static std::string serializeResponsesParams(const GenerationParams& params);
 };
 
 #endif // HAICL_OPENAI_MODEL_H
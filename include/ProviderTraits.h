@@ -0,0 +1,468 @@
+#ifndef HAICL_PROVIDER_TRAITS_H
+#define HAICL_PROVIDER_TRAITS_H
+
+#include <optional>
+#include <string_view>
+#include "GenerationParams.h"
+#include "IAIModel.h"
+#include "JsonExtractor.h"
+#include "JsonWriter.h"
+#include "UsageStats.h"
+
+// Compile-time descriptions of the providers' wire formats: endpoint, role names, how messages are
+// written, the field names of the sampling parameters and where responses carry token usage and reply text. The helpers below
+// are instantiated once per provider, so the per-provider differences are resolved by the compiler
+// instead of being written out (or looked up) again in every model.
+namespace ProviderTraits {
+
+// The message roles of a conversation, classified once per message (see roleOf()).
+enum class Role { User, Assistant, System, Tool };
+
+// How a message's text is written: a "content" string, a "parts" array of {"text"} objects (Gemini),
+// or a "content" array of {"type", "text"} objects (Realtime conversation items).
+enum class ContentFormat { Text, Parts, TypedParts };
+
+// How tool calls and their results are written: not at all, as "tool_calls" plus "tool" role
+// messages (OpenAI), or as functionCall/functionResponse parts (Gemini).
+enum class ToolCallFormat { None, Messages, Parts };
+
+// Everything a provider does not override is unsupported: an empty parameter name means the
+// parameter is not sent, an empty path that the provider does not report the value.
+struct Defaults {
+    static constexpr std::string_view user_role = "user";
+    static constexpr std::string_view assistant_role = "assistant";
+    static constexpr std::string_view system_role = "system";
+    static constexpr std::string_view tool_role = "tool";
+
+    static constexpr ContentFormat content_format = ContentFormat::Text;
+    static constexpr ToolCallFormat tool_call_format = ToolCallFormat::None;
+    // TypedParts: the part type of user/system text and of assistant text.
+    static constexpr std::string_view input_text_type = "";
+    static constexpr std::string_view output_text_type = "";
+
+    static constexpr std::string_view temperature = "";
+    static constexpr std::string_view top_p = "";
+    static constexpr std::string_view top_k = "";
+    static constexpr std::string_view max_tokens = "";
+    static constexpr std::string_view candidate_count = "";
+    static constexpr std::string_view seed = "";
+    static constexpr std::string_view presence_penalty = "";
+    static constexpr std::string_view frequency_penalty = "";
+    static constexpr std::string_view stop = "";
+
+    // Usage is reported when prompt_tokens is present (completion_tokens if prompt_tokens_optional).
+    static constexpr JsonPath prompt_tokens{};
+    static constexpr JsonPath completion_tokens{};
+    static constexpr bool prompt_tokens_optional = false;
+    static constexpr JsonPath cached_tokens{};
+    static constexpr JsonPath cached_tokens_fallback{};
+
+    // Text of a non-streamed reply and of one streamed event.
+    static constexpr JsonPath reply_text{};
+    static constexpr JsonPath stream_text{};
+    // Set (not null or false) in the last event of a complete streamed reply.
+    static constexpr JsonPath stream_finish{};
+};
+
+struct OpenAIChat : Defaults {
+    static constexpr std::string_view endpoint = "/chat/completions";
+    static constexpr ToolCallFormat tool_call_format = ToolCallFormat::Messages;
+
+    static constexpr std::string_view temperature = "temperature";
+    static constexpr std::string_view top_p = "top_p";
+    // Not part of the OpenAI API, but accepted by many compatible servers.
+    static constexpr std::string_view top_k = "top_k";
+    static constexpr std::string_view max_tokens = "max_tokens";
+    static constexpr std::string_view candidate_count = "n";
+    static constexpr std::string_view seed = "seed";
+    static constexpr std::string_view presence_penalty = "presence_penalty";
+    static constexpr std::string_view frequency_penalty = "frequency_penalty";
+    static constexpr std::string_view stop = "stop";
+
+    static constexpr JsonPath prompt_tokens{"usage", "prompt_tokens"};
+    static constexpr JsonPath completion_tokens{"usage", "completion_tokens"};
+    // OpenAI reports cache hits under prompt_tokens_details; DeepSeek-style servers use prompt_cache_hit_tokens.
+    static constexpr JsonPath cached_tokens{"usage", "prompt_tokens_details", "cached_tokens"};
+    static constexpr JsonPath cached_tokens_fallback{"usage", "prompt_cache_hit_tokens"};
+
+    static constexpr JsonPath stream_text{"choices", 0, "delta", "content"};
+    static constexpr JsonPath stream_finish{"choices", 0, "finish_reason"};
+};
+
+// The Responses API has no n/stop/seed/penalty fields; those are chat-completions only.
+struct OpenAIResponses : Defaults {
+    static constexpr std::string_view endpoint = "/responses";
+
+    static constexpr std::string_view temperature = "temperature";
+    static constexpr std::string_view top_p = "top_p";
+    static constexpr std::string_view max_tokens = "max_output_tokens";
+
+    static constexpr JsonPath prompt_tokens{"usage", "input_tokens"};
+    static constexpr JsonPath completion_tokens{"usage", "output_tokens"};
+    static constexpr JsonPath cached_tokens{"usage", "input_tokens_details", "cached_tokens"};
+
+    static constexpr JsonPath reply_text{"output", 0, "content", 0, "text"};
+};
+
+// Realtime API sessions in text mode: per-response settings of response.create, usage in response.done.
+struct OpenAIRealtime : Defaults {
+    // Tool results are not supported; anything but assistant and system text is sent as user input.
+    static constexpr std::string_view tool_role = "user";
+    static constexpr ContentFormat content_format = ContentFormat::TypedParts;
+    static constexpr std::string_view input_text_type = "input_text";
+    static constexpr std::string_view output_text_type = "text";
+    static constexpr std::string_view temperature = "temperature";
+    static constexpr std::string_view max_tokens = "max_response_output_tokens";
+
+    static constexpr JsonPath prompt_tokens{"response", "usage", "input_tokens"};
+    static constexpr JsonPath completion_tokens{"response", "usage", "output_tokens"};
+    static constexpr JsonPath cached_tokens{"response", "usage", "input_token_details", "cached_tokens"};
+
+    static constexpr JsonPath stream_text{"delta"};
+};
+
+// Parameters go inside "generationConfig".
+struct Gemini : Defaults {
+    static constexpr std::string_view endpoint = ":generateContent";
+    static constexpr std::string_view stream_endpoint = ":streamGenerateContent?alt=sse";
+    // Contents only know "user" and "model"; tool results go back in a user turn.
+    static constexpr std::string_view assistant_role = "model";
+    static constexpr std::string_view system_role = "user";
+    static constexpr std::string_view tool_role = "user";
+    static constexpr ContentFormat content_format = ContentFormat::Parts;
+    static constexpr ToolCallFormat tool_call_format = ToolCallFormat::Parts;
+
+    static constexpr std::string_view temperature = "temperature";
+    static constexpr std::string_view top_p = "topP";
+    static constexpr std::string_view top_k = "topK";
+    static constexpr std::string_view max_tokens = "maxOutputTokens";
+    static constexpr std::string_view candidate_count = "candidateCount";
+    static constexpr std::string_view seed = "seed";
+    static constexpr std::string_view presence_penalty = "presencePenalty";
+    static constexpr std::string_view frequency_penalty = "frequencyPenalty";
+    static constexpr std::string_view stop = "stopSequences";
+
+    static constexpr JsonPath prompt_tokens{"usageMetadata", "promptTokenCount"};
+    static constexpr JsonPath completion_tokens{"usageMetadata", "candidatesTokenCount"};
+    static constexpr JsonPath cached_tokens{"usageMetadata", "cachedContentTokenCount"};
+
+    static constexpr JsonPath stream_finish{"candidates", 0, "finishReason"};
+};
+
+// Parameters go inside "options".
+struct Ollama : Defaults {
+    static constexpr std::string_view endpoint = "/api/chat";
+
+    static constexpr std::string_view temperature = "temperature";
+    static constexpr std::string_view top_p = "top_p";
+    static constexpr std::string_view top_k = "top_k";
+    static constexpr std::string_view max_tokens = "num_predict";
+    static constexpr std::string_view seed = "seed";
+    static constexpr std::string_view presence_penalty = "presence_penalty";
+    static constexpr std::string_view frequency_penalty = "frequency_penalty";
+    static constexpr std::string_view stop = "stop";
+
+    // Ollama omits prompt_eval_count when the whole prompt came from its cache.
+    static constexpr JsonPath prompt_tokens{"prompt_eval_count"};
+    static constexpr JsonPath completion_tokens{"eval_count"};
+    static constexpr bool prompt_tokens_optional = true;
+
+    static constexpr JsonPath reply_text{"message", "content"};
+    static constexpr JsonPath stream_text{"message", "content"};
+    static constexpr JsonPath stream_finish{"done"};
+};
+
+// llama.cpp's server (llama-server), OpenAI-compatible chat completions plus its native fields.
+struct LlamaCpp : Defaults {
+    static constexpr std::string_view endpoint = "/v1/chat/completions";
+
+    static constexpr std::string_view temperature = "temperature";
+    static constexpr std::string_view top_p = "top_p";
+    static constexpr std::string_view top_k = "top_k";
+    static constexpr std::string_view max_tokens = "n_predict";
+    static constexpr std::string_view seed = "seed";
+    static constexpr std::string_view presence_penalty = "presence_penalty";
+    static constexpr std::string_view frequency_penalty = "frequency_penalty";
+    static constexpr std::string_view stop = "stop";
+
+    static constexpr JsonPath prompt_tokens{"usage", "prompt_tokens"};
+    static constexpr JsonPath completion_tokens{"usage", "completion_tokens"};
+    // Prompt tokens served from the KV cache (cache_prompt).
+    static constexpr JsonPath cached_tokens{"timings", "cache_n"};
+
+    static constexpr JsonPath reply_text{"choices", 0, "message", "content"};
+    static constexpr JsonPath stream_text{"choices", 0, "delta", "content"};
+    static constexpr JsonPath stream_finish{"choices", 0, "finish_reason"};
+};
+
+// Classifies a Message role with at most one comparison (the known roles differ in length).
+// Gemini replies carry "model"; unknown roles are treated as the user's.
+constexpr Role roleOf(std::string_view role) {
+    switch (role.size()) {
+    case 4:
+        return role == "tool" ? Role::Tool : Role::User;
+    case 5:
+        return role == "model" ? Role::Assistant : Role::User;
+    case 6:
+        return role == "system" ? Role::System : Role::User;
+    case 9:
+        return role == "assistant" ? Role::Assistant : Role::User;
+    default:
+        return Role::User;
+    }
+}
+
+// The provider's name for `role`.
+template <typename Traits>
+constexpr std::string_view wireRole(Role role) {
+    switch (role) {
+    case Role::Assistant:
+        return Traits::assistant_role;
+    case Role::System:
+        return Traits::system_role;
+    case Role::Tool:
+        return Traits::tool_role;
+    default:
+        return Traits::user_role;
+    }
+}
+
+// Writes the tool results [first, last), all answering one assistant turn, as a single message
+// (Gemini sends them back together in one user turn).
+template <typename Traits>
+void encodeToolResults(JsonWriter& writer, const Message* first, const Message* last) {
+    static_assert(Traits::tool_call_format == ToolCallFormat::Parts, "tool results are separate messages in this format");
+    writer.beginObject();
+    writer.key("role");
+    writer.value(Traits::tool_role);
+    writer.key("parts");
+    writer.beginArray();
+    for (const Message* result = first; result != last; ++result) {
+        writer.beginObject();
+        writer.key("functionResponse");
+        writer.beginObject();
+        if (!result->tool_call_id.empty()) {
+            writer.key("id");
+            writer.value(result->tool_call_id);
+        }
+        writer.key("name");
+        writer.value(result->tool_name);
+        writer.key("response");
+        writer.beginObject();
+        writer.key("content");
+        writer.value(result->content);
+        writer.endObject();
+        writer.endObject();
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.endObject();
+}
+
+// Writes the role, text and tool calls of `msg` as members of the current object, for providers that
+// wrap messages in objects of their own (e.g. Realtime conversation items). Not for Gemini tool results.
+template <typename Traits>
+void writeMessageMembers(JsonWriter& writer, const Message& msg, Role role) {
+    writer.key("role");
+    writer.value(wireRole<Traits>(role));
+    if constexpr (Traits::content_format == ContentFormat::Text) {
+        writer.key("content");
+        if (Traits::tool_call_format != ToolCallFormat::None && msg.content.empty() && !msg.tool_calls.empty()) {
+            writer.null(); // A turn of tool calls only
+        } else {
+            writer.value(msg.content);
+        }
+    } else if constexpr (Traits::content_format == ContentFormat::TypedParts) {
+        writer.key("content");
+        writer.beginArray();
+        writer.beginObject();
+        writer.key("type");
+        writer.value(role == Role::Assistant ? Traits::output_text_type : Traits::input_text_type);
+        writer.key("text");
+        writer.value(msg.content);
+        writer.endObject();
+        writer.endArray();
+    } else {
+        writer.key("parts");
+        writer.beginArray();
+        if (!msg.content.empty() || msg.tool_calls.empty()) {
+            writer.beginObject();
+            writer.key("text");
+            writer.value(msg.content);
+            writer.endObject();
+        }
+        if constexpr (Traits::tool_call_format == ToolCallFormat::Parts) {
+            for (const auto& call : msg.tool_calls) {
+                writer.beginObject();
+                writer.key("functionCall");
+                writer.beginObject();
+                if (!call.id.empty()) {
+                    writer.key("id");
+                    writer.value(call.id);
+                }
+                writer.key("name");
+                writer.value(call.name);
+                writer.key("args");
+                writer.rawValue(call.arguments.empty() ? "{}" : call.arguments);
+                writer.endObject();
+                writer.endObject();
+            }
+        }
+        writer.endArray();
+    }
+    if constexpr (Traits::tool_call_format == ToolCallFormat::Messages) {
+        if (!msg.tool_calls.empty()) {
+            writer.key("tool_calls");
+            writer.beginArray();
+            for (const auto& call : msg.tool_calls) {
+                writer.beginObject();
+                writer.key("id");
+                writer.value(call.id);
+                writer.key("type");
+                writer.value("function");
+                writer.key("function");
+                writer.beginObject();
+                writer.key("name");
+                writer.value(call.name);
+                writer.key("arguments");
+                writer.value(call.arguments);
+                writer.endObject();
+                writer.endObject();
+            }
+            writer.endArray();
+        }
+        if (!msg.tool_call_id.empty()) {
+            writer.key("tool_call_id");
+            writer.value(msg.tool_call_id);
+        }
+    }
+}
+
+// Writes `msg` as one element of the provider's message list. Every model encodes its messages
+// through this (directly or as the encoder of its MessagePrefixCache).
+template <typename Traits>
+void encodeMessage(JsonWriter& writer, const Message& msg) {
+    const Role role = roleOf(msg.role);
+    if constexpr (Traits::tool_call_format == ToolCallFormat::Parts) {
+        if (role == Role::Tool) {
+            encodeToolResults<Traits>(writer, &msg, &msg + 1);
+            return;
+        }
+    }
+    writer.beginObject();
+    writeMessageMembers<Traits>(writer, msg, role);
+    writer.endObject();
+}
+
+// Writes the set sampling parameters the provider supports as members of the current object.
+// Structured output and unknown ("extra") parameters are left to the provider.
+template <typename Traits>
+void writeSamplingParams(JsonWriter& writer, const GenerationParams& params) {
+    if constexpr (!Traits::temperature.empty()) {
+        if (params.temperature) {
+            writer.key(Traits::temperature);
+            writer.value(*params.temperature);
+        }
+    }
+    if constexpr (!Traits::top_p.empty()) {
+        if (params.top_p) {
+            writer.key(Traits::top_p);
+            writer.value(*params.top_p);
+        }
+    }
+    if constexpr (!Traits::top_k.empty()) {
+        if (params.top_k) {
+            writer.key(Traits::top_k);
+            writer.value(*params.top_k);
+        }
+    }
+    if constexpr (!Traits::max_tokens.empty()) {
+        if (params.max_tokens) {
+            writer.key(Traits::max_tokens);
+            writer.value(*params.max_tokens);
+        }
+    }
+    if constexpr (!Traits::candidate_count.empty()) {
+        if (params.candidate_count) {
+            writer.key(Traits::candidate_count);
+            writer.value(*params.candidate_count);
+        }
+    }
+    if constexpr (!Traits::seed.empty()) {
+        if (params.seed) {
+            writer.key(Traits::seed);
+            writer.value(*params.seed);
+        }
+    }
+    if constexpr (!Traits::presence_penalty.empty()) {
+        if (params.presence_penalty) {
+            writer.key(Traits::presence_penalty);
+            writer.value(*params.presence_penalty);
+        }
+    }
+    if constexpr (!Traits::frequency_penalty.empty()) {
+        if (params.frequency_penalty) {
+            writer.key(Traits::frequency_penalty);
+            writer.value(*params.frequency_penalty);
+        }
+    }
+    if constexpr (!Traits::stop.empty()) {
+        if (!params.stop.empty()) {
+            writer.key(Traits::stop);
+            writer.beginArray();
+            for (const auto& sequence : params.stop) {
+                writer.value(sequence);
+            }
+            writer.endArray();
+        }
+    }
+}
+
+// True if the stream event `data` ends a complete reply: it carries a finish reason (or done flag),
+// or is the "[DONE]" sentinel of OpenAI-style streams. A stream that stops without such an event was
+// cut off, even if the connection closed cleanly.
+template <typename Traits>
+bool isFinalStreamEvent(std::string_view data) {
+    static_assert(!Traits::stream_finish.empty(), "provider does not mark the end of a stream");
+    if (data == "[DONE]") {
+        return true;
+    }
+    std::optional<std::string_view> finish = JsonExtractor::findValue(data, Traits::stream_finish);
+    return finish && *finish != "null" && *finish != "false";
+}
+
+// Token usage from a response body or stream event; empty if it carries none.
+template <typename Traits>
+std::optional<TokenUsage> parseUsage(std::string_view raw_response) {
+    static_assert(!Traits::prompt_tokens.empty() && !Traits::completion_tokens.empty(), "provider does not report usage");
+    TokenUsage usage;
+    if constexpr (Traits::prompt_tokens_optional) {
+        std::optional<long long> completion_tokens = JsonExtractor::getInteger(raw_response, Traits::completion_tokens);
+        if (!completion_tokens) {
+            return std::nullopt;
+        }
+        usage.completion_tokens = *completion_tokens;
+        usage.prompt_tokens = JsonExtractor::getInteger(raw_response, Traits::prompt_tokens).value_or(0);
+    } else {
+        std::optional<long long> prompt_tokens = JsonExtractor::getInteger(raw_response, Traits::prompt_tokens);
+        if (!prompt_tokens) {
+            return std::nullopt;
+        }
+        usage.prompt_tokens = *prompt_tokens;
+        usage.completion_tokens = JsonExtractor::getInteger(raw_response, Traits::completion_tokens).value_or(0);
+    }
+    if constexpr (!Traits::cached_tokens.empty()) {
+        std::optional<long long> cached = JsonExtractor::getInteger(raw_response, Traits::cached_tokens);
+        if constexpr (!Traits::cached_tokens_fallback.empty()) {
+            if (!cached) {
+                cached = JsonExtractor::getInteger(raw_response, Traits::cached_tokens_fallback);
+            }
+        }
+        usage.cached_tokens = cached.value_or(0);
+    }
+    return usage;
+}
+
+} // namespace ProviderTraits
+
+#endif // HAICL_PROVIDER_TRAITS_H
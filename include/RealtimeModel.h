@@ -0,0 +1,64 @@
+#ifndef HAICL_REALTIME_MODEL_H
+#define HAICL_REALTIME_MODEL_H
+
+#include "IAIModel.h"
+#include "WebSocketClient.h"
+#include <string>
+#include <vector>
+
+// The OpenAI Realtime API in text mode, over one WebSocket kept open across turns. The conversation
+// lives in the server-side session, so a turn only sends the messages the session has not seen yet and
+// a response.create event instead of a new HTTP request with the whole history. Messages that no
+// longer match the local history (edited, trimmed, dropped turns) are deleted from the session; after
+// a lost connection the next turn reconnects and replays the conversation.
+class RealtimeModel : public IAIModel {
+public:
+    // url: WebSocket endpoint (e.g. wss://api.openai.com/v1/realtime); "model=<model_name>" is added
+    // to its query. system_prompt: Optional session instructions.
+    RealtimeModel(const std::string& api_key, const std::string& url, const std::string& model_name, const std::string& system_prompt = "");
+
+    std::optional<Message> sendMessage(const std::vector<Message>& messages, const GenerationParams& params) override;
+    std::optional<Message> sendMessageStreaming(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback& on_delta) override;
+    void invalidateConversationCache(size_t first_changed_index = 0) override;
+    std::optional<TokenUsage> lastUsage() const override { return last_usage_; }
+    std::string modelName() const override { return model_name_; }
+    std::string providerName() const override { return "realtime"; }
+    std::string cacheScope() const override { return url_ + "\n" + system_prompt_; }
+
+private:
+    std::string api_key_;
+    std::string url_;
+    std::string model_name_;
+    std::string system_prompt_;
+    WebSocketClient socket_;
+    // The session's conversation items, in order, and their ids.
+    std::vector<Message> synced_;
+    std::vector<std::string> synced_ids_;
+    // Items from this index on must be replaced even if they look unchanged.
+    size_t stale_from_ = static_cast<size_t>(-1);
+    // Numbers the ids of client-created items and events.
+    size_t next_id_ = 0;
+    std::optional<TokenUsage> last_usage_;
+    GenerationParamsFragment params_fragment_;
+
+    // Sends the conversation, streaming the reply to `on_delta` if set.
+    std::optional<Message> send(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback* on_delta);
+    // Connects and configures a new, empty session.
+    bool openSession();
+    void closeSession();
+    // Makes the session's conversation equal to `messages`, sending only what differs.
+    bool syncConversation(const std::vector<Message>& messages);
+    // Stops the response being generated and waits for its end, so the session stays usable.
+    void cancelResponse(std::string reply_item_id);
+    // Removes an item from the session; failures are ignored.
+    bool deleteItem(const std::string& item_id);
+    std::string nextId(const char* kind);
+
+    // Serializes `params` into response.create's "response" members, reused across requests.
+    static std::string serializeParams(const GenerationParams& params);
+    // True for errors caused by cancel or delete events, which may fail harmlessly (e.g. the
+    // response had already ended).
+    static bool isBestEffortError(std::string_view event);
+};
+
+#endif // HAICL_REALTIME_MODEL_H
@@ -0,0 +1,58 @@
+#ifndef HAICL_RESPONSE_CACHE_H
+#define HAICL_RESPONSE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+#include "IAIModel.h"
+
+// Content-addressed on-disk cache of model replies.
+//
+// Entries are keyed by the SHA-256 of (provider, cache scope, model, normalized parameters,
+// messages) and stored as <dir>/<first 2 hex digits>/<remaining 62>.json. Writes go to a
+// temporary file in the same shard and are renamed into place, so concurrent processes never see
+// partial entries. Entries expire after a TTL; when the cache grows past its size limit, the
+// least recently used entries (by file modification time, refreshed on every hit) are evicted.
+class ResponseCache {
+public:
+    struct Stats {
+        size_t lookups = 0;
+        size_t hits = 0;
+        size_t stores = 0;
+
+        double hitRate() const { return lookups > 0 ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0; }
+    };
+
+    // directory: Cache root (see defaultDirectory()).
+    // ttl_seconds: Entries older than this are ignored and removed (0 = never expire).
+    // max_bytes: Size limit enforced by LRU eviction (0 = unbounded).
+    ResponseCache(std::filesystem::path directory, long long ttl_seconds, uintmax_t max_bytes);
+
+    // $XDG_CACHE_HOME/haicl, or ~/.cache/haicl.
+    static std::filesystem::path defaultDirectory();
+
+    // Computes the cache key (64 hex characters) for a request.
+    static std::string makeKey(const IAIModel& model, const GenerationParams& params, const std::vector<Message>& messages);
+
+    std::optional<Message> lookup(const std::string& key);
+    // Stores `reply` under `key`. Failures are reported and otherwise ignored.
+    void store(const std::string& key, const Message& reply);
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    std::filesystem::path directory_;
+    long long ttl_seconds_;
+    uintmax_t max_bytes_;
+    Stats stats_;
+    bool evicted_ = false;
+
+    std::filesystem::path entryPath(const std::string& key) const;
+    // Removes expired entries and, if over the size limit, the least recently used ones.
+    void evict();
+};
+
+#endif // HAICL_RESPONSE_CACHE_H
@@ -0,0 +1,59 @@
+#ifndef HAICL_RESUMING_MODEL_H
+#define HAICL_RESUMING_MODEL_H
+
+#include <memory>
+#include <string_view>
+#include "IAIModel.h"
+
+// IAIModel decorator that carries streamed replies over dropped connections. When a stream breaks
+// after part of the reply has arrived, the text received so far is sent back as the start of the
+// assistant's reply and the model is asked to go on from there, so only the missing rest is generated
+// again instead of the whole reply. The caller sees a single uninterrupted stream.
+//
+// Models that extend a trailing assistant message (see IAIModel::continuesAssistantMessage()) get
+// the partial reply as that message; others additionally get an instruction to continue it, and
+// text they repeat from the end of the partial reply is dropped. When the continuation requests run
+// out, the text received so far is returned as an incomplete reply (see lastReplyIncomplete()).
+class ResumingModel : public IAIModel {
+public:
+    // max_resumes: Continuation requests one reply may take before it counts as failed.
+    ResumingModel(std::unique_ptr<IAIModel> inner, size_t max_resumes);
+
+    std::optional<Message> sendMessage(const std::vector<Message>& messages, const GenerationParams& params) override;
+    std::optional<std::vector<Message>> sendMessageCandidates(const std::vector<Message>& messages, const GenerationParams& params) override;
+    // Replies stopped by `on_delta` or cancelled are not resumed.
+    std::optional<Message> sendMessageStreaming(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback& on_delta) override;
+    std::string modelName() const override { return inner_->modelName(); }
+    std::string providerName() const override { return inner_->providerName(); }
+    std::string replyProviderName() const override { return inner_->replyProviderName(); }
+    std::string replyModelName() const override { return inner_->replyModelName(); }
+    std::string cacheScope() const override { return inner_->cacheScope(); }
+    // Usage added up over the request and its continuation requests.
+    std::optional<TokenUsage> lastUsage() const override { return usage_; }
+    bool lastReplyIncomplete() const override { return incomplete_; }
+    void invalidateConversationCache(size_t first_changed_index = 0) override { inner_->invalidateConversationCache(first_changed_index); }
+    bool setCachedPrefix(size_t message_count) override { return inner_->setCachedPrefix(message_count); }
+    bool setTools(const std::vector<ToolDefinition>& tools) override { return inner_->setTools(tools); }
+    bool continuesAssistantMessage() const override { return inner_->continuesAssistantMessage(); }
+    nlohmann::json exportConversationState() const override { return inner_->exportConversationState(); }
+    void importConversationState(const nlohmann::json& state) override { inner_->importConversationState(state); }
+    std::optional<EmbeddingMatrix> embedBatch(const std::vector<std::string>& texts) override { return inner_->embedBatch(texts); }
+    std::string embeddingModelName() const override { return inner_->embeddingModelName(); }
+
+private:
+    std::unique_ptr<IAIModel> inner_;
+    size_t max_resumes_;
+    std::optional<TokenUsage> usage_;
+    bool incomplete_ = false;
+
+    // Adds the usage of the inner model's last request to usage_.
+    void addInnerUsage();
+
+    // The conversation asking the model to continue `partial`, the cut-off reply to `messages`.
+    std::vector<Message> continuationRequest(const std::vector<Message>& messages, const std::string& partial) const;
+    // Length of the longest start of `continuation` that repeats the end of `partial`, or 0 if it is
+    // too short to be told apart from a coincidence.
+    static size_t repeatedLength(std::string_view partial, std::string_view continuation);
+};
+
+#endif // HAICL_RESUMING_MODEL_H
@@ -0,0 +1,97 @@
+#ifndef HAICL_ROUTER_MODEL_H
+#define HAICL_ROUTER_MODEL_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include "IAIModel.h"
+
+// Sends each request to one of several models, so that short, simple prompts do not pay for the most
+// capable one. The routes are tiers listed from the cheapest (or fastest) model to the most capable;
+// a request goes to the first route that accepts it:
+// - the estimated prompt size fits the route (max_prompt_tokens, by default the model's known
+//   context limit),
+// - the estimated complexity of the latest user message (see complexityScore()) is at most the
+//   route's max_complexity,
+// - the route is in service: a route whose requests keep failing, or whose observed time to the
+//   first token exceeds its max_latency_ms, is paused for a while and then tried again.
+// The last route takes whatever no other route accepted.
+//
+// A request that fails moves on to the next route, unless part of its reply was already delivered.
+// With cascading, replies of all routes but the last are checked before they are delivered (and
+// therefore not streamed): empty or hedging replies and replies that do not match the requested JSON
+// Schema are escalated to the next route as well.
+class RouterModel : public IAIModel {
+public:
+    struct Route {
+        std::string tier; // Shown in notes about routing
+        std::unique_ptr<IAIModel> model;
+        double max_complexity = 1.0;
+        size_t max_prompt_tokens = 0; // 0: the model's known context limit, if any
+        double max_latency_ms = 0.0;  // 0: no limit
+    };
+
+    // routes: At least one, cheapest first.
+    RouterModel(std::vector<Route> routes, bool cascade);
+
+    std::optional<Message> sendMessage(const std::vector<Message>& messages, const GenerationParams& params) override;
+    // Only fails over to the next route; candidates are not checked for escalation.
+    std::optional<std::vector<Message>> sendMessageCandidates(const std::vector<Message>& messages, const GenerationParams& params) override;
+    std::optional<Message> sendMessageStreaming(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback& on_delta) override;
+    // The most capable model: every request may end up there (e.g. for the context budget).
+    std::string modelName() const override { return routes_.back().model->modelName(); }
+    std::string providerName() const override { return "router"; }
+    std::string replyProviderName() const override { return routes_[reply_route_].model->replyProviderName(); }
+    std::string replyModelName() const override { return routes_[reply_route_].model->replyModelName(); }
+    std::string cacheScope() const override;
+    // Usage added up over every route the request went to, escalations included.
+    std::optional<TokenUsage> lastUsage() const override { return usage_; }
+    bool lastReplyIncomplete() const override { return routes_[reply_route_].model->lastReplyIncomplete(); }
+    void invalidateConversationCache(size_t first_changed_index = 0) override;
+    bool setCachedPrefix(size_t message_count) override;
+    // Tools are only offered if every route supports them.
+    bool setTools(const std::vector<ToolDefinition>& tools) override;
+    nlohmann::json exportConversationState() const override;
+    void importConversationState(const nlohmann::json& state) override;
+    // Embeddings come from the first route that supports them.
+    std::optional<EmbeddingMatrix> embedBatch(const std::vector<std::string>& texts) override;
+    std::string embeddingModelName() const override;
+
+    // Estimated difficulty of `prompt` in [0, 1], from its length, whether it contains code and how
+    // many words asking for reasoning, analysis or design work it uses.
+    static double complexityScore(const std::string& prompt);
+    // Why a reply should be escalated (e.g. "empty reply"), or empty if it is acceptable.
+    static std::string rejectionReason(const Message& reply, const GenerationParams& params);
+
+private:
+    // Observed behavior of a route, as exponential moving averages over its requests.
+    struct RouteStats {
+        size_t requests = 0;
+        double error_rate = 0.0;
+        double latency_ms = 0.0; // Time to the first token, or of the whole request if not streamed
+        std::chrono::steady_clock::time_point paused_until;
+    };
+
+    std::vector<Route> routes_;
+    std::vector<RouteStats> stats_;
+    bool cascade_;
+    size_t reply_route_ = 0; // The route that answered, or the last one tried if none did
+    std::optional<TokenUsage> usage_;
+
+    // sendAlongRoutes(), with no usage reported if it fails.
+    std::optional<Message> send(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback* on_delta);
+    // Sends the request along the routes, streaming the reply to `on_delta` if set.
+    std::optional<Message> sendAlongRoutes(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback* on_delta);
+    // The first route to try, or the last one if no other accepts the request.
+    size_t firstRoute(size_t prompt_tokens, double complexity) const;
+    // The next route after `current` that accepts the prompt regardless of its complexity, the last
+    // route if none does, or routes_.size() after the last route.
+    size_t nextRoute(size_t current, size_t prompt_tokens) const;
+    bool accepts(size_t index, size_t prompt_tokens) const;
+    void record(size_t index, bool ok, double latency_ms);
+    // Notes that `index` was tried and adds the usage of its last request to usage_.
+    void addRouteUsage(size_t index);
+};
+
+#endif // HAICL_ROUTER_MODEL_H
@@ -0,0 +1,61 @@
+#ifndef HAICL_SEMANTIC_CACHE_H
+#define HAICL_SEMANTIC_CACHE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "IAIModel.h"
+#include "VectorIndex.h"
+
+// Cache of replies to single-turn prompts, matched by embedding similarity instead of exact text,
+// so near-duplicate questions are answered from earlier replies.
+//
+// Entries are partitioned by everything except the prompt itself (provider, scope, model,
+// embedding model, parameters and system messages). Each partition is a VectorIndex of prompt
+// embeddings whose payloads point at the prompt/reply records in a JSON-lines side file.
+class SemanticCache {
+public:
+    struct Stats {
+        size_t lookups = 0;
+        size_t hits = 0;
+        size_t stores = 0;
+    };
+
+    struct Hit {
+        Message reply;
+        std::string prompt; // The cached prompt that matched
+        float similarity;
+    };
+
+    // min_similarity: Cosine similarity in [-1, 1] a cached prompt needs to be used.
+    SemanticCache(std::filesystem::path directory, float min_similarity);
+
+    // Returns the prompt of `messages` if the request is eligible: any number of system messages
+    // followed by exactly one user message.
+    static std::optional<std::string> promptOf(const std::vector<Message>& messages);
+
+    // Identifies the partition `messages` (an eligible request) belongs to.
+    static std::string partitionKey(const IAIModel& model, const GenerationParams& params, const std::vector<Message>& messages);
+
+    // `embedding` must be unit length (see VectorMath::normalize).
+    std::optional<Hit> lookup(const std::string& partition, const std::vector<float>& embedding);
+    void store(const std::string& partition, const std::vector<float>& embedding, const std::string& prompt, const Message& reply);
+
+    const Stats& stats() const { return stats_; }
+    float minSimilarity() const { return min_similarity_; }
+
+private:
+    std::filesystem::path directory_;
+    float min_similarity_;
+    Stats stats_;
+    std::map<std::string, std::unique_ptr<VectorIndex>> indexes_;
+
+    VectorIndex& index(const std::string& partition);
+    std::filesystem::path recordsPath(const std::string& partition) const;
+};
+
+#endif // HAICL_SEMANTIC_CACHE_H
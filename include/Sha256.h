@@ -0,0 +1,33 @@
+#ifndef HAICL_SHA256_H
+#define HAICL_SHA256_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Incremental SHA-256 (FIPS 180-4), used to derive content-addressed cache keys.
+class Sha256 {
+public:
+    Sha256();
+
+    void update(std::string_view data);
+
+    // Finishes the hash and returns it as 64 lowercase hex characters. The object must not be
+    // updated afterwards.
+    std::string hexDigest();
+
+    // One-shot helper.
+    static std::string hex(std::string_view data);
+
+private:
+    std::array<uint32_t, 8> state_;
+    std::array<unsigned char, 64> buffer_;
+    size_t buffer_size_ = 0;
+    uint64_t total_bytes_ = 0;
+
+    void processBlock(const unsigned char* block);
+};
+
+#endif // HAICL_SHA256_H
@@ -0,0 +1,30 @@
+#ifndef HAICL_SSE_PARSER_H
+#define HAICL_SSE_PARSER_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Incremental parser for server-sent events (text/event-stream), the format of streamed replies.
+// Response bytes are fed as they arrive, split at arbitrary points; the data of every complete
+// event (multi-line data joined with '\n') is handed to the callback.
+class SseParser {
+public:
+    // Returning false stops parsing; feed() then returns false as well.
+    using EventCallback = std::function<bool(std::string_view data)>;
+
+    explicit SseParser(EventCallback on_event);
+
+    // Parses `bytes`, dispatching every event completed by them.
+    bool feed(std::string_view bytes);
+
+private:
+    EventCallback on_event_;
+    std::string pending_; // Start of an incomplete line
+    std::string data_;    // Data of the event being read
+    bool has_data_ = false;
+
+    bool processLine(std::string_view line);
+};
+
+#endif // HAICL_SSE_PARSER_H
@@ -0,0 +1,60 @@
+#ifndef HAICL_STOP_CONDITION_H
+#define HAICL_STOP_CONDITION_H
+
+#include <cstddef>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Client-side end conditions for a streamed reply, checked on every piece as it arrives so the request
+// can be closed (and stops being generated and billed) as soon as the wanted part is complete.
+class StopCondition {
+public:
+    struct Rules {
+        // The reply ends before the first occurrence of any of these (like the providers' native "stop").
+        std::vector<std::string> stop_strings;
+        // The reply ends before the first match; matched against one line at a time.
+        std::optional<std::regex> stop_regex;
+        // The reply ends after this many characters (UTF-8 code points); 0 = unlimited.
+        size_t max_chars = 0;
+        // The reply ends with the closing fence of its first fenced code block (``` or ~~~).
+        bool first_code_block = false;
+
+        bool active() const { return !stop_strings.empty() || stop_regex || max_chars > 0 || first_code_block; }
+    };
+
+    // `rules` must outlive the condition.
+    explicit StopCondition(const Rules& rules);
+
+    // Appends the next piece of the reply. Returns false once a condition is met; the rest is ignored.
+    bool feed(std::string_view delta);
+
+    bool stopped() const { return stopped_; }
+
+    // The reply so far, cut where a condition was met.
+    const std::string& text() const { return text_; }
+
+    // Describes the condition that was met (e.g. "stop sequence \"###\""), or empty.
+    const std::string& reason() const { return reason_; }
+
+    // Applies `rules` to a complete reply; returns true and cuts `text` if a condition is met.
+    static bool truncate(const Rules& rules, std::string& text, std::string* reason = nullptr);
+
+private:
+    const Rules& rules_;
+    std::string text_;
+    size_t longest_stop_ = 0;
+    size_t line_start_ = 0;      // Offset of the line being received
+    size_t chars_ = 0;           // UTF-8 characters received
+    size_t fence_length_ = 0;    // Fence characters opening the current code block (0 = outside)
+    char fence_char_ = '`';
+    bool stopped_ = false;
+    std::string reason_;
+
+    // Checks the complete line [begin, end); may lower `cut`.
+    void checkLine(size_t begin, size_t end, size_t& cut, std::string& reason);
+};
+
+#endif // HAICL_STOP_CONDITION_H
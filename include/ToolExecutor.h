@@ -0,0 +1,58 @@
+#ifndef HAICL_TOOL_EXECUTOR_H
+#define HAICL_TOOL_EXECUTOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "IAIModel.h"
+
+// A tool implemented by a local program. The call's arguments (a JSON object) are written to the
+// program's standard input; whatever it prints (stdout and stderr) becomes the result.
+struct LocalTool {
+    ToolDefinition definition;
+    std::vector<std::string> command; // argv; command[0] is looked up in PATH
+    std::chrono::milliseconds timeout;
+};
+
+// Runs the tool calls of a model reply on a fixed pool of worker threads, so calls returned together
+// execute concurrently and the whole batch takes as long as its slowest call, not the sum of all.
+// Every call is bounded by its tool's timeout, after which the program is killed.
+class ToolExecutor {
+public:
+    // worker_count: Maximum number of tool programs running at once.
+    // max_rounds: Tool-call round trips allowed per user turn before giving up on a final answer.
+    ToolExecutor(std::vector<LocalTool> tools, size_t worker_count, size_t max_rounds);
+    ~ToolExecutor();
+
+    ToolExecutor(const ToolExecutor&) = delete;
+    ToolExecutor& operator=(const ToolExecutor&) = delete;
+
+    // The definitions to offer to the model (see IAIModel::setTools()).
+    std::vector<ToolDefinition> definitions() const;
+    size_t maxRounds() const { return max_rounds_; }
+
+    // Runs every call and waits for all of them. Returns one "tool" message per call, in call order.
+    // Failures (unknown tool, timeout, non-zero exit status) are reported to the model in the result.
+    std::vector<Message> run(const std::vector<ToolCall>& calls);
+
+private:
+    std::vector<LocalTool> tools_;
+    size_t max_rounds_;
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable work_available_;
+    std::deque<std::function<void()>> queue_;
+    bool stopping_ = false;
+
+    void workerLoop();
+    Message runOne(const ToolCall& call) const;
+};
+
+#endif // HAICL_TOOL_EXECUTOR_H
@@ -0,0 +1,27 @@
+#ifndef HAICL_USAGE_LEDGER_H
+#define HAICL_USAGE_LEDGER_H
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include "UsageStats.h"
+
+// Append-only record of every request's token usage and speed, one file per local day
+// (<dir>/YYYY-MM-DD.jsonl, one JSON object per line) for aggregating consumption over time.
+// Each line is written with a single append, so concurrent HAICL processes can share a ledger.
+class UsageLedger {
+public:
+    explicit UsageLedger(std::filesystem::path directory);
+
+    // $XDG_DATA_HOME/haicl/usage, or ~/.local/share/haicl/usage.
+    static std::filesystem::path defaultDirectory();
+
+    // Appends one request. `usage` is empty if the provider did not report any.
+    void record(const std::string& provider, const std::string& model, const std::optional<TokenUsage>& usage, const TurnTiming& timing);
+
+private:
+    std::filesystem::path directory_;
+    bool warned_ = false; // Write failures are reported once per session
+};
+
+#endif // HAICL_USAGE_LEDGER_H
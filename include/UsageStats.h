@@ -0,0 +1,104 @@
+#ifndef HAICL_USAGE_STATS_H
+#define HAICL_USAGE_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+// Token counts reported by a provider for a single request.
+struct TokenUsage {
+    long long prompt_tokens = 0;
+    long long completion_tokens = 0;
+    // Prompt tokens served from the provider's prompt/context cache (a subset of prompt_tokens).
+    long long cached_tokens = 0;
+
+    // Adds the counts of another request, e.g. one that was part of the same reply.
+    void add(const TokenUsage& other) {
+        prompt_tokens += other.prompt_tokens;
+        completion_tokens += other.completion_tokens;
+        cached_tokens += other.cached_tokens;
+    }
+
+    // Fraction of prompt tokens that were served from cache, in [0, 1].
+    double cacheHitRate() const {
+        return prompt_tokens > 0 ? static_cast<double>(cached_tokens) / static_cast<double>(prompt_tokens) : 0.0;
+    }
+};
+
+// Client-side timing of a single request.
+struct TurnTiming {
+    double total_seconds = 0.0;
+    // Time until the first piece of the reply arrived; empty unless the reply was streamed.
+    std::optional<double> first_token_seconds;
+
+    // Seconds spent generating the completion: after the first token when known, else the whole request.
+    double generationSeconds() const {
+        return first_token_seconds ? total_seconds - *first_token_seconds : total_seconds;
+    }
+
+    // Completion tokens per second of generation, or 0 if it cannot be told.
+    double tokensPerSecond(long long completion_tokens) const {
+        double seconds = generationSeconds();
+        return completion_tokens > 0 && seconds > 0.0 ? static_cast<double>(completion_tokens) / seconds : 0.0;
+    }
+};
+
+// Measures a request from construction to elapsed(). markDelta() is called for every streamed piece
+// of the reply; a reply that arrives as one piece is not counted as streamed.
+class TurnTimer {
+public:
+    TurnTimer() : start_(std::chrono::steady_clock::now()) {}
+
+    void markDelta() {
+        if (deltas_++ == 0) {
+            first_delta_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    TurnTiming elapsed() const {
+        TurnTiming timing;
+        timing.total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+        if (deltas_ > 1) {
+            timing.first_token_seconds = std::chrono::duration<double>(first_delta_ - start_).count();
+        }
+        return timing;
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point first_delta_;
+    size_t deltas_ = 0;
+};
+
+// Accumulates token usage and timing over the requests of a session.
+class SessionUsage {
+public:
+    // `usage` is empty if the provider did not report any.
+    void add(const std::optional<TokenUsage>& usage, const TurnTiming& timing);
+
+    size_t requests() const { return requests_; }
+    // Sums over the requests that reported usage.
+    const TokenUsage& totals() const { return totals_; }
+    double totalSeconds() const { return total_seconds_; }
+    // Mean time to first token over the streamed requests, or empty if there were none.
+    std::optional<double> averageFirstTokenSeconds() const;
+    // Completion tokens per second of generation over the requests that reported usage.
+    double tokensPerSecond() const;
+
+    // The most recent request, if any.
+    const std::optional<TokenUsage>& lastUsage() const { return last_usage_; }
+    const std::optional<TurnTiming>& lastTiming() const { return last_timing_; }
+
+private:
+    size_t requests_ = 0;
+    TokenUsage totals_;
+    double total_seconds_ = 0.0;
+    double first_token_seconds_ = 0.0;
+    size_t streamed_requests_ = 0;
+    double generation_seconds_ = 0.0;
+    long long generated_tokens_ = 0;
+    std::optional<TokenUsage> last_usage_;
+    std::optional<TurnTiming> last_timing_;
+};
+
+#endif // HAICL_USAGE_STATS_H
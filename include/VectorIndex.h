@@ -0,0 +1,55 @@
+#ifndef HAICL_VECTOR_INDEX_H
+#define HAICL_VECTOR_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+// Append-only on-disk index of unit-length embedding vectors, searched by brute force through a
+// read-only memory mapping (see VectorMath::dot).
+//
+// File layout: a 16-byte header ("HVI1", uint32 dimension, 8 reserved bytes) followed by rows of
+// { uint64 payload; float vector[dimension]; } in native byte order. The payload is an opaque
+// value chosen by the caller (e.g. the offset of the cached answer in a side file). Rows are
+// appended under an exclusive file lock, so several processes can share one index.
+class VectorIndex {
+public:
+    struct Match {
+        size_t row;
+        uint64_t payload;
+        float similarity;
+    };
+
+    explicit VectorIndex(std::filesystem::path path);
+    ~VectorIndex();
+
+    VectorIndex(const VectorIndex&) = delete;
+    VectorIndex& operator=(const VectorIndex&) = delete;
+
+    // Returns the row most similar to the unit vector `query`, or empty if the index is empty,
+    // missing or has a different dimension.
+    std::optional<Match> findNearest(const std::vector<float>& query);
+
+    // Appends a unit vector with its payload, creating the file on first use.
+    // Returns false (and reports why) on failure.
+    bool append(const std::vector<float>& vector, uint64_t payload);
+
+    // Number of rows, as of the last search or append.
+    size_t size() const { return rows_; }
+
+private:
+    std::filesystem::path path_;
+    const unsigned char* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    uint32_t dimension_ = 0;
+    size_t rows_ = 0;
+
+    // Maps the current file contents if it grew since the last call. Returns false if there is no usable file.
+    bool refresh();
+    void unmap();
+    size_t rowBytes() const { return sizeof(uint64_t) + static_cast<size_t>(dimension_) * sizeof(float); }
+};
+
+#endif // HAICL_VECTOR_INDEX_H
@@ -0,0 +1,59 @@
+#ifndef HAICL_VECTOR_MATH_H
+#define HAICL_VECTOR_MATH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Row-major matrix of embeddings in one contiguous allocation: row i is the embedding of input i.
+struct EmbeddingMatrix {
+    size_t rows = 0;
+    size_t dimension = 0;
+    std::vector<float> values; // rows * dimension floats
+
+    const float* row(size_t index) const { return values.data() + index * dimension; }
+    float* row(size_t index) { return values.data() + index * dimension; }
+
+    // Copies `embedding` into row `index` (< rows). The first row assigned fixes the dimension and
+    // allocates the matrix; returns false if a later row has a different dimension.
+    bool assignRow(size_t index, const std::vector<float>& embedding) {
+        if (dimension == 0) {
+            dimension = embedding.size();
+            values.assign(rows * dimension, 0.0f);
+        }
+        if (embedding.size() != dimension || index >= rows) {
+            return false;
+        }
+        std::copy(embedding.begin(), embedding.end(), values.begin() + static_cast<std::ptrdiff_t>(index * dimension));
+        return true;
+    }
+};
+
+// Dense float vector kernels for embedding similarity search.
+namespace VectorMath {
+
+struct ScoredRow {
+    size_t row;
+    float score;
+};
+
+// Returns the dot product of `a` and `b` (`size` floats each). Uses AVX2/FMA or SSE where available.
+float dot(const float* a, const float* b, size_t size);
+
+// Scales `vector` to unit length so that dot products equal cosine similarities.
+// Returns false (leaving it unchanged) if its norm is zero or not finite.
+bool normalize(std::vector<float>& vector);
+
+// Normalizes every row of `matrix` in place (rows with a zero norm are left unchanged).
+void normalizeRows(EmbeddingMatrix& matrix);
+
+// Writes the dot product of `query` (matrix.dimension floats) with every row of `matrix` to `scores`.
+void dotRows(const float* query, const EmbeddingMatrix& matrix, std::vector<float>& scores);
+
+// Returns the `k` rows of `matrix` with the highest dot product with `query`, best first.
+// With unit-length rows and query this is a cosine-similarity nearest-neighbour search.
+std::vector<ScoredRow> topK(const float* query, const EmbeddingMatrix& matrix, size_t k);
+
+} // namespace VectorMath
+
+#endif // HAICL_VECTOR_MATH_H
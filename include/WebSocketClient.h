@@ -0,0 +1,54 @@
+#ifndef HAICL_WEB_SOCKET_CLIENT_H
+#define HAICL_WEB_SOCKET_CLIENT_H
+
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+
+// A client WebSocket connection (RFC 6455) exchanging text messages, for APIs that keep a session
+// open across requests. libcurl opens the TCP/TLS connection (CURLOPT_CONNECT_ONLY), so TLS and proxy
+// settings behave as for HttpClient; the opening handshake and the framing are done here.
+// Not thread-safe. Waits honour HttpClient::CancelScope like HTTP requests do.
+class WebSocketClient {
+public:
+    WebSocketClient();
+    ~WebSocketClient();
+    WebSocketClient(const WebSocketClient&) = delete;
+    WebSocketClient& operator=(const WebSocketClient&) = delete;
+
+    // Connects to a ws:// or wss:// URL, sending `headers` with the opening handshake. Closes any
+    // previous connection first. Returns false after reporting the error (silently if cancelled).
+    bool connect(const std::string& url, const std::map<std::string, std::string>& headers);
+
+    bool isOpen() const { return curl_ != nullptr; }
+
+    // Sends `text` as one text message. Returns false and closes the connection on errors.
+    bool sendText(std::string_view text);
+
+    // Waits for the next complete text message, answering pings meanwhile. Returns empty and closes
+    // the connection if it fails or is closed by the server, if nothing arrives for `idle_timeout_ms`
+    // (0 = no limit) or if the wait is cancelled.
+    std::optional<std::string> receiveText(int idle_timeout_ms);
+
+    // Sends a close frame (best effort, without waiting) and releases the connection.
+    void close();
+
+private:
+    void* curl_ = nullptr;  // Connect-only CURL handle
+    std::string received_;  // Bytes received but not consumed as frames yet
+    std::string message_;   // Payload of a fragmented message being assembled
+    std::mt19937 random_;   // Masking keys and the handshake nonce
+
+    // Encodes a single, final, masked client frame.
+    std::string encodeFrame(unsigned char opcode, std::string_view payload);
+    bool sendAll(std::string_view data);
+    // Appends newly received bytes to received_; false on errors, end of stream, timeout or cancellation.
+    bool receiveMore(int timeout_ms);
+    // Waits until the socket is readable (or writable); false on errors, timeout or cancellation.
+    bool waitForSocket(bool for_write, int timeout_ms);
+    void release();
+};
+
+#endif // HAICL_WEB_SOCKET_CLIENT_H
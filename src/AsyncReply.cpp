@@ -0,0 +1,80 @@
+#include "AsyncReply.h"
+#include "HttpClient.h"
+#include <iostream>
+
+ReplyHandle::ReplyHandle(std::shared_ptr<std::atomic<bool>> cancelled, std::shared_future<ReplySummary> result, std::thread worker)
+    : cancelled_(std::move(cancelled)), result_(std::move(result)), worker_(std::move(worker)) {}
+
+ReplyHandle& ReplyHandle::operator=(ReplyHandle&& other) noexcept {
+    if (this != &other) {
+        finish();
+        cancelled_ = std::move(other.cancelled_);
+        result_ = std::move(other.result_);
+        worker_ = std::move(other.worker_);
+    }
+    return *this;
+}
+
+ReplyHandle::~ReplyHandle() {
+    finish();
+}
+
+void ReplyHandle::finish() {
+    if (worker_.joinable()) {
+        cancel();
+        worker_.join();
+    }
+}
+
+void ReplyHandle::cancel() {
+    if (cancelled_) {
+        cancelled_->store(true);
+    }
+}
+
+bool ReplyHandle::done() const {
+    return waitFor(std::chrono::milliseconds(0));
+}
+
+bool ReplyHandle::waitFor(std::chrono::milliseconds timeout) const {
+    return result_.wait_for(timeout) == std::future_status::ready;
+}
+
+const ReplySummary& ReplyHandle::wait() const {
+    return result_.get();
+}
+
+ReplyHandle IAIModel::sendMessageAsync(std::vector<Message> messages, GenerationParams params, DeltaCallback on_delta, CompletionCallback on_complete) {
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    std::promise<ReplySummary> promise;
+    std::shared_future<ReplySummary> result = promise.get_future().share();
+    std::thread worker([this, cancelled, promise = std::move(promise), messages = std::move(messages), params = std::move(params),
+                        on_delta = std::move(on_delta), on_complete = std::move(on_complete)]() mutable {
+        // Also stops requests that have not started streaming yet.
+        HttpClient::CancelScope cancel_scope(cancelled.get());
+        ReplySummary summary;
+        TurnTimer timer;
+        try {
+            summary.reply = sendMessageStreaming(messages, params, [&](std::string_view delta) {
+                if (cancelled->load()) {
+                    return false;
+                }
+                timer.markDelta();
+                return !on_delta || on_delta(delta);
+            });
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Request failed: " << e.what() << std::endl;
+        }
+        summary.timing = timer.elapsed();
+        if (summary.reply) {
+            summary.usage = lastUsage();
+        } else {
+            summary.cancelled = cancelled->load();
+        }
+        if (on_complete) {
+            on_complete(summary);
+        }
+        promise.set_value(std::move(summary));
+    });
+    return ReplyHandle(std::move(cancelled), std::move(result), std::move(worker));
+}
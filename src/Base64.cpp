@@ -0,0 +1,69 @@
+#include "Base64.h"
+#include <cstdint>
+
+namespace {
+
+int base64Value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+} // namespace
+
+namespace Base64 {
+
+bool decode(std::string_view input, std::string& out) {
+    out.clear();
+    out.reserve(input.size() / 4 * 3);
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (char c : input) {
+        if (c == '=') {
+            break;
+        }
+        int value = base64Value(c);
+        if (value < 0) {
+            return false;
+        }
+        buffer = (buffer << 6) | static_cast<uint32_t>(value);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out += static_cast<char>((buffer >> bits) & 0xFF);
+        }
+    }
+    return true;
+}
+
+std::string encode(std::string_view input) {
+    static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((input.size() + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 2 < input.size(); i += 3) {
+        uint32_t triple = (static_cast<uint32_t>(static_cast<unsigned char>(input[i])) << 16) |
+                          (static_cast<uint32_t>(static_cast<unsigned char>(input[i + 1])) << 8) |
+                          static_cast<uint32_t>(static_cast<unsigned char>(input[i + 2]));
+        out += kAlphabet[(triple >> 18) & 0x3F];
+        out += kAlphabet[(triple >> 12) & 0x3F];
+        out += kAlphabet[(triple >> 6) & 0x3F];
+        out += kAlphabet[triple & 0x3F];
+    }
+    if (i < input.size()) {
+        uint32_t triple = static_cast<uint32_t>(static_cast<unsigned char>(input[i])) << 16;
+        if (i + 1 < input.size()) {
+            triple |= static_cast<uint32_t>(static_cast<unsigned char>(input[i + 1])) << 8;
+        }
+        out += kAlphabet[(triple >> 18) & 0x3F];
+        out += kAlphabet[(triple >> 12) & 0x3F];
+        out += i + 1 < input.size() ? kAlphabet[(triple >> 6) & 0x3F] : '=';
+        out += '=';
+    }
+    return out;
+}
+
+} // namespace Base64
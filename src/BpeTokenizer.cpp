@@ -0,0 +1,513 @@
+#include "BpeTokenizer.h"
+#include "Base64.h"
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define HAICL_BPE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+uint64_t hashBytes(std::string_view bytes) {
+    // FNV-1a; pieces are short, so a simple byte loop is fast enough.
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : bytes) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Character classes used by the pre-tokenizer.
+enum class CharClass { Letter, Number, Whitespace, Newline, Other };
+
+// Decodes one UTF-8 code point at `p`; invalid bytes are treated as single-byte code points.
+uint32_t decodeUtf8(const char* p, const char* end, size_t& length) {
+    unsigned char c = static_cast<unsigned char>(*p);
+    if (c < 0x80) {
+        length = 1;
+        return c;
+    }
+    size_t expected = (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xE ? 3 : (c >> 3) == 0x1E ? 4 : 0;
+    if (expected == 0 || static_cast<size_t>(end - p) < expected) {
+        length = 1;
+        return c;
+    }
+    uint32_t code_point = c & (0xFF >> (expected + 1));
+    for (size_t i = 1; i < expected; ++i) {
+        unsigned char next = static_cast<unsigned char>(p[i]);
+        if ((next & 0xC0) != 0x80) {
+            length = 1;
+            return c;
+        }
+        code_point = (code_point << 6) | (next & 0x3F);
+    }
+    length = expected;
+    return code_point;
+}
+
+CharClass classify(uint32_t cp) {
+    if (cp < 0x80) {
+        if ((cp | 0x20) >= 'a' && (cp | 0x20) <= 'z') return CharClass::Letter;
+        if (cp >= '0' && cp <= '9') return CharClass::Number;
+        if (cp == '\n' || cp == '\r') return CharClass::Newline;
+        if (cp == ' ' || cp == '\t' || cp == '\v' || cp == '\f') return CharClass::Whitespace;
+        return CharClass::Other;
+    }
+    // Approximation of the Unicode categories for the most common non-ASCII ranges.
+    if (cp == 0x85 || cp == 0xA0 || cp == 0x1680 || (cp >= 0x2000 && cp <= 0x200A) ||
+        cp == 0x2028 || cp == 0x2029 || cp == 0x202F || cp == 0x205F || cp == 0x3000) {
+        return CharClass::Whitespace;
+    }
+    if ((cp >= 0x80 && cp <= 0xBF && cp != 0xAA && cp != 0xB5 && cp != 0xBA) || cp == 0xD7 || cp == 0xF7 ||
+        (cp >= 0x2010 && cp <= 0x2BFF) || (cp >= 0x3001 && cp <= 0x3003) || (cp >= 0x3008 && cp <= 0x3011) ||
+        (cp >= 0xFF01 && cp <= 0xFF0F) || (cp >= 0xFF1A && cp <= 0xFF20) || (cp >= 0x1F000 && cp <= 0x1FAFF)) {
+        return CharClass::Other;
+    }
+    if ((cp >= 0x0660 && cp <= 0x0669) || (cp >= 0x06F0 && cp <= 0x06F9) || (cp >= 0x0966 && cp <= 0x096F) ||
+        (cp >= 0xFF10 && cp <= 0xFF19)) {
+        return CharClass::Number;
+    }
+    return CharClass::Letter;
+}
+
+// Letter cases used by the o200k pattern, as a bit set: caseless letters (CJK, for example) belong to
+// both the upper-case and the lower-case part of a word.
+constexpr unsigned kUpper = 1;
+constexpr unsigned kLower = 2;
+constexpr unsigned kCaseless = kUpper | kLower;
+
+// Case of a letter; like classify(), an approximation covering Latin, Greek and Cyrillic.
+unsigned letterCase(uint32_t cp) {
+    if (cp < 0x80) {
+        return cp >= 'A' && cp <= 'Z' ? kUpper : kLower;
+    }
+    if (cp >= 0xC0 && cp <= 0xDE) {
+        return kUpper;
+    }
+    if (cp == 0xB5 || (cp >= 0xDF && cp <= 0xFF)) {
+        return kLower;
+    }
+    if (cp >= 0x100 && cp <= 0x17F) {
+        // Latin Extended-A alternates upper/lower pairs; the parity flips after U+0138 and U+0149.
+        bool odd_upper = (cp >= 0x139 && cp <= 0x148) || cp >= 0x179;
+        return ((cp & 1) != 0) == odd_upper ? kUpper : kLower;
+    }
+    if ((cp >= 0x391 && cp <= 0x3AB) || (cp >= 0x400 && cp <= 0x42F) || (cp >= 0xFF21 && cp <= 0xFF3A)) {
+        return kUpper;
+    }
+    if ((cp >= 0x3AC && cp <= 0x3CE) || (cp >= 0x430 && cp <= 0x45F) || (cp >= 0xFF41 && cp <= 0xFF5A)) {
+        return kLower;
+    }
+    if (cp >= 0x460 && cp <= 0x4FF) {
+        return (cp & 1) == 0 ? kUpper : kLower;
+    }
+    return kCaseless;
+}
+
+// Length of the run of ASCII letters of the cases in `cases` starting at `p`, scanned 16 bytes at a time.
+size_t asciiLetterRun(const char* p, const char* end, unsigned cases) {
+    const char* start = p;
+    // Mixed case folds to lower case; a single case is compared as is.
+    const char fold = cases == kCaseless ? 0x20 : 0;
+    const char first = cases == kUpper ? 'A' : 'a';
+    const char last = cases == kUpper ? 'Z' : 'z';
+#ifdef HAICL_BPE_SSE2
+    const __m128i case_bit = _mm_set1_epi8(fold);
+    // Signed compare range check: first - 1 < (c | fold) < last + 1
+    const __m128i below = _mm_set1_epi8(static_cast<char>(first - 1));
+    const __m128i above = _mm_set1_epi8(static_cast<char>(last + 1));
+    for (; p + 16 <= end; p += 16) {
+        __m128i folded = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), case_bit);
+        __m128i is_letter = _mm_and_si128(_mm_cmpgt_epi8(folded, below), _mm_cmplt_epi8(folded, above));
+        int mask = _mm_movemask_epi8(is_letter);
+        if (mask != 0xFFFF) {
+            return static_cast<size_t>(p - start) + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(~mask)));
+        }
+    }
+#endif
+    for (; p < end; ++p) {
+        char folded = static_cast<char>(*p | fold);
+        if (folded < first || folded > last) {
+            break;
+        }
+    }
+    return static_cast<size_t>(p - start);
+}
+
+// Cursor over code points with their classes.
+struct Scanner {
+    const char* begin;
+    const char* end;
+
+    CharClass classAt(const char* p, size_t& length) const {
+        return classify(decodeUtf8(p, end, length));
+    }
+
+    // Advances over letters of the cases in `cases` (ASCII fast path, then general code points).
+    const char* skipLetters(const char* p, unsigned cases = kCaseless) const {
+        while (p < end) {
+            p += asciiLetterRun(p, end, cases);
+            if (p >= end || static_cast<unsigned char>(*p) < 0x80) {
+                break;
+            }
+            size_t length;
+            uint32_t cp = decodeUtf8(p, end, length);
+            if (classify(cp) != CharClass::Letter || (cases != kCaseless && (letterCase(cp) & cases) == 0)) {
+                break;
+            }
+            p += length;
+        }
+        return p;
+    }
+
+    // Length of the contraction ('s 'd 'm 't 'll 've 're, case-insensitive) at `p`, or 0.
+    size_t contractionAt(const char* p) const {
+        if (p + 1 >= end || *p != '\'') {
+            return 0;
+        }
+        char c1 = static_cast<char>(p[1] | 0x20);
+        char c2 = p + 2 < end ? static_cast<char>(p[2] | 0x20) : '\0';
+        if (c1 == 's' || c1 == 'd' || c1 == 'm' || c1 == 't') {
+            return 2;
+        }
+        if ((c1 == 'l' && c2 == 'l') || (c1 == 'v' && c2 == 'e') || (c1 == 'r' && c2 == 'e')) {
+            return 3;
+        }
+        return 0;
+    }
+
+    // End of the word at `p`: all letters for cl100k; for o200k upper-case letters followed by
+    // lower-case ones and an optional contraction. `p` must be at a letter.
+    const char* skipWord(const char* p, bool o200k) const {
+        if (!o200k) {
+            return skipLetters(p);
+        }
+        // [\p{Lu}...]*[\p{Ll}...]+ and [\p{Lu}...]+[\p{Ll}...]* both reduce to the greedy
+        // upper-case run followed by the greedy lower-case run, since caseless letters are in both.
+        p = skipLetters(skipLetters(p, kUpper), kLower);
+        return p + contractionAt(p);
+    }
+
+    bool isWhitespace(CharClass cls) const {
+        return cls == CharClass::Whitespace || cls == CharClass::Newline;
+    }
+};
+
+} // namespace
+
+BpeTokenizer::BpeTokenizer(size_t cache_capacity)
+    : cache_capacity_(cache_capacity) {
+}
+
+bool BpeTokenizer::loadRankFile(const std::string& path) {
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) {
+        std::cerr << "Error: Could not open tokenizer rank file: " << path << std::endl;
+        return false;
+    }
+    std::vector<std::pair<std::string, int32_t>> entries;
+    std::string line;
+    std::string decoded;
+    size_t line_number = 0;
+    while (std::getline(ifs, line)) {
+        ++line_number;
+        if (line.empty()) {
+            continue;
+        }
+        size_t space = line.find(' ');
+        if (space == std::string::npos || !Base64::decode(std::string_view(line).substr(0, space), decoded) || decoded.empty()) {
+            std::cerr << "Error: Malformed tokenizer rank file " << path << " at line " << line_number << std::endl;
+            return false;
+        }
+        try {
+            long long rank = std::stoll(line.substr(space + 1));
+            if (rank < 0 || rank > std::numeric_limits<int32_t>::max()) {
+                throw std::out_of_range("rank");
+            }
+            entries.emplace_back(decoded, static_cast<int32_t>(rank));
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid rank in tokenizer rank file " << path << " at line " << line_number << std::endl;
+            return false;
+        }
+    }
+
+    size_t capacity = 16;
+    while (capacity < entries.size() * 2) {
+        capacity <<= 1;
+    }
+    token_bytes_.clear();
+    slots_.assign(capacity, Slot());
+    slot_mask_ = capacity - 1;
+    token_count_ = 0;
+    for (const auto& entry : entries) {
+        insertRank(entry.first, entry.second);
+    }
+    // cl100k_base has about 100k tokens, o200k_base about 200k.
+    pattern_ = token_count_ >= 150000 ? Pattern::O200k : Pattern::Cl100k;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        lru_.clear();
+        lru_index_.clear();
+    }
+    return true;
+}
+
+void BpeTokenizer::insertRank(std::string_view bytes, int32_t rank) {
+    uint64_t hash = hashBytes(bytes);
+    for (uint64_t i = hash & slot_mask_;; i = (i + 1) & slot_mask_) {
+        Slot& slot = slots_[i];
+        if (slot.rank < 0) {
+            slot.hash = hash;
+            slot.offset = static_cast<uint32_t>(token_bytes_.size());
+            slot.length = static_cast<uint32_t>(bytes.size());
+            slot.rank = rank;
+            token_bytes_.append(bytes.data(), bytes.size());
+            ++token_count_;
+            return;
+        }
+        if (slot.hash == hash && std::string_view(token_bytes_.data() + slot.offset, slot.length) == bytes) {
+            slot.rank = rank; // Duplicate entry; the last one wins
+            return;
+        }
+    }
+}
+
+int32_t BpeTokenizer::rankOf(std::string_view bytes) const {
+    uint64_t hash = hashBytes(bytes);
+    for (uint64_t i = hash & slot_mask_;; i = (i + 1) & slot_mask_) {
+        const Slot& slot = slots_[i];
+        if (slot.rank < 0) {
+            return -1;
+        }
+        if (slot.hash == hash && slot.length == bytes.size() &&
+            std::string_view(token_bytes_.data() + slot.offset, slot.length) == bytes) {
+            return slot.rank;
+        }
+    }
+}
+
+void BpeTokenizer::mergePiece(std::string_view piece, std::vector<uint32_t>& out) const {
+    // boundaries[i] is the start offset of part i; the last entry is piece.size().
+    std::vector<size_t> boundaries(piece.size() + 1);
+    for (size_t i = 0; i <= piece.size(); ++i) {
+        boundaries[i] = i;
+    }
+    // ranks[i] is the rank of merging part i with part i + 1 (or -1).
+    auto pairRank = [&](size_t i) -> int32_t {
+        if (i + 2 >= boundaries.size()) {
+            return -1;
+        }
+        return rankOf(piece.substr(boundaries[i], boundaries[i + 2] - boundaries[i]));
+    };
+    std::vector<int32_t> ranks(boundaries.size());
+    for (size_t i = 0; i < ranks.size(); ++i) {
+        ranks[i] = pairRank(i);
+    }
+    while (boundaries.size() > 2) {
+        int32_t best_rank = -1;
+        size_t best = 0;
+        for (size_t i = 0; i + 2 < boundaries.size(); ++i) {
+            if (ranks[i] >= 0 && (best_rank < 0 || ranks[i] < best_rank)) {
+                best_rank = ranks[i];
+                best = i;
+            }
+        }
+        if (best_rank < 0) {
+            break;
+        }
+        boundaries.erase(boundaries.begin() + static_cast<std::ptrdiff_t>(best) + 1);
+        ranks.erase(ranks.begin() + static_cast<std::ptrdiff_t>(best) + 1);
+        ranks[best] = pairRank(best);
+        if (best > 0) {
+            ranks[best - 1] = pairRank(best - 1);
+        }
+    }
+    for (size_t i = 0; i + 1 < boundaries.size(); ++i) {
+        int32_t rank = rankOf(piece.substr(boundaries[i], boundaries[i + 1] - boundaries[i]));
+        // Every single byte is a token in tiktoken vocabularies; guard against incomplete files anyway.
+        out.push_back(rank >= 0 ? static_cast<uint32_t>(rank) : 0);
+    }
+}
+
+void BpeTokenizer::encodePiece(std::string_view piece, std::vector<uint32_t>& out) {
+    int32_t whole = rankOf(piece);
+    if (whole >= 0) {
+        out.push_back(static_cast<uint32_t>(whole));
+        return;
+    }
+    std::string key(piece);
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        auto it = lru_index_.find(key);
+        if (it != lru_index_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            out.insert(out.end(), it->second->second.begin(), it->second->second.end());
+            return;
+        }
+    }
+    std::vector<uint32_t> tokens;
+    mergePiece(piece, tokens);
+    out.insert(out.end(), tokens.begin(), tokens.end());
+    if (cache_capacity_ == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    if (lru_index_.count(key) != 0) {
+        return; // Another thread cached it meanwhile
+    }
+    lru_.emplace_front(key, std::move(tokens));
+    lru_index_[key] = lru_.begin();
+    if (lru_.size() > cache_capacity_) {
+        lru_index_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+std::vector<uint32_t> BpeTokenizer::encode(std::string_view text) {
+    std::vector<uint32_t> tokens;
+    tokens.reserve(text.size() / 4 + 1);
+    if (!isLoaded()) {
+        return tokens;
+    }
+    for (std::string_view piece : pretokenize(text, pattern_)) {
+        encodePiece(piece, tokens);
+    }
+    return tokens;
+}
+
+size_t BpeTokenizer::count(std::string_view text) {
+    if (!isLoaded()) {
+        return 0;
+    }
+    size_t total = 0;
+    std::vector<uint32_t> merged; // Reused for the few pieces that are not a single token
+    for (std::string_view piece : pretokenize(text, pattern_)) {
+        if (rankOf(piece) >= 0) {
+            ++total;
+            continue;
+        }
+        merged.clear();
+        encodePiece(piece, merged);
+        total += merged.size();
+    }
+    return total;
+}
+
+std::vector<std::string_view> BpeTokenizer::pretokenize(std::string_view text, Pattern pattern) {
+    // Hand-written equivalent of the cl100k_base pattern:
+    //   '(?i:[sdmt]|ll|ve|re) | [^\r\n\p{L}\p{N}]?\p{L}+ | \p{N}{1,3} | ?[^\s\p{L}\p{N}]+[\r\n]*
+    //   | \s*[\r\n] | \s+(?!\S) | \s+
+    // or of the o200k_base one, with <Upper> = [\p{Lu}\p{Lt}\p{Lm}\p{Lo}\p{M}], <Lower> = [\p{Ll}\p{Lm}\p{Lo}\p{M}]
+    // and <contraction> = (?i:'s|'t|'re|'ve|'m|'ll|'d)?:
+    //   [^\r\n\p{L}\p{N}]?<Upper>*<Lower>+<contraction> | [^\r\n\p{L}\p{N}]?<Upper>+<Lower>*<contraction>
+    //   | \p{N}{1,3} | ?[^\s\p{L}\p{N}]+[\r\n/]* | \s*[\r\n]+ | \s+(?!\S) | \s+
+    const bool o200k = pattern == Pattern::O200k;
+    std::vector<std::string_view> pieces;
+    pieces.reserve(text.size() / 4 + 1);
+    Scanner scanner{text.data(), text.data() + text.size()};
+    const char* end = scanner.end;
+    const char* p = scanner.begin;
+
+    while (p < end) {
+        const char* start = p;
+        size_t length;
+        CharClass cls = scanner.classAt(p, length);
+
+        // Contractions: 's 'd 'm 't 'll 've 're (case-insensitive); o200k attaches them to the word instead
+        if (!o200k) {
+            size_t contraction = scanner.contractionAt(p);
+            if (contraction > 0) {
+                pieces.emplace_back(start, contraction);
+                p += contraction;
+                continue;
+            }
+        }
+
+        // Words, optionally preceded by one character that is not a letter, number or newline
+        if (cls == CharClass::Letter) {
+            p = scanner.skipWord(p, o200k);
+            pieces.emplace_back(start, static_cast<size_t>(p - start));
+            continue;
+        }
+        if (cls != CharClass::Number && cls != CharClass::Newline && p + length < end) {
+            size_t next_length;
+            if (scanner.classAt(p + length, next_length) == CharClass::Letter) {
+                p = scanner.skipWord(p + length, o200k);
+                pieces.emplace_back(start, static_cast<size_t>(p - start));
+                continue;
+            }
+        }
+
+        // Up to three digits
+        if (cls == CharClass::Number) {
+            p += length;
+            for (int digits = 1; digits < 3 && p < end; ++digits) {
+                size_t next_length;
+                if (scanner.classAt(p, next_length) != CharClass::Number) {
+                    break;
+                }
+                p += next_length;
+            }
+            pieces.emplace_back(start, static_cast<size_t>(p - start));
+            continue;
+        }
+
+        // Optional space, then punctuation/symbols, then trailing newlines (and slashes for o200k)
+        {
+            const char* q = p;
+            if (*q == ' ' && q + 1 < end) {
+                ++q;
+            }
+            const char* symbols_start = q;
+            while (q < end) {
+                size_t next_length;
+                CharClass next = scanner.classAt(q, next_length);
+                if (next != CharClass::Other) {
+                    break;
+                }
+                q += next_length;
+            }
+            if (q > symbols_start) {
+                while (q < end && (*q == '\r' || *q == '\n' || (o200k && *q == '/'))) {
+                    ++q;
+                }
+                pieces.emplace_back(start, static_cast<size_t>(q - start));
+                p = q;
+                continue;
+            }
+        }
+
+        // Whitespace: up to and including the last newline of the run, otherwise leave the last
+        // whitespace character to attach to the following word.
+        const char* q = p;
+        const char* after_last_newline = nullptr;
+        const char* last_start = p;
+        while (q < end) {
+            size_t next_length;
+            CharClass next = scanner.classAt(q, next_length);
+            if (!scanner.isWhitespace(next)) {
+                break;
+            }
+            last_start = q;
+            q += next_length;
+            if (next == CharClass::Newline) {
+                after_last_newline = q;
+            }
+        }
+        if (after_last_newline) {
+            q = after_last_newline;
+        } else if (q < end && last_start > p) {
+            q = last_start; // \s+(?!\S)
+        }
+        if (q == p) {
+            q = p + length; // Defensive: always make progress
+        }
+        pieces.emplace_back(start, static_cast<size_t>(q - start));
+        p = q;
+    }
+    return pieces;
+}
@@ -13,8 +13,8 @@ CLIParser::CLIParser(int argc, char** argv)
     // Prompt for quick question mode
     app_.add_option("-p,--prompt", args_.prompt, "Quick question to the AI. If provided, interactive mode is skipped.");
 
-    // Model type (e.g., openai, google)
-    app_.add_option("-t,--type", args_.model_type, "Specify AI model type (e.g., openai, google). Overrides config.");
+    // Model type (e.g., openai, google, local, realtime, router)
+    app_.add_option("-t,--type", args_.model_type, "Specify AI model type (e.g., openai, google, local, realtime, router). Overrides config.");
 
     // Model name (e.g., gpt-4, gemini-pro)
     app_.add_option("-m,--model", args_.model_name, "Specify AI model name (e.g., gpt-4, gemini-pro). Overrides config.");
@@ -27,6 +27,54 @@ CLIParser::CLIParser(int argc, char** argv)
 
     // Model parameters (e.g., --param temperature=0.7 --param max_tokens=100)
     app_.add_option("--param", args_.model_params, "Pass model-specific parameters (e.g., --param temperature=0.7).");
+
+    // Multiple candidates per request
+    app_.add_option("-n,--candidates", args_.candidates, "Generate this many alternative replies in one request (same as --param n=N); interactive mode asks which one to keep.")
+        ->check(CLI::PositiveNumber);
+
+    // Token usage reporting
+    app_.add_flag("--stats", args_.show_stats, "Print token usage (including prompt cache hits) per turn and per session.");
+
+    // Response cache
+    app_.add_flag("--no-cache", args_.no_cache, "Do not read or write the on-disk response cache.");
+    app_.add_flag("--refresh", args_.refresh_cache, "Ignore cached responses and replace them with fresh ones.");
+    app_.add_flag("--semantic-cache", args_.semantic_cache, "Also answer near-duplicate single-turn prompts from the cache, matched by embedding similarity.");
+
+    // Tool calling
+    app_.add_flag("--tools", args_.tools, "Let the model call the local tools listed in tools.definitions (run concurrently, results sent back in one request).");
+
+    // Structured output
+    app_.add_option("--json-schema", args_.json_schema_file, "Make the reply a JSON document matching the JSON Schema in this file; it is validated while streaming and regenerated if it diverges.")
+        ->check(CLI::ExistingFile);
+
+    // Stop conditions, checked while the reply streams in; the request is closed as soon as one is met
+    app_.add_option("--stop", args_.stop_strings, "End the reply before this sequence (repeatable). Sent to the provider and also enforced client-side.");
+    app_.add_option("--stop-regex", args_.stop_regex, "End the reply before the first match of this regular expression (ECMAScript, matched per line).");
+    app_.add_option("--max-chars", args_.max_chars, "End the reply after this many characters.")
+        ->check(CLI::PositiveNumber);
+    app_.add_flag("--first-code-block", args_.first_code_block, "End the reply as soon as its first fenced code block is complete.");
+
+    // Conversation compaction
+    app_.add_flag("--compact", args_.compact, "Summarize the oldest turns in the background once the conversation grows past a token threshold (interactive mode).");
+
+    // Token counting
+    app_.add_flag("--count-tokens", args_.count_tokens, "Count the tokens of the prompt (-p) or of standard input and exit.");
+    app_.add_option("--tokenizer", args_.tokenizer_file, "Path to a tiktoken rank file (e.g., cl100k_base.tiktoken) for tokenizer-based token counts. Overrides config.");
+
+    // Model comparison
+    CLI::App* bench = app_.add_subcommand("bench-models", "Compare TTFT, latency, tokens/s and error rate of several models on the same prompts.");
+    // Lets --param and the other global options follow the subcommand.
+    bench->fallthrough();
+    bench->add_option("--target", args_.bench_targets, "Provider and model to benchmark, e.g. openai/gpt-4o-mini (repeatable; a bare provider uses its configured model).")
+        ->required();
+    bench->add_option("--prompts", args_.bench_prompts_file, "File with one prompt per line (default: a built-in prompt set).")
+        ->check(CLI::ExistingFile);
+    bench->add_option("--runs", args_.bench_runs, "Times each prompt is sent to each target.")
+        ->check(CLI::PositiveNumber);
+    bench->add_option("--concurrency", args_.bench_concurrency, "Concurrent requests per target.")
+        ->check(CLI::PositiveNumber);
+    bench->add_option("--report", args_.bench_report_file, "Write the JSON report to this file ('-' prints it instead of the table).");
+    bench->callback([this]() { args_.bench_models = true; });
 }
 
 bool CLIParser::parse() {
@@ -0,0 +1,110 @@
+#include "CachingModel.h"
+#include "JsonSchemaValidator.h"
+#include "VectorMath.h"
+#include <iomanip>
+#include <iostream>
+
+CachingModel::CachingModel(std::unique_ptr<IAIModel> inner, std::shared_ptr<ResponseCache> cache, bool refresh, bool deterministic_only,
+                           std::shared_ptr<SemanticCache> semantic_cache)
+    : inner_(std::move(inner)),
+      cache_(std::move(cache)),
+      semantic_cache_(std::move(semantic_cache)),
+      refresh_(refresh),
+      deterministic_only_(deterministic_only) {
+}
+
+bool CachingModel::isCacheable(const GenerationParams& params) const {
+    return cache_ && (!deterministic_only_ || (params.temperature && *params.temperature == 0.0));
+}
+
+bool CachingModel::isStorable(const Message& reply, const GenerationParams& params) {
+    return params.json_schema.is_null() || JsonSchemaValidator::validate(params.json_schema, reply.content);
+}
+
+bool CachingModel::setTools(const std::vector<ToolDefinition>& tools) {
+    bool supported = inner_->setTools(tools);
+    tools_enabled_ = supported && !tools.empty();
+    return supported;
+}
+
+std::optional<Message> CachingModel::sendMessage(const std::vector<Message>& messages, const GenerationParams& params) {
+    last_was_hit_ = false;
+    if (tools_enabled_) {
+        return inner_->sendMessage(messages, params);
+    }
+    return sendThroughCaches(messages, params, [&]() { return inner_->sendMessage(messages, params); });
+}
+
+std::optional<Message> CachingModel::sendThroughCaches(const std::vector<Message>& messages, const GenerationParams& params,
+                                                       const std::function<std::optional<Message>()>& send) {
+    const bool exact = isCacheable(params);
+    std::string key;
+    if (exact) {
+        key = ResponseCache::makeKey(*inner_, params, messages);
+        if (!refresh_) {
+            if (std::optional<Message> cached = cache_->lookup(key)) {
+                last_was_hit_ = true;
+                return cached;
+            }
+        }
+    }
+
+    std::optional<std::string> prompt = semantic_cache_ ? SemanticCache::promptOf(messages) : std::nullopt;
+    std::optional<std::vector<float>> embedding;
+    std::string partition;
+    if (prompt) {
+        embedding = inner_->embed(*prompt);
+        if (embedding && !VectorMath::normalize(*embedding)) {
+            embedding.reset();
+        }
+    }
+    if (embedding) {
+        partition = SemanticCache::partitionKey(*inner_, params, messages);
+        if (!refresh_) {
+            if (std::optional<SemanticCache::Hit> hit = semantic_cache_->lookup(partition, *embedding)) {
+                std::cerr << "Note: Answered from the semantic cache (similarity " << std::fixed << std::setprecision(3)
+                          << hit->similarity << " to an earlier prompt: \"" << hit->prompt.substr(0, 80) << "\")." << std::endl;
+                last_was_hit_ = true;
+                return hit->reply;
+            }
+        }
+    }
+
+    std::optional<Message> reply = send();
+    if (reply && !inner_->lastReplyIncomplete() && isStorable(*reply, params)) {
+        if (exact) {
+            cache_->store(key, *reply);
+        }
+        if (embedding) {
+            semantic_cache_->store(partition, *embedding, *prompt, *reply);
+        }
+    }
+    return reply;
+}
+
+std::optional<std::vector<Message>> CachingModel::sendMessageCandidates(const std::vector<Message>& messages, const GenerationParams& params) {
+    if (params.candidate_count.value_or(1) > 1) {
+        last_was_hit_ = false;
+        return inner_->sendMessageCandidates(messages, params);
+    }
+    return IAIModel::sendMessageCandidates(messages, params);
+}
+
+std::optional<Message> CachingModel::sendMessageStreaming(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback& on_delta) {
+    last_was_hit_ = false;
+    if (tools_enabled_) {
+        return inner_->sendMessageStreaming(messages, params, on_delta);
+    }
+    std::optional<Message> reply = sendThroughCaches(messages, params, [&]() { return inner_->sendMessageStreaming(messages, params, on_delta); });
+    if (reply && last_was_hit_ && !on_delta(reply->content)) {
+        return std::nullopt;
+    }
+    return reply;
+}
+
+std::optional<TokenUsage> CachingModel::lastUsage() const {
+    if (last_was_hit_) {
+        return TokenUsage();
+    }
+    return inner_->lastUsage();
+}
@@ -190,6 +190,31 @@ int ConfigManager::getInt(const std::string& key, int default_value) const {
     return default_value;
 }
 
+double ConfigManager::getDouble(const std::string& key, double default_value) const {
+    try {
+        nlohmann::json current_node = config_;
+        size_t start = 0;
+        size_t end = key.find(".");
+        while (end != std::string::npos) {
+            std::string sub_key = key.substr(start, end - start);
+            if (current_node.contains(sub_key)) {
+                current_node = current_node[sub_key];
+            } else {
+                return default_value;
+            }
+            start = end + 1;
+            end = key.find(".", start);
+        }
+        std::string last_key = key.substr(start);
+        if (current_node.contains(last_key) && current_node[last_key].is_number()) {
+            return current_node[last_key].get<double>();
+        }
+    } catch (const nlohmann::json::exception& e) {
+        std::cerr << "Error getting double config for key " << key << ": " << e.what() << std::endl;
+    }
+    return default_value;
+}
+
 bool ConfigManager::getBool(const std::string& key, bool default_value) const {
     try {
         nlohmann::json current_node = config_;
@@ -215,16 +240,30 @@ bool ConfigManager::getBool(const std::string& key, bool default_value) const {
     return default_value;
 }
 
-std::map<std::string, std::string> ConfigManager::getModelParams(const std::string& model_type) const {
-    std::map<std::string, std::string> params;
+nlohmann::json ConfigManager::getJson(const std::string& key) const {
+    const nlohmann::json* current_node = &config_;
+    size_t start = 0;
+    while (true) {
+        size_t end = key.find(".", start);
+        std::string sub_key = key.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        if (!current_node->is_object() || !current_node->contains(sub_key)) {
+            return nullptr;
+        }
+        current_node = &current_node->at(sub_key);
+        if (end == std::string::npos) {
+            return *current_node;
+        }
+        start = end + 1;
+    }
+}
+
+nlohmann::json ConfigManager::getModelParams(const std::string& model_type) const {
     try {
         if (config_.contains(model_type) && config_[model_type].contains("model_params") && config_[model_type]["model_params"].is_object()) {
-            for (auto it = config_[model_type]["model_params"].begin(); it != config_[model_type]["model_params"].end(); ++it) {
-                params[it.key()] = it.value().dump();
-            }
+            return config_[model_type]["model_params"];
         }
     } catch (const nlohmann::json::exception& e) {
         std::cerr << "Error getting model parameters for type " << model_type << ": " << e.what() << std::endl;
     }
-    return params;
+    return nlohmann::json::object();
 }
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include "ContextWindow.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Per-message framing overhead (role, separators) charged on top of the content.
+constexpr size_t kMessageOverheadTokens = 4;
+
+// Known context window sizes, matched by model name prefix. Longer prefixes must come first.
+const std::pair<const char*, size_t> kContextLimits[] = {
+    {"gpt-4.1", 1047576},
+    {"gpt-4o", 128000},
+    {"gpt-4-turbo", 128000},
+    {"gpt-4-32k", 32768},
+    {"gpt-4", 8192},
+    {"gpt-5", 400000},
+    {"gpt-3.5-turbo", 16385},
+    {"o1", 200000},
+    {"o3", 200000},
+    {"o4", 200000},
+    {"deepseek", 65536},
+    {"gemini-1.5", 1048576},
+    {"gemini-2", 1048576},
+    {"gemini-1.0", 32760},
+    {"gemini-pro", 32760},
+    {"claude", 200000},
+};
+
+} // namespace
+
+ContextWindowManager::ContextWindowManager(size_t budget_tokens, size_t keep_last_messages, double trim_to_ratio, TokenCounter counter)
+    : budget_tokens_(budget_tokens),
+      keep_last_messages_(keep_last_messages),
+      trim_to_ratio_(trim_to_ratio > 0.0 && trim_to_ratio <= 1.0 ? trim_to_ratio : 0.75),
+      counter_(counter ? std::move(counter) : TokenCounter(estimateTokens)) {
+}
+
+size_t ContextWindowManager::contextLimitForModel(const std::string& model_name) {
+    for (const auto& entry : kContextLimits) {
+        if (model_name.rfind(entry.first, 0) == 0) {
+            return entry.second;
+        }
+    }
+    return 0;
+}
+
+size_t ContextWindowManager::estimateTokens(const std::string& text) {
+    size_t ascii_bytes = 0;
+    size_t other_chars = 0;
+    for (unsigned char c : text) {
+        if (c < 0x80) {
+            ++ascii_bytes;
+        } else if ((c & 0xC0) != 0x80) {
+            ++other_chars; // Count UTF-8 lead bytes only
+        }
+    }
+    return (ascii_bytes + 3) / 4 + other_chars;
+}
+
+void ContextWindowManager::invalidate(size_t first_changed_index) {
+    if (first_changed_index < token_counts_.size()) {
+        token_counts_.resize(first_changed_index);
+    }
+    if (first_changed_index < summarized_count_) {
+        // The summary no longer reflects the messages it covers; send them again (subject to the budget).
+        summarized_count_ = 0;
+        summary_ = Message();
+        summary_tokens_ = 0;
+        summary_changed_ = true;
+        window_start_ = 0;
+    }
+    if (first_changed_index == 0) {
+        window_start_ = 0;
+    }
+    window_source_count_ = 0;
+}
+
+void ContextWindowManager::setPinnedPrefix(size_t message_count) {
+    if (message_count != pinned_prefix_) {
+        pinned_prefix_ = message_count;
+        window_source_count_ = 0;
+    }
+}
+
+void ContextWindowManager::setTokenCounter(TokenCounter counter) {
+    counter_ = counter ? std::move(counter) : TokenCounter(estimateTokens);
+    token_counts_.clear();
+    if (summarized_count_ > 0) {
+        summary_tokens_ = counter_(summary_.content) + kMessageOverheadTokens;
+    }
+}
+
+void ContextWindowManager::setSummary(size_t covered_count, Message summary) {
+    summarized_count_ = covered_count;
+    summary_ = std::move(summary);
+    summary_tokens_ = covered_count > 0 ? counter_(summary_.content) + kMessageOverheadTokens : 0;
+    summary_changed_ = true;
+}
+
+bool ContextWindowManager::isPinned(const std::vector<Message>& conversation, size_t index) const {
+    const size_t count = conversation.size();
+    const size_t tail_start = count > keep_last_messages_ ? count - keep_last_messages_ : 0;
+    return index < pinned_prefix_ || index >= tail_start || conversation[index].role == "system";
+}
+
+size_t ContextWindowManager::messageTokens(const std::vector<Message>& conversation, size_t index) {
+    const Message& msg = conversation[index];
+    if (index < token_counts_.size() && token_counts_[index].content_size == msg.content.size()) {
+        return token_counts_[index].tokens;
+    }
+    size_t tokens = counter_(msg.content) + kMessageOverheadTokens;
+    if (index < token_counts_.size()) {
+        token_counts_[index] = {msg.content.size(), tokens};
+    } else {
+        // Counts are filled in order, so index == token_counts_.size() here.
+        token_counts_.push_back({msg.content.size(), tokens});
+    }
+    return tokens;
+}
+
+const std::vector<Message>& ContextWindowManager::select(const std::vector<Message>& conversation) {
+    const size_t count = conversation.size();
+    const size_t previous_start = window_start_;
+    if (token_counts_.size() > count) {
+        token_counts_.resize(count);
+    }
+    if (window_start_ > count) {
+        window_start_ = 0;
+    }
+
+    const size_t tail_start = count > keep_last_messages_ ? count - keep_last_messages_ : 0;
+    // Summarized messages are never sent again.
+    const bool has_summary = summarized_count_ > 0;
+    if (has_summary && window_start_ < std::min(summarized_count_, tail_start)) {
+        window_start_ = std::min(summarized_count_, tail_start);
+    }
+
+    // Tokens of the current window: everything pinned plus unpinned messages from window_start_ on.
+    size_t window_tokens = has_summary ? summary_tokens_ : 0;
+    for (size_t i = 0; i < count; ++i) {
+        size_t tokens = messageTokens(conversation, i);
+        if (i >= window_start_ || isPinned(conversation, i)) {
+            window_tokens += tokens;
+        }
+    }
+
+    if (budget_tokens_ > 0 && window_tokens > budget_tokens_) {
+        // Shrink well below the budget so the window start does not move again for a while.
+        size_t target = static_cast<size_t>(static_cast<double>(budget_tokens_) * trim_to_ratio_);
+        while (window_start_ < tail_start && window_tokens > target) {
+            if (!isPinned(conversation, window_start_)) {
+                window_tokens -= token_counts_[window_start_].tokens;
+            }
+            ++window_start_;
+        }
+        // Start at a user turn so the window never opens with a dangling assistant reply.
+        while (window_start_ < tail_start && (isPinned(conversation, window_start_) || conversation[window_start_].role != "user")) {
+            if (!isPinned(conversation, window_start_)) {
+                window_tokens -= token_counts_[window_start_].tokens;
+            }
+            ++window_start_;
+        }
+    }
+
+    window_moved_ = window_start_ != previous_start || summary_changed_;
+    summary_changed_ = false;
+    if (window_moved_) {
+        // Pinned messages ahead of the old start are sent in the same positions either way.
+        first_changed_index_ = 0;
+        for (size_t i = 0; i < std::min(previous_start, window_start_); ++i) {
+            if (isPinned(conversation, i)) {
+                ++first_changed_index_;
+            }
+        }
+    }
+    selected_tokens_ = window_tokens;
+    trimmed_count_ = 0;
+    for (size_t i = 0; i < window_start_; ++i) {
+        if (!isPinned(conversation, i)) {
+            ++trimmed_count_;
+        }
+    }
+    if (trimmed_count_ == 0 && !has_summary) {
+        window_.clear();
+        window_indices_.clear();
+        window_source_count_ = 0;
+        return conversation;
+    }
+
+    // Usually only new messages were appended since the last turn and the window has not moved:
+    // extend the previous selection instead of copying the whole conversation again. The last copied
+    // message is compared as well, since a failed turn may have been replaced at the same index.
+    if (!window_moved_ && window_source_count_ > 0 && count >= window_source_count_ && !window_.empty() &&
+        window_indices_.back() == window_source_count_ - 1 && window_.back().role == conversation[window_source_count_ - 1].role &&
+        window_.back().content == conversation[window_source_count_ - 1].content) {
+        for (size_t i = window_source_count_; i < count; ++i) {
+            window_.push_back(conversation[i]);
+            window_indices_.push_back(i);
+        }
+        window_source_count_ = count;
+        return window_;
+    }
+
+    window_.clear();
+    window_indices_.clear();
+    window_.reserve(count - trimmed_count_ + 1);
+    window_indices_.reserve(count - trimmed_count_ + 1);
+    bool summary_placed = !has_summary;
+    for (size_t i = 0; i < count; ++i) {
+        if (!summary_placed && i >= window_start_) {
+            // The summary takes the place of the messages it covers, right after the pinned ones before them.
+            summary_placed = true;
+            if (conversation[i].role == "user") {
+                // Merged into the user turn that follows, so the request never has two user messages in a row.
+                Message merged = conversation[i];
+                merged.content = summary_.content + "\n\n" + merged.content;
+                window_.push_back(std::move(merged));
+                window_indices_.push_back(i);
+                continue;
+            }
+            window_.push_back(summary_);
+            window_indices_.push_back(window_start_ > 0 ? window_start_ - 1 : 0);
+        }
+        if (i >= window_start_ || isPinned(conversation, i)) {
+            window_.push_back(conversation[i]);
+            window_indices_.push_back(i);
+        }
+    }
+    if (!summary_placed) {
+        window_.push_back(summary_);
+        window_indices_.push_back(window_start_ > 0 ? window_start_ - 1 : 0);
+        // A trailing summary has to be rebuilt in front of the messages that follow it.
+        window_source_count_ = 0;
+    } else {
+        window_source_count_ = count;
+    }
+    return window_;
+}
+
+size_t ContextWindowManager::windowIndexOf(size_t conversation_index) const {
+    if (window_indices_.empty()) {
+        return conversation_index;
+    }
+    return static_cast<size_t>(std::lower_bound(window_indices_.begin(), window_indices_.end(), conversation_index) - window_indices_.begin());
+}
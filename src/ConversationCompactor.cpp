@@ -0,0 +1,127 @@
+#include "ConversationCompactor.h"
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
+namespace {
+
+const char* const kSummaryHeader = "[Summary of the earlier conversation]\n";
+
+const char* const kSummaryInstructions =
+    "Summarize the following earlier part of a conversation between a user and an AI assistant. "
+    "The summary replaces these messages in the assistant's context, so keep every fact, decision, "
+    "name, number, code snippet and open question needed to continue the conversation. "
+    "Reply with the summary only.";
+
+} // namespace
+
+ConversationCompactor::ConversationCompactor(std::unique_ptr<IAIModel> model, const GenerationParams& params, size_t threshold_tokens, size_t keep_last_messages)
+    : model_(std::move(model)),
+      params_(params),
+      threshold_tokens_(threshold_tokens),
+      keep_last_messages_(std::max<size_t>(keep_last_messages, 1)) {
+    params_.candidate_count.reset(); // One summary is enough
+    params_.json_schema = nullptr; // The summary is prose, not the structured reply format
+}
+
+ConversationCompactor::~ConversationCompactor() {
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+bool ConversationCompactor::running() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return running_;
+}
+
+std::string ConversationCompactor::buildPrompt(const Message& previous_summary, const std::vector<const Message*>& messages) {
+    std::string prompt = kSummaryInstructions;
+    prompt += "\n\n";
+    if (!previous_summary.content.empty()) {
+        prompt += previous_summary.content;
+        prompt += "\n\n";
+    }
+    for (const Message* msg : messages) {
+        prompt += msg->role == "user" ? "User: " : "Assistant: ";
+        prompt += msg->content;
+        prompt += "\n\n";
+    }
+    return prompt;
+}
+
+bool ConversationCompactor::maybeStart(const std::vector<Message>& conversation, const ContextWindowManager& context_window) {
+    if (!model_ || context_window.selectedTokens() <= threshold_tokens_) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_ || result_) {
+            return false;
+        }
+    }
+
+    // Summarize everything up to the kept tail, ending before a user turn so the remaining
+    // messages still open with the user.
+    const size_t first = context_window.summarizedCount();
+    size_t cut = conversation.size() > keep_last_messages_ ? conversation.size() - keep_last_messages_ : 0;
+    while (cut > first && conversation[cut].role != "user") {
+        --cut;
+    }
+    std::vector<const Message*> to_summarize;
+    for (size_t i = first; i < cut; ++i) {
+        if (!context_window.isPinned(conversation, i)) {
+            to_summarize.push_back(&conversation[i]);
+        }
+    }
+    if (to_summarize.empty()) {
+        return false;
+    }
+    std::vector<Message> request = {{"user", buildPrompt(context_window.summary(), to_summarize)}};
+
+    if (worker_.joinable()) {
+        worker_.join(); // The previous job has already finished
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = true;
+        cancelled_ = false;
+    }
+    worker_ = std::thread([this, request = std::move(request), cut, first]() {
+        // Every job is an independent one-message request.
+        model_->invalidateConversationCache();
+        std::optional<Message> reply = model_->sendMessage(request, params_);
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        if (!cancelled_) {
+            result_ = Result{cut, first, std::move(reply)};
+        }
+    });
+    return true;
+}
+
+size_t ConversationCompactor::installFinished(ContextWindowManager& context_window) {
+    std::optional<Result> result;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        result.swap(result_);
+    }
+    if (!result) {
+        return 0;
+    }
+    if (!result->reply || result->reply->content.empty()) {
+        std::cerr << "Warning: Conversation summarization failed; it will be retried after the next turn." << std::endl;
+        return 0;
+    }
+    if (context_window.summarizedCount() != result->previously_covered) {
+        return 0; // The summary it builds on was dropped meanwhile
+    }
+    context_window.setSummary(result->covered_count, {"user", kSummaryHeader + result->reply->content});
+    return result->covered_count - result->previously_covered;
+}
+
+void ConversationCompactor::cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cancelled_ = true;
+    result_.reset();
+}
@@ -0,0 +1,186 @@
+#include "GenerationParams.h"
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Accepts JSON numbers and numeric strings (older configs quote their values).
+std::optional<double> toDouble(const nlohmann::json& value) {
+    if (value.is_number()) {
+        return value.get<double>();
+    }
+    if (value.is_string()) {
+        const std::string& text = value.get_ref<const std::string&>();
+        try {
+            size_t consumed = 0;
+            double parsed = std::stod(text, &consumed);
+            if (consumed == text.size()) {
+                return parsed;
+            }
+        } catch (const std::exception&) {
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<long long> toInteger(const nlohmann::json& value) {
+    std::optional<double> number = toDouble(value);
+    if (!number || !std::isfinite(*number) || std::floor(*number) != *number) {
+        return std::nullopt;
+    }
+    if (*number < static_cast<double>(std::numeric_limits<long long>::min()) ||
+        *number > static_cast<double>(std::numeric_limits<long long>::max())) {
+        return std::nullopt;
+    }
+    return static_cast<long long>(*number);
+}
+
+bool setRangedDouble(std::optional<double>& field, const std::string& key, const nlohmann::json& value,
+                     double min_value, double max_value, std::string& error) {
+    std::optional<double> number = toDouble(value);
+    if (!number || !(*number >= min_value && *number <= max_value)) {
+        error = key + " must be a number between " + nlohmann::json(min_value).dump() + " and " + nlohmann::json(max_value).dump() + ", got " + value.dump();
+        return false;
+    }
+    field = *number;
+    return true;
+}
+
+bool setPositiveInt(std::optional<int>& field, const std::string& key, const nlohmann::json& value, std::string& error) {
+    std::optional<long long> number = toInteger(value);
+    if (!number || *number <= 0 || *number > std::numeric_limits<int>::max()) {
+        error = key + " must be a positive integer, got " + value.dump();
+        return false;
+    }
+    field = static_cast<int>(*number);
+    return true;
+}
+
+} // namespace
+
+bool GenerationParams::set(const std::string& key, const nlohmann::json& value, std::string& error) {
+    if (key == "temperature") {
+        return setRangedDouble(temperature, key, value, 0.0, 2.0, error);
+    } else if (key == "top_p") {
+        return setRangedDouble(top_p, key, value, 0.0, 1.0, error);
+    } else if (key == "presence_penalty") {
+        return setRangedDouble(presence_penalty, key, value, -2.0, 2.0, error);
+    } else if (key == "frequency_penalty") {
+        return setRangedDouble(frequency_penalty, key, value, -2.0, 2.0, error);
+    } else if (key == "top_k") {
+        return setPositiveInt(top_k, key, value, error);
+    } else if (key == "max_tokens") {
+        return setPositiveInt(max_tokens, key, value, error);
+    } else if (key == "n") {
+        return setPositiveInt(candidate_count, key, value, error);
+    } else if (key == "seed") {
+        std::optional<long long> number = toInteger(value);
+        if (!number) {
+            error = "seed must be an integer, got " + value.dump();
+            return false;
+        }
+        seed = *number;
+        return true;
+    } else if (key == "json_schema") {
+        if (!value.is_object()) {
+            error = "json_schema must be a JSON Schema object, got " + value.dump();
+            return false;
+        }
+        json_schema = value;
+        return true;
+    } else if (key == "stop") {
+        std::vector<std::string> sequences;
+        if (value.is_string()) {
+            sequences.push_back(value.get<std::string>());
+        } else if (value.is_array()) {
+            for (const auto& item : value) {
+                if (!item.is_string()) {
+                    error = "stop must be a string or an array of strings, got " + value.dump();
+                    return false;
+                }
+                sequences.push_back(item.get<std::string>());
+            }
+        } else {
+            error = "stop must be a string or an array of strings, got " + value.dump();
+            return false;
+        }
+        stop = std::move(sequences);
+        return true;
+    }
+    extra[key] = value;
+    return true;
+}
+
+bool GenerationParams::setFromString(const std::string& key, const std::string& value, std::string& error) {
+    nlohmann::json parsed = nlohmann::json::parse(value, nullptr, false);
+    if (parsed.is_discarded()) {
+        parsed = value;
+    }
+    return set(key, parsed, error);
+}
+
+std::optional<GenerationParams> GenerationParams::fromJson(const nlohmann::json& params, std::string& error) {
+    GenerationParams result;
+    if (params.is_null()) {
+        return result;
+    }
+    if (!params.is_object()) {
+        error = "model_params must be a JSON object";
+        return std::nullopt;
+    }
+    for (auto it = params.begin(); it != params.end(); ++it) {
+        if (!result.set(it.key(), it.value(), error)) {
+            return std::nullopt;
+        }
+    }
+    return result;
+}
+
+nlohmann::json GenerationParams::toJson() const {
+    nlohmann::json result = extra;
+    if (temperature) {
+        result["temperature"] = *temperature;
+    }
+    if (top_p) {
+        result["top_p"] = *top_p;
+    }
+    if (top_k) {
+        result["top_k"] = *top_k;
+    }
+    if (max_tokens) {
+        result["max_tokens"] = *max_tokens;
+    }
+    if (seed) {
+        result["seed"] = *seed;
+    }
+    if (presence_penalty) {
+        result["presence_penalty"] = *presence_penalty;
+    }
+    if (frequency_penalty) {
+        result["frequency_penalty"] = *frequency_penalty;
+    }
+    if (!stop.empty()) {
+        result["stop"] = stop;
+    }
+    if (candidate_count) {
+        result["n"] = *candidate_count;
+    }
+    if (!json_schema.is_null()) {
+        result["json_schema"] = json_schema;
+    }
+    return result;
+}
+
+bool GenerationParams::operator==(const GenerationParams& other) const {
+    return temperature == other.temperature &&
+           top_p == other.top_p &&
+           top_k == other.top_k &&
+           max_tokens == other.max_tokens &&
+           seed == other.seed &&
+           presence_penalty == other.presence_penalty &&
+           frequency_penalty == other.frequency_penalty &&
+           stop == other.stop &&
+           candidate_count == other.candidate_count &&
+           json_schema == other.json_schema &&
+           extra == other.extra;
+}
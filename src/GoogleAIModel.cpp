@@ -1,71 +1,453 @@
 
 #include "GoogleAIModel.h"
+#include "JsonExtractor.h"
+#include "JsonWriter.h"
+#include "ProviderTraits.h"
+#include "Sha256.h"
+#include "SseParser.h"
+#include <algorithm>
 #include <iostream>
 
-GoogleAIModel::GoogleAIModel(const std::string& api_key, const std::string& base_url, const std::string& model_name)
+namespace {
+
+// Refresh the context cache a little before the server expires it, so a request never races the TTL.
+constexpr std::chrono::seconds kCacheExpiryMargin(60);
+
+// batchEmbedContents accepts at most this many requests per call.
+constexpr size_t kMaxEmbeddingInputsPerRequest = 100;
+
+std::map<std::string, std::string> jsonHeaders() {
+    std::map<std::string, std::string> headers;
+    headers["Content-Type"] = "application/json";
+    return headers;
+}
+
+// responseSchema takes an OpenAPI subset and rejects unknown keywords such as "$schema" or
+// "additionalProperties"; everything else is dropped (the reply is still validated client-side).
+nlohmann::json toResponseSchema(const nlohmann::json& schema) {
+    static const char* const kSupportedKeywords[] = {
+        "type", "format", "title", "description", "nullable", "enum", "required", "minItems", "maxItems",
+        "minimum", "maximum", "minLength", "maxLength", "propertyOrdering",
+    };
+    if (!schema.is_object()) {
+        return schema;
+    }
+    nlohmann::json result = nlohmann::json::object();
+    for (const char* keyword : kSupportedKeywords) {
+        if (schema.contains(keyword)) {
+            result[keyword] = schema[keyword];
+        }
+    }
+    if (schema.contains("properties") && schema["properties"].is_object()) {
+        for (const auto& property : schema["properties"].items()) {
+            result["properties"][property.key()] = toResponseSchema(property.value());
+        }
+    }
+    if (schema.contains("items")) {
+        result["items"] = toResponseSchema(schema["items"]);
+    }
+    if (schema.contains("anyOf") && schema["anyOf"].is_array()) {
+        for (const auto& option : schema["anyOf"]) {
+            result["anyOf"].push_back(toResponseSchema(option));
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+GoogleAIModel::GoogleAIModel(const std::string& api_key, const std::string& base_url, const std::string& model_name, size_t cache_prefix_messages, int cache_ttl_seconds)
     : api_key_(api_key),
       base_url_(base_url),
-      model_name_(model_name) {
+      model_name_(model_name),
+      cache_prefix_messages_(cache_prefix_messages),
+      cache_ttl_seconds_(cache_ttl_seconds > 0 ? cache_ttl_seconds : 3600) {
+}
+
+void GoogleAIModel::encodeMessages(JsonWriter& writer, const std::vector<Message>& messages, size_t first_message) {
+    using ProviderTraits::Role;
+    for (size_t i = first_message; i < messages.size();) {
+        if (ProviderTraits::roleOf(messages[i].role) != Role::Tool) {
+            ProviderTraits::encodeMessage<ProviderTraits::Gemini>(writer, messages[i]);
+            ++i;
+            continue;
+        }
+        // All results answering one model turn go back together in a single user turn.
+        size_t end = i;
+        while (end < messages.size() && ProviderTraits::roleOf(messages[end].role) == Role::Tool) {
+            ++end;
+        }
+        ProviderTraits::encodeToolResults<ProviderTraits::Gemini>(writer, &messages[i], &messages[0] + end);
+        i = end;
+    }
+}
+
+bool GoogleAIModel::setTools(const std::vector<ToolDefinition>& tools) {
+    std::string previous_digest = std::move(tools_digest_);
+    tools_fragment_.clear();
+    tools_digest_.clear();
+    if (!tools.empty()) {
+        tools_fragment_ = serializeTools(tools);
+        tools_digest_ = Sha256::hex(tools_fragment_);
+    }
+    if (tools_digest_ != previous_digest) {
+        // The context cache carries the tools; it is recreated with the new ones.
+        dropContextCache();
+        failed_cache_prefix_ = 0;
+    }
+    return true;
+}
+
+std::string GoogleAIModel::serializeTools(const std::vector<ToolDefinition>& tools) {
+    std::string object;
+    JsonWriter writer(object);
+    writer.beginObject();
+    writer.key("tools");
+    writer.beginArray();
+    writer.beginObject();
+    writer.key("functionDeclarations");
+    writer.beginArray();
+    for (const auto& tool : tools) {
+        writer.beginObject();
+        writer.key("name");
+        writer.value(tool.name);
+        writer.key("description");
+        writer.value(tool.description);
+        if (!tool.parameters.empty()) {
+            writer.key("parameters");
+            writer.rawValue(tool.parameters.dump());
+        }
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.endObject();
+    writer.endArray();
+    writer.endObject();
+    return object.substr(1, object.size() - 2);
+}
+
+void GoogleAIModel::invalidateConversationCache(size_t first_changed_index) {
+    message_cache_.invalidate(first_changed_index);
+    if (context_cache_ && first_changed_index < context_cache_->message_count) {
+        dropContextCache();
+    }
+    if (first_changed_index < failed_cache_prefix_) {
+        failed_cache_prefix_ = 0;
+    }
+}
+
+bool GoogleAIModel::setCachedPrefix(size_t message_count) {
+    if (message_count != cache_prefix_messages_) {
+        if (context_cache_) {
+            dropContextCache();
+        }
+        cache_prefix_messages_ = message_count;
+        failed_cache_prefix_ = 0;
+    }
+    return true;
+}
+
+nlohmann::json GoogleAIModel::exportConversationState() const {
+    if (!context_cache_) {
+        return nullptr;
+    }
+    long long expire_time = std::chrono::duration_cast<std::chrono::seconds>(context_cache_->expire_time.time_since_epoch()).count();
+    return {{"provider", "google"}, {"base_url", base_url_}, {"model", model_name_},
+            {"context_cache", {{"name", context_cache_->name}, {"message_count", context_cache_->message_count}, {"expire_time", expire_time},
+                               {"tools_digest", context_cache_->tools_digest}}}};
+}
+
+void GoogleAIModel::importConversationState(const nlohmann::json& state) {
+    context_cache_.reset();
+    if (!state.is_object() || state.value("provider", "") != "google" ||
+        state.value("base_url", "") != base_url_ || state.value("model", "") != model_name_) {
+        return;
+    }
+    try {
+        const auto& cache = state.at("context_cache");
+        ContextCache restored;
+        restored.name = cache.at("name").get<std::string>();
+        restored.message_count = cache.at("message_count").get<size_t>();
+        restored.expire_time = std::chrono::system_clock::time_point(std::chrono::seconds(cache.at("expire_time").get<long long>()));
+        // A cache made with other tools is replaced (and deleted) by the next ensureContextCache().
+        restored.tools_digest = cache.value("tools_digest", "");
+        if (std::chrono::system_clock::now() + kCacheExpiryMargin >= restored.expire_time) {
+            return; // Already expired server-side
+        }
+        if (cache_prefix_messages_ == 0) {
+            cache_prefix_messages_ = restored.message_count; // Keep using the prefix designated in that session
+        }
+        context_cache_ = restored;
+    } catch (const nlohmann::json::exception& e) {
+        std::cerr << "Warning: Ignoring malformed Google AI conversation state: " << e.what() << std::endl;
+    }
+}
+
+bool GoogleAIModel::ensureContextCache(const std::vector<Message>& messages) {
+    if (context_cache_ && context_cache_->message_count == cache_prefix_messages_ && context_cache_->tools_digest == tools_digest_ &&
+        std::chrono::system_clock::now() + kCacheExpiryMargin < context_cache_->expire_time) {
+        return true;
+    }
+    if (failed_cache_prefix_ == cache_prefix_messages_) {
+        return false;
+    }
+    if (context_cache_) {
+        dropContextCache();
+    }
+
+    std::string request_body;
+    JsonWriter writer(request_body);
+    writer.beginObject();
+    writer.key("model");
+    writer.value("models/" + model_name_);
+    writer.key("contents");
+    writer.beginArray();
+    for (size_t i = 0; i < cache_prefix_messages_; ++i) {
+        ProviderTraits::encodeMessage<ProviderTraits::Gemini>(writer, messages[i]);
+    }
+    writer.endArray();
+    // Requests that use the cache may not set tools themselves.
+    writer.rawMembers(tools_fragment_);
+    writer.key("ttl");
+    writer.value(std::to_string(cache_ttl_seconds_) + "s");
+    writer.endObject();
+
+    // Take the timestamp before the request so the locally tracked expiry is never later than the server's.
+    auto created_at = std::chrono::system_clock::now();
+    std::string url = base_url_ + "/v1beta/cachedContents?key=" + api_key_;
+    std::optional<std::string> raw_response = http_client_.postSerializedRaw(url, jsonHeaders(), request_body);
+    std::optional<std::string> name = raw_response ? JsonExtractor::getString(*raw_response, {"name"}) : std::nullopt;
+    if (!name) {
+        std::cerr << "Warning: Could not create Google AI context cache for the first " << cache_prefix_messages_
+                  << " messages; sending them with every request instead." << std::endl;
+        failed_cache_prefix_ = cache_prefix_messages_;
+        return false;
+    }
+    context_cache_ = ContextCache{*name, cache_prefix_messages_, created_at + std::chrono::seconds(cache_ttl_seconds_), tools_digest_};
+    return true;
+}
+
+void GoogleAIModel::dropContextCache() {
+    if (!context_cache_) {
+        return;
+    }
+    // Best effort: an orphaned cache only lingers until its TTL runs out.
+    http_client_.del(base_url_ + "/v1beta/" + context_cache_->name + "?key=" + api_key_, jsonHeaders());
+    context_cache_.reset();
+}
+
+std::string GoogleAIModel::serializeParams(const GenerationParams& params) {
+    std::string object;
+    JsonWriter writer(object);
+    writer.beginObject();
+    writer.key("generationConfig");
+    writer.beginObject();
+    ProviderTraits::writeSamplingParams<ProviderTraits::Gemini>(writer, params);
+    if (!params.json_schema.is_null()) {
+        writer.key("responseMimeType");
+        writer.value("application/json");
+        writer.key("responseSchema");
+        writer.rawValue(toResponseSchema(params.json_schema).dump());
+    }
+    for (auto it = params.extra.begin(); it != params.extra.end(); ++it) {
+        writer.key(it.key());
+        writer.rawValue(it.value().dump());
+    }
+    writer.endObject();
+    writer.endObject();
+    if (object == "{\"generationConfig\":{}}") {
+        return "";
+    }
+    // Strip the outer braces: the fragment is spliced into the request object as a member.
+    return object.substr(1, object.size() - 2);
+}
+
+std::optional<TokenUsage> GoogleAIModel::lastUsage() const {
+    return last_usage_;
+}
+
+std::optional<Message> GoogleAIModel::sendMessage(const std::vector<Message>& messages, const GenerationParams& params) {
+    std::optional<std::vector<Message>> candidates = sendMessageCandidates(messages, params);
+    if (!candidates) {
+        return std::nullopt;
+    }
+    return std::move(candidates->front());
+}
+
+std::optional<std::vector<Message>> GoogleAIModel::sendMessageCandidates(const std::vector<Message>& messages, const GenerationParams& params) {
+    return send(messages, params, nullptr);
+}
+
+std::optional<Message> GoogleAIModel::sendMessageStreaming(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback& on_delta) {
+    std::optional<std::vector<Message>> replies = send(messages, params, &on_delta);
+    if (!replies) {
+        return std::nullopt;
+    }
+    return std::move(replies->front());
 }
 
-std::optional<Message> GoogleAIModel::sendMessage(const std::vector<Message>& messages, const std::map<std::string, std::string>& model_params) {
-    nlohmann::json request_body;
-    request_body["stream"] = false;
+std::optional<std::vector<Message>> GoogleAIModel::send(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback* on_delta) {
+    last_usage_.reset();
+    stream_aborted_ = false;
+    if (cache_prefix_messages_ > 0 && messages.size() > cache_prefix_messages_ && ensureContextCache(messages)) {
+        if (std::optional<std::vector<Message>> candidates = generateContent(messages, cache_prefix_messages_, context_cache_->name, params, on_delta)) {
+            return candidates;
+        }
+        if (stream_aborted_ || HttpClient::cancelRequested()) {
+            return std::nullopt; // Stopped by the caller; the cache is fine
+        }
+        std::cerr << "Warning: Request using cached context failed, resending the full conversation." << std::endl;
+        long status = HttpClient::lastStatusCode();
+        if (status == 403 || status == 404) {
+            // Evicted before its TTL: already gone server-side, recreated next turn.
+            context_cache_.reset();
+        } else {
+            // Deleted so it is not billed until its TTL runs out. A rejection by the server is likely
+            // to repeat, so that prefix is not cached again; connection errors are retried next turn.
+            dropContextCache();
+            if (status >= 400) {
+                failed_cache_prefix_ = cache_prefix_messages_;
+            }
+        }
+    }
+    return generateContent(messages, 0, "", params, on_delta);
+}
+
+std::optional<std::vector<Message>> GoogleAIModel::generateContent(const std::vector<Message>& messages, size_t first_message, const std::string& cached_content, const GenerationParams& params, const DeltaCallback* on_delta) {
+    // Serialize straight into the outgoing buffer instead of building a JSON DOM first.
+    std::string request_body;
+    JsonWriter writer(request_body);
+    writer.beginObject();
+    if (!cached_content.empty()) {
+        writer.key("cachedContent");
+        writer.value(cached_content);
+    }
     // Google AI (Gemini) API typically uses a 'contents' array for messages
     // and 'generationConfig' for model parameters.
     // This is a simplified mapping and might need adjustment based on specific Gemini API version.
-    nlohmann::json contents_array = nlohmann::json::array();
-    for (const auto& msg : messages) {
-        // Gemini API often expects 'user' and 'model' roles, not 'system'
-        std::string role = msg.role;
-        if (role == "assistant") {
-            role = "model";
-        }
-        contents_array.push_back({{"role", role}, {"parts", {{{"text", msg.content}}}}});
-    }
-    request_body["contents"] = contents_array;
-
-    nlohmann::json generation_config;
-    for (const auto& param : model_params) {
-        if (param.first == "temperature") {
-            try {
-                generation_config[param.first] = std::stod(param.second);
-            } catch (const std::exception& e) {
-                std::cerr << "Warning: Could not parse temperature value for Google AI: " << e.what() << std::endl;
-            }
-        } else if (param.first == "max_tokens") {
-            try {
-                generation_config["maxOutputTokens"] = std::stoi(param.second);
-            } catch (const std::exception& e) {
-                std::cerr << "Warning: Could not parse max_tokens value for Google AI: " << e.what() << std::endl;
-            }
+    writer.key("contents");
+    writer.beginArray();
+    if (first_message == 0) {
+        // Messages already sent in earlier turns come from the prefix cache; only new ones are encoded.
+        // Tool results of the current turn are grouped per model turn, so they bypass the cache.
+        auto first_tool_result = std::find_if(messages.begin(), messages.end(), [](const Message& msg) { return ProviderTraits::roleOf(msg.role) == ProviderTraits::Role::Tool; });
+        if (first_tool_result == messages.end()) {
+            const std::string& encoded_messages = message_cache_.encode(messages, ProviderTraits::encodeMessage<ProviderTraits::Gemini>);
+            request_body.reserve(encoded_messages.size() + 512);
+            writer.rawElements(encoded_messages);
         } else {
-            generation_config[param.first] = param.second;
+            writer.rawElements(message_cache_.encode(std::vector<Message>(messages.begin(), first_tool_result), ProviderTraits::encodeMessage<ProviderTraits::Gemini>));
+            encodeMessages(writer, messages, static_cast<size_t>(first_tool_result - messages.begin()));
         }
+    } else {
+        // The cached context holds everything before first_message; only the tail is sent.
+        encodeMessages(writer, messages, first_message);
     }
-    if (!generation_config.empty()) {
-        request_body["generationConfig"] = generation_config;
+    writer.endArray();
+    if (cached_content.empty()) {
+        // Gemini rejects tools alongside cachedContent: the cache already declares them.
+        writer.rawMembers(tools_fragment_);
     }
 
-    std::map<std::string, std::string> headers;
-    headers["Content-Type"] = "application/json";
+    // Parameters are validated at startup; their serialized form is cached across requests.
+    writer.rawMembers(params_fragment_.get(params, serializeParams));
+    writer.endObject();
+
     // Google AI API key is usually passed as a query parameter or in a specific header
     // For simplicity, we'll assume it's part of the base_url for now or handled by the client if it's a query param.
     // If it needs to be a header, it would be: headers["x-goog-api-key"] = api_key_;
+    // cachedContent is only available on v1beta.
+    std::string api_version = cached_content.empty() ? "/v1" : "/v1beta";
+    if (on_delta) {
+        return streamContent(base_url_ + api_version + "/models/" + model_name_ + std::string(ProviderTraits::Gemini::stream_endpoint) + "&key=" + api_key_, request_body, *on_delta);
+    }
+    std::string url = base_url_ + api_version + "/models/" + model_name_ + std::string(ProviderTraits::Gemini::endpoint) + "?key=" + api_key_;
 
-    std::string url = base_url_ + "/v1/models/" + model_name_ + ":generateContent?key=" + api_key_;
+    std::optional<std::string> raw_response = http_client_.postSerializedRaw(url, jsonHeaders(), request_body);
+    if (!raw_response) {
+        return std::nullopt;
+    }
+    return parseCandidates(*raw_response);
+}
 
-    std::optional<nlohmann::json> response = http_client_.post(url, headers, request_body);
+std::optional<std::vector<Message>> GoogleAIModel::streamContent(const std::string& url, const std::string& request_body, const DeltaCallback& on_delta) {
+    // Every event is a partial generateContent reply carrying the next piece of the first candidate.
+    Message reply{std::string(ProviderTraits::Gemini::assistant_role), ""};
+    bool stream_failed = false;
+    bool finished = false;
+    SseParser parser([&](std::string_view data) {
+        if (ProviderTraits::isFinalStreamEvent<ProviderTraits::Gemini>(data)) {
+            finished = true;
+        }
+        if (std::optional<std::string_view> candidate = JsonExtractor::findValue(data, {"candidates", 0})) {
+            std::optional<Message> piece = parseCandidate(*candidate);
+            if (piece && !piece->content.empty()) {
+                reply.content += piece->content;
+                if (!on_delta(piece->content)) {
+                    stream_aborted_ = true;
+                    return false;
+                }
+            }
+        } else if (std::optional<std::string_view> error = JsonExtractor::findValue(data, {"error"})) {
+            std::cerr << "Error: Google AI stream failed: " << *error << std::endl;
+            stream_failed = true;
+            return false;
+        }
+        // Counts are cumulative; the last event has the totals.
+        if (std::optional<TokenUsage> usage = ProviderTraits::parseUsage<ProviderTraits::Gemini>(data)) {
+            last_usage_ = usage;
+        }
+        return true;
+    });
+    bool complete = http_client_.postStreaming(url, jsonHeaders(), request_body, [&parser](std::string_view chunk) { return parser.feed(chunk); });
+    if (complete && !stream_failed && !finished) {
+        std::cerr << "Error: The Google AI stream ended before the reply was complete." << std::endl;
+    } else if (complete && !stream_failed && reply.content.empty()) {
+        std::cerr << "Error: Google AI returned an empty reply." << std::endl;
+    }
+    if (!complete || stream_failed || !finished || reply.content.empty()) {
+        last_usage_.reset();
+        return std::nullopt;
+    }
+    return std::vector<Message>{std::move(reply)};
+}
+
+std::optional<std::vector<Message>> GoogleAIModel::parseCandidates(const std::string& raw_response) {
+    // Fast path: pull out just the reply fields from the raw buffer without building a DOM.
+    std::optional<std::string_view> candidates = JsonExtractor::findValue(raw_response, {"candidates"});
+    std::optional<std::vector<std::string_view>> items = candidates ? JsonExtractor::arrayElements(*candidates) : std::nullopt;
+    if (items && !items->empty()) {
+        std::vector<Message> replies;
+        for (std::string_view item : *items) {
+            std::optional<Message> reply = parseCandidate(item);
+            if (!reply) {
+                replies.clear();
+                break;
+            }
+            replies.push_back(std::move(*reply));
+        }
+        if (!replies.empty()) {
+            last_usage_ = ProviderTraits::parseUsage<ProviderTraits::Gemini>(raw_response);
+            return replies;
+        }
+    }
+
+    // Unexpected shape: fall back to a full parse for validation and diagnostics.
+    std::optional<nlohmann::json> response = HttpClient::parseResponse(raw_response);
 
     if (response) {
         try {
             if (response->contains("candidates") && !(*response)["candidates"].empty()) {
-                const auto& candidate = (*response)["candidates"][0];
-                if (candidate.contains("content") && candidate["content"].contains("parts") && !candidate["content"]["parts"].empty()) {
-                    Message reply;
-                    reply.role = candidate["content"]["role"].get<std::string>();
-                    reply.content = candidate["content"]["parts"][0]["text"].get<std::string>();
-                    return reply;
+                std::vector<Message> replies;
+                for (const auto& candidate : (*response)["candidates"]) {
+                    // Candidates without text (e.g. blocked by safety filters) are skipped.
+                    if (candidate.contains("content") && candidate["content"].contains("parts") && !candidate["content"]["parts"].empty()) {
+                        replies.push_back({candidate["content"]["role"].get<std::string>(), candidate["content"]["parts"][0]["text"].get<std::string>()});
+                    }
+                }
+                if (!replies.empty()) {
+                    last_usage_ = ProviderTraits::parseUsage<ProviderTraits::Gemini>(raw_response);
+                    return replies;
                 }
             }
             std::cerr << "Error: Unexpected Google AI API response format: " << response->dump(2) << std::endl;
@@ -77,4 +459,90 @@ std::optional<Message> GoogleAIModel::sendMessage(const std::vector<Message>& me
     return std::nullopt;
 }
 
+std::optional<Message> GoogleAIModel::parseCandidate(std::string_view candidate) {
+    std::optional<std::string_view> parts = JsonExtractor::findValue(candidate, {"content", "parts"});
+    std::optional<std::vector<std::string_view>> items = parts ? JsonExtractor::arrayElements(*parts) : std::nullopt;
+    if (!items) {
+        return std::nullopt;
+    }
+    Message reply;
+    reply.role = JsonExtractor::getString(candidate, {"content", "role"}).value_or(std::string(ProviderTraits::Gemini::assistant_role));
+    bool found = false;
+    for (std::string_view part : *items) {
+        std::optional<std::string_view> thought = JsonExtractor::findValue(part, {"thought"});
+        if (thought && *thought == "true") {
+            continue; // Thought summaries are not part of the answer
+        }
+        if (std::optional<std::string> text = JsonExtractor::getString(part, {"text"})) {
+            reply.content += *text;
+            found = true;
+        } else if (std::optional<std::string_view> call = JsonExtractor::findValue(part, {"functionCall"})) {
+            std::optional<std::string> name = JsonExtractor::getString(*call, {"name"});
+            if (!name) {
+                return std::nullopt;
+            }
+            std::optional<std::string_view> args = JsonExtractor::findValue(*call, {"args"});
+            reply.tool_calls.push_back({JsonExtractor::getString(*call, {"id"}).value_or(""), std::move(*name), args ? std::string(*args) : "{}"});
+            found = true;
+        }
+    }
+    if (!found) {
+        return std::nullopt;
+    }
+    return reply;
+}
 
+std::optional<EmbeddingMatrix> GoogleAIModel::embedBatch(const std::vector<std::string>& texts) {
+    EmbeddingMatrix matrix;
+    matrix.rows = texts.size();
+    const std::string model_resource = "models/" + embedding_model_;
+    const std::string url = base_url_ + "/v1beta/" + model_resource + ":batchEmbedContents?key=" + api_key_;
+    std::vector<float> embedding;
+    for (size_t begin = 0; begin < texts.size(); begin += kMaxEmbeddingInputsPerRequest) {
+        size_t end = std::min(texts.size(), begin + kMaxEmbeddingInputsPerRequest);
+        std::string request_body;
+        JsonWriter writer(request_body);
+        writer.beginObject();
+        writer.key("requests");
+        writer.beginArray();
+        for (size_t i = begin; i < end; ++i) {
+            writer.beginObject();
+            writer.key("model");
+            writer.value(model_resource);
+            writer.key("content");
+            writer.beginObject();
+            writer.key("parts");
+            writer.beginArray();
+            writer.beginObject();
+            writer.key("text");
+            writer.value(texts[i]);
+            writer.endObject();
+            writer.endArray();
+            writer.endObject();
+            writer.endObject();
+        }
+        writer.endArray();
+        writer.endObject();
+
+        std::optional<std::string> raw_response = http_client_.postSerializedRaw(url, jsonHeaders(), request_body);
+        if (!raw_response) {
+            return std::nullopt;
+        }
+        // Decoded straight into the matrix; the embeddings come back in request order.
+        std::optional<std::string_view> embeddings = JsonExtractor::findValue(*raw_response, {"embeddings"});
+        std::optional<std::vector<std::string_view>> items = embeddings ? JsonExtractor::arrayElements(*embeddings) : std::nullopt;
+        if (!items || items->size() != end - begin) {
+            std::cerr << "Error: Unexpected Google AI embeddings response: " << raw_response->substr(0, 512) << std::endl;
+            return std::nullopt;
+        }
+        for (size_t i = 0; i < items->size(); ++i) {
+            std::optional<std::string_view> values = JsonExtractor::findValue((*items)[i], {"values"});
+            embedding.clear();
+            if (!values || !JsonExtractor::appendFloats(*values, embedding) || embedding.empty() || !matrix.assignRow(begin + i, embedding)) {
+                std::cerr << "Error: Malformed or inconsistent embedding in Google AI embeddings response." << std::endl;
+                return std::nullopt;
+            }
+        }
+    }
+    return matrix;
+}
@@ -166,4 +166,40 @@ bool HistoryManager::modifyMessage(const std::string& filename, size_t message_i
     }
 }
 
+fs::path HistoryManager::getStatePath(const std::string& filename) const {
+    return history_dir_ / (filename + ".state.json");
+}
+
+bool HistoryManager::saveConversationState(const std::string& filename, const nlohmann::json& state) {
+    fs::path state_path = getStatePath(filename);
+    if (state.is_null()) {
+        std::error_code ec;
+        fs::remove(state_path, ec);
+        return !ec;
+    }
+    std::ofstream ofs(state_path, std::ios::trunc);
+    if (ofs.is_open()) {
+        ofs << state.dump(2);
+        ofs.close();
+        return true;
+    } else {
+        std::cerr << "Error saving conversation state to: " << state_path << std::endl;
+        return false;
+    }
+}
 
+std::optional<nlohmann::json> HistoryManager::loadConversationState(const std::string& filename) const {
+    fs::path state_path = getStatePath(filename);
+    if (!fs::exists(state_path)) {
+        return std::nullopt;
+    }
+    std::ifstream ifs(state_path);
+    if (ifs.is_open()) {
+        try {
+            return nlohmann::json::parse(ifs);
+        } catch (const nlohmann::json::parse_error& e) {
+            std::cerr << "Warning: Could not parse conversation state " << state_path << ": " << e.what() << std::endl;
+        }
+    }
+    return std::nullopt;
+}
@@ -2,6 +2,7 @@
 #include "HttpClient.h"
 #include <curl/curl.h>
 #include <iostream>
+#include <mutex>
 
 // Callback function to write received data into a string
 size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
@@ -9,17 +10,97 @@ size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
     return size * nmemb;
 }
 
-std::optional<nlohmann::json> HttpClient::performRequest(const std::string& url, const std::map<std::string, std::string>& headers, const std::optional<std::string>& post_fields, const std::string& method) {
+namespace {
+
+struct StreamTarget {
+    CURL* curl;
+    const HttpClient::ChunkCallback* on_chunk;
+    std::string* error_body; // Error responses are collected for the message instead of being streamed
+    bool aborted = false;
+};
+
+size_t StreamCallback(void* contents, size_t size, size_t nmemb, void* userp) {
+    auto* target = static_cast<StreamTarget*>(userp);
+    long http_code = 0;
+    curl_easy_getinfo(target->curl, CURLINFO_RESPONSE_CODE, &http_code);
+    if (http_code != 200) {
+        target->error_body->append(static_cast<char*>(contents), size * nmemb);
+        return size * nmemb;
+    }
+    if (!(*target->on_chunk)(std::string_view(static_cast<char*>(contents), size * nmemb))) {
+        target->aborted = true;
+        return 0; // Makes curl stop with CURLE_WRITE_ERROR
+    }
+    return size * nmemb;
+}
+
+// Cancellation flag of the innermost CancelScope on this thread, if any.
+thread_local const std::atomic<bool>* t_cancelled = nullptr;
+
+// HTTP status of the last request made on this thread (see HttpClient::lastStatusCode()).
+thread_local long t_last_status = 0;
+
+// Called by curl at least once per second while a transfer runs; a non-zero result aborts it.
+int CancelProgressCallback(void* clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    return static_cast<const std::atomic<bool>*>(clientp)->load() ? 1 : 0;
+}
+
+} // namespace
+
+HttpClient::CancelScope::CancelScope(const std::atomic<bool>* cancelled) : previous_(t_cancelled) {
+    t_cancelled = cancelled;
+}
+
+HttpClient::CancelScope::~CancelScope() {
+    t_cancelled = previous_;
+}
+
+bool HttpClient::cancelRequested() {
+    return t_cancelled && t_cancelled->load();
+}
+
+long HttpClient::lastStatusCode() {
+    return t_last_status;
+}
+
+void HttpClient::ensureCurlInitialized() {
+    // curl_global_init is not thread-safe and must not run concurrently with other libcurl calls,
+    // so it is done once for the whole process instead of around every request.
+    static std::once_flag once;
+    std::call_once(once, [] {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+    });
+}
+
+std::optional<std::string> HttpClient::performRequest(const std::string& url, const std::map<std::string, std::string>& headers, const std::string* post_fields, const std::string& method, const ChunkCallback* on_chunk) {
     CURL* curl;
     CURLcode res;
     std::string readBuffer;
 
-    curl_global_init(CURL_GLOBAL_DEFAULT);
+    t_last_status = 0;
+    if (cancelRequested()) {
+        return std::nullopt;
+    }
+    ensureCurlInitialized();
     curl = curl_easy_init();
     if (curl) {
         curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
+        // Requests may run on background threads; signals cannot be used for timeouts there.
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+        StreamTarget stream_target{curl, on_chunk, &readBuffer};
+        if (on_chunk) {
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, StreamCallback);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &stream_target);
+        } else {
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &readBuffer);
+        }
+
+        if (t_cancelled) {
+            curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+            curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, CancelProgressCallback);
+            curl_easy_setopt(curl, CURLOPT_XFERINFODATA, t_cancelled);
+        }
 
         struct curl_slist* chunk = NULL;
         for (const auto& header : headers) {
@@ -41,44 +122,69 @@ std::optional<nlohmann::json> HttpClient::performRequest(const std::string& url,
         }
 
         res = curl_easy_perform(curl);
+        if (stream_target.aborted || res == CURLE_ABORTED_BY_CALLBACK) {
+            curl_slist_free_all(chunk);
+            curl_easy_cleanup(curl);
+            return std::nullopt; // Stopped by the caller, not an error to report
+        }
         if (res != CURLE_OK) {
             std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << std::endl;
             curl_slist_free_all(chunk);
             curl_easy_cleanup(curl);
-            curl_global_cleanup();
             return std::nullopt;
         }
 
         long http_code = 0;
         curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+        t_last_status = http_code;
         if (http_code != 200) {
             std::cerr << "HTTP request failed with code: " << http_code << ", Response: " << readBuffer << std::endl;
             curl_slist_free_all(chunk);
             curl_easy_cleanup(curl);
-            curl_global_cleanup();
             return std::nullopt;
         }
 
         curl_slist_free_all(chunk);
         curl_easy_cleanup(curl);
-        curl_global_cleanup();
 
-        try {
-            return nlohmann::json::parse(readBuffer);
-        } catch (const nlohmann::json::parse_error& e) {
-            std::cerr << "JSON parse error: " << e.what() << ", Response: " << readBuffer << std::endl;
-            return std::nullopt;
-        }
+        return readBuffer;
     }
     return std::nullopt;
 }
 
+std::optional<nlohmann::json> HttpClient::parseResponse(const std::optional<std::string>& response) {
+    if (!response) {
+        return std::nullopt;
+    }
+    try {
+        return nlohmann::json::parse(*response);
+    } catch (const nlohmann::json::parse_error& e) {
+        std::cerr << "JSON parse error: " << e.what() << ", Response: " << *response << std::endl;
+        return std::nullopt;
+    }
+}
+
 std::optional<nlohmann::json> HttpClient::post(const std::string& url, const std::map<std::string, std::string>& headers, const nlohmann::json& body) {
-    return performRequest(url, headers, body.dump(), "POST");
+    std::string serialized = body.dump();
+    return parseResponse(performRequest(url, headers, &serialized, "POST"));
 }
 
-std::optional<nlohmann::json> HttpClient::get(const std::string& url, const std::map<std::string, std::string>& headers) {
-    return performRequest(url, headers, std::nullopt, "GET");
+std::optional<nlohmann::json> HttpClient::postSerialized(const std::string& url, const std::map<std::string, std::string>& headers, const std::string& body) {
+    return parseResponse(performRequest(url, headers, &body, "POST"));
 }
 
+std::optional<std::string> HttpClient::postSerializedRaw(const std::string& url, const std::map<std::string, std::string>& headers, const std::string& body) {
+    return performRequest(url, headers, &body, "POST");
+}
 
+bool HttpClient::postStreaming(const std::string& url, const std::map<std::string, std::string>& headers, const std::string& body, const ChunkCallback& on_chunk) {
+    return performRequest(url, headers, &body, "POST", &on_chunk).has_value();
+}
+
+std::optional<nlohmann::json> HttpClient::get(const std::string& url, const std::map<std::string, std::string>& headers) {
+    return parseResponse(performRequest(url, headers, nullptr, "GET"));
+}
+
+std::optional<nlohmann::json> HttpClient::del(const std::string& url, const std::map<std::string, std::string>& headers) {
+    return parseResponse(performRequest(url, headers, nullptr, "DELETE"));
+}
@@ -0,0 +1,432 @@
+#include "JsonExtractor.h"
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define HAICL_JSON_EXTRACTOR_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Finds the next '"' or '\\' at or after `p`; returns `end` if there is none.
+const char* findStringDelimiter(const char* p, const char* end) {
+#ifdef HAICL_JSON_EXTRACTOR_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    for (; p + 16 <= end; p += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        if (mask != 0) {
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+    }
+#endif
+    for (; p < end; ++p) {
+        if (*p == '"' || *p == '\\') {
+            return p;
+        }
+    }
+    return end;
+}
+
+// Finds the next character that can change nesting depth outside of strings: '"', '{', '}', '[' or ']'.
+const char* findStructural(const char* p, const char* end) {
+#ifdef HAICL_JSON_EXTRACTOR_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    // '[' (0x5B) / ']' (0x5D) and '{' (0x7B) / '}' (0x7D) differ only in bit 5 (0x20),
+    // so OR-ing 0x20 folds each bracket pair onto its brace and two compares cover all four.
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i open_brace = _mm_set1_epi8('{');
+    const __m128i close_brace = _mm_set1_epi8('}');
+    for (; p + 16 <= end; p += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i folded = _mm_or_si128(chunk, case_bit);
+        __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                    _mm_or_si128(_mm_cmpeq_epi8(folded, open_brace), _mm_cmpeq_epi8(folded, close_brace)));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+    }
+#endif
+    for (; p < end; ++p) {
+        char c = *p;
+        if (c == '"' || c == '{' || c == '}' || c == '[' || c == ']') {
+            return p;
+        }
+    }
+    return end;
+}
+
+// Forward-only cursor over a JSON buffer. Every method returns false on malformed input.
+class Cursor {
+public:
+    Cursor(const char* begin, const char* end) : p_(begin), end_(end) {}
+
+    const char* position() const { return p_; }
+
+    void skipWhitespace() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) {
+            ++p_;
+        }
+    }
+
+    bool consume(char expected) {
+        skipWhitespace();
+        if (p_ < end_ && *p_ == expected) {
+            ++p_;
+            return true;
+        }
+        return false;
+    }
+
+    bool peek(char expected) {
+        skipWhitespace();
+        return p_ < end_ && *p_ == expected;
+    }
+
+    // Expects `p_` at an opening quote; leaves it just past the closing quote.
+    // `body` receives the raw (still escaped) contents and `has_escapes` whether any backslash was seen.
+    bool readString(std::string_view& body, bool& has_escapes) {
+        if (p_ >= end_ || *p_ != '"') {
+            return false;
+        }
+        const char* start = ++p_;
+        has_escapes = false;
+        while (true) {
+            p_ = findStringDelimiter(p_, end_);
+            if (p_ >= end_) {
+                return false;
+            }
+            if (*p_ == '"') {
+                body = std::string_view(start, static_cast<size_t>(p_ - start));
+                ++p_;
+                return true;
+            }
+            has_escapes = true;
+            p_ += 2; // Skip the backslash and the escaped character
+        }
+    }
+
+    bool skipString() {
+        std::string_view ignored;
+        bool has_escapes;
+        return readString(ignored, has_escapes);
+    }
+
+    // Expects `p_` at '{' or '['; leaves it just past the matching close.
+    bool skipContainer() {
+        int depth = 0;
+        while (true) {
+            p_ = findStructural(p_, end_);
+            if (p_ >= end_) {
+                return false;
+            }
+            char c = *p_;
+            if (c == '"') {
+                if (!skipString()) {
+                    return false;
+                }
+                continue;
+            }
+            ++p_;
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if (--depth == 0) {
+                return true;
+            }
+        }
+    }
+
+    bool skipValue() {
+        skipWhitespace();
+        if (p_ >= end_) {
+            return false;
+        }
+        char c = *p_;
+        if (c == '"') {
+            return skipString();
+        }
+        if (c == '{' || c == '[') {
+            return skipContainer();
+        }
+        const char* start = p_;
+        while (p_ < end_ && *p_ != ',' && *p_ != '}' && *p_ != ']' && *p_ != ' ' && *p_ != '\n' && *p_ != '\r' && *p_ != '\t') {
+            ++p_;
+        }
+        return p_ != start;
+    }
+
+    // Moves to the value of `key` inside the object starting at `p_`.
+    bool enterKey(std::string_view key) {
+        if (!consume('{')) {
+            return false;
+        }
+        if (peek('}')) {
+            return false;
+        }
+        while (true) {
+            skipWhitespace();
+            std::string_view raw_key;
+            bool has_escapes;
+            if (!readString(raw_key, has_escapes) || !consume(':')) {
+                return false;
+            }
+            bool matches = raw_key == key;
+            if (!matches && has_escapes) {
+                std::optional<std::string> decoded = JsonExtractor::unescape(raw_key);
+                matches = decoded && *decoded == key;
+            }
+            if (matches) {
+                skipWhitespace();
+                return true;
+            }
+            if (!skipValue()) {
+                return false;
+            }
+            if (!consume(',')) {
+                return false; // '}' (key absent) or malformed
+            }
+        }
+    }
+
+    // Moves to element `index` of the array starting at `p_`.
+    bool enterIndex(size_t index) {
+        if (!consume('[')) {
+            return false;
+        }
+        if (peek(']')) {
+            return false;
+        }
+        for (size_t i = 0; i < index; ++i) {
+            if (!skipValue() || !consume(',')) {
+                return false;
+            }
+        }
+        skipWhitespace();
+        return true;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+};
+
+void appendUtf8(std::string& out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        out += static_cast<char>(0xC0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        out += static_cast<char>(0xE0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code_point >> 18));
+        out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+bool parseHex4(const char* p, const char* end, uint32_t& value) {
+    if (end - p < 4) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = p[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') {
+            value |= static_cast<uint32_t>(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            value |= static_cast<uint32_t>(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            value |= static_cast<uint32_t>(c - 'A' + 10);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+namespace JsonExtractor {
+
+std::optional<std::string_view> findValue(std::string_view json, const JsonPath& path) {
+    Cursor cursor(json.data(), json.data() + json.size());
+    for (const auto& step : path) {
+        bool found = step.is_index ? cursor.enterIndex(step.index) : cursor.enterKey(step.key);
+        if (!found) {
+            return std::nullopt;
+        }
+    }
+    cursor.skipWhitespace();
+    const char* start = cursor.position();
+    if (!cursor.skipValue()) {
+        return std::nullopt;
+    }
+    return std::string_view(start, static_cast<size_t>(cursor.position() - start));
+}
+
+std::optional<std::string> getString(std::string_view json, const JsonPath& path) {
+    std::optional<std::string_view> value = findValue(json, path);
+    if (!value || value->size() < 2 || value->front() != '"') {
+        return std::nullopt;
+    }
+    return unescape(value->substr(1, value->size() - 2));
+}
+
+std::optional<long long> getInteger(std::string_view json, const JsonPath& path) {
+    std::optional<std::string_view> value = findValue(json, path);
+    if (!value) {
+        return std::nullopt;
+    }
+    long long result = 0;
+    const char* end = value->data() + value->size();
+    auto parsed = std::from_chars(value->data(), end, result);
+    if (parsed.ec != std::errc() || parsed.ptr != end) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+std::optional<double> getDouble(std::string_view json, const JsonPath& path) {
+    std::optional<std::string_view> value = findValue(json, path);
+    if (!value || value->empty()) {
+        return std::nullopt;
+    }
+    char first = value->front();
+    if (first != '-' && (first < '0' || first > '9')) {
+        return std::nullopt;
+    }
+    std::string text(*value);
+    char* parse_end = nullptr;
+    double result = std::strtod(text.c_str(), &parse_end);
+    if (parse_end != text.c_str() + text.size()) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+std::optional<std::vector<std::string_view>> arrayElements(std::string_view array) {
+    Cursor cursor(array.data(), array.data() + array.size());
+    if (!cursor.consume('[')) {
+        return std::nullopt;
+    }
+    std::vector<std::string_view> elements;
+    if (cursor.consume(']')) {
+        return elements;
+    }
+    while (true) {
+        cursor.skipWhitespace();
+        const char* start = cursor.position();
+        if (!cursor.skipValue()) {
+            return std::nullopt;
+        }
+        elements.emplace_back(start, static_cast<size_t>(cursor.position() - start));
+        if (cursor.consume(']')) {
+            return elements;
+        }
+        if (!cursor.consume(',')) {
+            return std::nullopt;
+        }
+    }
+}
+
+bool appendFloats(std::string_view array, std::vector<float>& out) {
+    const char* p = array.data();
+    const char* end = p + array.size();
+    auto skipWhitespace = [&]() {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) {
+            ++p;
+        }
+    };
+    skipWhitespace();
+    if (p >= end || *p != '[') {
+        return false;
+    }
+    ++p;
+    skipWhitespace();
+    if (p < end && *p == ']') {
+        return true;
+    }
+    while (p < end) {
+        float value = 0.0f;
+        auto parsed = std::from_chars(p, end, value);
+        if (parsed.ec == std::errc::result_out_of_range) {
+            value = 0.0f; // Underflow of a tiny component; overflow does not occur in embeddings
+        } else if (parsed.ec != std::errc()) {
+            return false;
+        }
+        out.push_back(value);
+        p = parsed.ptr;
+        skipWhitespace();
+        if (p < end && *p == ']') {
+            return true;
+        }
+        if (p >= end || *p != ',') {
+            return false;
+        }
+        ++p;
+        skipWhitespace();
+    }
+    return false;
+}
+
+std::optional<std::string> unescape(std::string_view literal_body) {
+    std::string out;
+    out.reserve(literal_body.size());
+    const char* p = literal_body.data();
+    const char* end = p + literal_body.size();
+    while (p < end) {
+        const char* backslash = findStringDelimiter(p, end);
+        out.append(p, static_cast<size_t>(backslash - p));
+        if (backslash >= end) {
+            break;
+        }
+        if (*backslash == '"' || backslash + 1 >= end) {
+            return std::nullopt; // Unescaped quote or dangling backslash
+        }
+        p = backslash + 2;
+        switch (backslash[1]) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t code_point;
+                if (!parseHex4(p, end, code_point)) {
+                    return std::nullopt;
+                }
+                p += 4;
+                if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                    // High surrogate: must be followed by an escaped low surrogate
+                    uint32_t low;
+                    if (end - p < 6 || p[0] != '\\' || p[1] != 'u' || !parseHex4(p + 2, end, low) || low < 0xDC00 || low > 0xDFFF) {
+                        return std::nullopt;
+                    }
+                    p += 6;
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                } else if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+                    return std::nullopt;
+                }
+                appendUtf8(out, code_point);
+                break;
+            }
+            default:
+                return std::nullopt;
+        }
+    }
+    return out;
+}
+
+} // namespace JsonExtractor
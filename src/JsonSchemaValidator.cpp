@@ -0,0 +1,507 @@
+#include "JsonSchemaValidator.h"
+#include "JsonExtractor.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <optional>
+
+namespace {
+
+bool isWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// JSON type of a value starting with `c`, or null if no value can start with it.
+const char* valueType(char c) {
+    switch (c) {
+    case '{': return "object";
+    case '[': return "array";
+    case '"': return "string";
+    case 't':
+    case 'f': return "boolean";
+    case 'n': return "null";
+    default: return (c == '-' || (c >= '0' && c <= '9')) ? "number" : nullptr;
+    }
+}
+
+bool equalsIgnoringCase(const std::string& a, const char* b) {
+    return a.size() == std::strlen(b) && std::equal(a.begin(), a.end(), b, [](char x, char y) {
+        return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+    });
+}
+
+// Whether the schema's "type" keyword lists `type` (Gemini-style schemas spell types in upper case).
+bool listsType(const nlohmann::json& schema, const char* type) {
+    auto types = schema.find("type");
+    if (types == schema.end()) {
+        return false;
+    }
+    auto matches = [type](const nlohmann::json& name) {
+        return name.is_string() && equalsIgnoringCase(name.get_ref<const std::string&>(), type);
+    };
+    return matches(*types) || (types->is_array() && std::any_of(types->begin(), types->end(), matches));
+}
+
+// Whether a value of JSON type `type` may appear where `schema` applies. Numbers satisfy "integer"
+// until their digits show otherwise.
+bool allowsType(const nlohmann::json& schema, const char* type) {
+    if (!schema.is_object() || !schema.contains("type")) {
+        return true;
+    }
+    if (std::strcmp(type, "null") == 0 && schema.value("nullable", false)) {
+        return true;
+    }
+    return listsType(schema, type) || (std::strcmp(type, "number") == 0 && listsType(schema, "integer"));
+}
+
+std::string describeTypes(const nlohmann::json& schema) {
+    const nlohmann::json& types = schema["type"];
+    if (types.is_string()) {
+        return types.get<std::string>();
+    }
+    std::string result;
+    for (const auto& type : types) {
+        result += (result.empty() ? "" : " or ") + (type.is_string() ? type.get<std::string>() : type.dump());
+    }
+    return result;
+}
+
+bool forbidsUnknownProperties(const nlohmann::json* schema) {
+    if (!schema || !schema->is_object()) {
+        return false;
+    }
+    auto additional = schema->find("additionalProperties");
+    return additional != schema->end() && additional->is_boolean() && !additional->get<bool>();
+}
+
+const nlohmann::json* findProperties(const nlohmann::json* schema) {
+    if (!schema || !schema->is_object()) {
+        return nullptr;
+    }
+    auto properties = schema->find("properties");
+    return properties != schema->end() && properties->is_object() ? &*properties : nullptr;
+}
+
+size_t countCodePoints(const std::string& text) {
+    return static_cast<size_t>(std::count_if(text.begin(), text.end(), [](char c) { return (static_cast<unsigned char>(c) & 0xC0) != 0x80; }));
+}
+
+bool startsWith(const std::string& text, const std::string& prefix) {
+    return text.compare(0, prefix.size(), prefix) == 0;
+}
+
+std::optional<double> numberKeyword(const nlohmann::json& schema, const char* name) {
+    auto keyword = schema.find(name);
+    if (keyword == schema.end() || !keyword->is_number()) {
+        return std::nullopt;
+    }
+    return keyword->get<double>();
+}
+
+} // namespace
+
+JsonSchemaValidator::JsonSchemaValidator(nlohmann::json schema) : schema_(std::move(schema)) {}
+
+bool JsonSchemaValidator::validate(const nlohmann::json& schema, std::string_view text, std::string* error) {
+    JsonSchemaValidator validator(schema);
+    bool valid = validator.feed(text) && validator.finish();
+    if (!valid && error) {
+        *error = validator.error();
+    }
+    return valid;
+}
+
+bool JsonSchemaValidator::feed(std::string_view text) {
+    if (!error_.empty()) {
+        return false;
+    }
+    for (char c : text) {
+        if (!step(c)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool JsonSchemaValidator::finish() {
+    if (!error_.empty()) {
+        return false;
+    }
+    // A number at the top level only ends with the document.
+    if ((token_ == Token::Number || token_ == Token::Literal) && !endScalar()) {
+        return false;
+    }
+    if (phase_ == Phase::AfterDocument || (phase_ == Phase::ClosingFence && fence_ticks_ == 3)) {
+        return true;
+    }
+    return fail(path(), phase_ == Phase::InDocument ? "incomplete JSON document" : "the reply contains no JSON document");
+}
+
+bool JsonSchemaValidator::fail(const std::string& location, const std::string& message) {
+    error_ = location + ": " + message;
+    return false;
+}
+
+std::string JsonSchemaValidator::path(bool include_member) const {
+    std::string result = "$";
+    for (size_t i = 0; i < stack_.size(); ++i) {
+        if (i + 1 == stack_.size() && !include_member) {
+            break;
+        }
+        const Frame& frame = stack_[i];
+        if (frame.is_object) {
+            if (frame.count > 0) {
+                result += "." + frame.key;
+            }
+        } else if (frame.count > 0) {
+            result += "[" + std::to_string(frame.count - 1) + "]";
+        }
+    }
+    return result;
+}
+
+const nlohmann::json* JsonSchemaValidator::childSchema() const {
+    const Frame& frame = stack_.back();
+    if (!frame.schema || !frame.schema->is_object()) {
+        return nullptr;
+    }
+    if (frame.is_object) {
+        if (const nlohmann::json* properties = findProperties(frame.schema)) {
+            auto property = properties->find(frame.key);
+            if (property != properties->end()) {
+                return &*property;
+            }
+        }
+        auto additional = frame.schema->find("additionalProperties");
+        return additional != frame.schema->end() && additional->is_object() ? &*additional : nullptr;
+    }
+    auto items = frame.schema->find("items");
+    return items != frame.schema->end() && items->is_object() ? &*items : nullptr;
+}
+
+bool JsonSchemaValidator::step(char c) {
+    switch (phase_) {
+    case Phase::BeforeDocument:
+        if (isWhitespace(c)) {
+            return true;
+        }
+        if (c == '`' && !fenced_) {
+            phase_ = Phase::OpeningFence;
+            fence_ticks_ = 1;
+            return true;
+        }
+        phase_ = Phase::InDocument;
+        return beginValue(c, &schema_);
+    case Phase::OpeningFence:
+        if (fence_ticks_ < 3) {
+            if (c != '`') {
+                return fail("$", "unexpected text before the JSON document");
+            }
+            ++fence_ticks_;
+        } else if (c == '\n') {
+            // The rest of the fence line is a language tag.
+            phase_ = Phase::BeforeDocument;
+            fenced_ = true;
+        }
+        return true;
+    case Phase::AfterDocument:
+        if (isWhitespace(c)) {
+            return true;
+        }
+        if (c == '`' && fenced_) {
+            phase_ = Phase::ClosingFence;
+            fence_ticks_ = 1;
+            return true;
+        }
+        return fail("$", "unexpected text after the JSON document");
+    case Phase::ClosingFence:
+        if (c == '`' && fence_ticks_ < 3) {
+            ++fence_ticks_;
+            return true;
+        }
+        if (fence_ticks_ == 3 && isWhitespace(c)) {
+            return true;
+        }
+        return fail("$", "unexpected text after the JSON document");
+    case Phase::InDocument:
+        break;
+    }
+
+    switch (token_) {
+    case Token::String:
+        return stringCharacter(c);
+    case Token::Number:
+        if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+            token_text_ += c;
+            return true;
+        }
+        break;
+    case Token::Literal:
+        if (std::isalpha(static_cast<unsigned char>(c))) {
+            const std::string word = token_text_[0] == 't' ? "true" : token_text_[0] == 'f' ? "false" : "null";
+            if (token_text_.size() >= word.size() || word[token_text_.size()] != c) {
+                return fail(path(), "invalid literal \"" + token_text_ + c + "\"");
+            }
+            token_text_ += c;
+            return true;
+        }
+        break;
+    case Token::None:
+        return structural(c);
+    }
+    // The character ends a number or literal.
+    if (!endScalar()) {
+        return false;
+    }
+    return phase_ == Phase::InDocument ? structural(c) : step(c);
+}
+
+bool JsonSchemaValidator::structural(char c) {
+    if (isWhitespace(c)) {
+        return true;
+    }
+    Frame& frame = stack_.back();
+    switch (frame.expect) {
+    case Expect::ValueOrEnd:
+        if (c == ']') {
+            return closeContainer();
+        }
+        [[fallthrough]];
+    case Expect::Value:
+        if (!frame.is_object) {
+            ++frame.count;
+            if (frame.schema && frame.schema->is_object()) {
+                auto max_items = frame.schema->find("maxItems");
+                if (max_items != frame.schema->end() && max_items->is_number_unsigned() && frame.count > max_items->get<size_t>()) {
+                    return fail(path(false), "array has more than " + max_items->dump() + " items");
+                }
+            }
+        }
+        return beginValue(c, childSchema());
+    case Expect::KeyOrEnd:
+        if (c == '}') {
+            return closeContainer();
+        }
+        [[fallthrough]];
+    case Expect::Key:
+        if (c != '"') {
+            return fail(path(false), "expected a property name");
+        }
+        token_ = Token::String;
+        token_is_key_ = true;
+        token_escaped_ = false;
+        token_prefix_checks_ = forbidsUnknownProperties(frame.schema);
+        in_escape_ = false;
+        token_text_.clear();
+        return true;
+    case Expect::Colon:
+        if (c != ':') {
+            return fail(path(), "expected ':'");
+        }
+        frame.expect = Expect::Value;
+        return true;
+    case Expect::CommaOrEnd:
+        if (c == ',') {
+            frame.expect = frame.is_object ? Expect::Key : Expect::Value;
+            return true;
+        }
+        if (c == (frame.is_object ? '}' : ']')) {
+            return closeContainer();
+        }
+        return fail(path(), frame.is_object ? "expected ',' or '}'" : "expected ',' or ']'");
+    }
+    return false;
+}
+
+bool JsonSchemaValidator::beginValue(char c, const nlohmann::json* schema) {
+    const char* type = valueType(c);
+    if (!type) {
+        return fail(path(), std::string("unexpected character '") + c + "'");
+    }
+    if (schema && !allowsType(*schema, type)) {
+        return fail(path(), "expected " + describeTypes(*schema) + ", got " + type);
+    }
+    if (c == '{' || c == '[') {
+        stack_.push_back(Frame{c == '{', schema, c == '{' ? Expect::KeyOrEnd : Expect::ValueOrEnd});
+        return true;
+    }
+    token_schema_ = schema;
+    token_is_key_ = false;
+    token_escaped_ = false;
+    in_escape_ = false;
+    if (c == '"') {
+        token_ = Token::String;
+        token_text_.clear();
+        token_prefix_checks_ = schema && schema->is_object() &&
+                               (schema->contains("enum") || schema->contains("const") || schema->contains("maxLength"));
+    } else {
+        token_ = c == '-' || (c >= '0' && c <= '9') ? Token::Number : Token::Literal;
+        token_text_.assign(1, c);
+    }
+    return true;
+}
+
+bool JsonSchemaValidator::stringCharacter(char c) {
+    if (in_escape_) {
+        in_escape_ = false;
+        token_text_ += c;
+        return true;
+    }
+    if (c == '"') {
+        token_ = Token::None;
+        return endString();
+    }
+    if (static_cast<unsigned char>(c) < 0x20) {
+        return fail(path(!token_is_key_), "control character in string");
+    }
+    token_text_ += c;
+    if (c == '\\') {
+        in_escape_ = true;
+        token_escaped_ = true;
+    }
+    if (!token_prefix_checks_ || token_escaped_) {
+        return true; // Prefix checks compare raw text, which escapes would distort
+    }
+
+    // Reject as soon as no completion of the string could be accepted.
+    if (token_is_key_) {
+        const nlohmann::json* properties = findProperties(stack_.back().schema);
+        bool possible = properties && std::any_of(properties->items().begin(), properties->items().end(),
+                                                  [this](const auto& property) { return startsWith(property.key(), token_text_); });
+        if (!possible) {
+            return fail(path(false), "unexpected property \"" + token_text_ + "...\"");
+        }
+        return true;
+    }
+    auto allowed = token_schema_->find("enum");
+    if (allowed != token_schema_->end() && allowed->is_array()) {
+        bool possible = std::any_of(allowed->begin(), allowed->end(), [this](const nlohmann::json& value) {
+            return value.is_string() && startsWith(value.get_ref<const std::string&>(), token_text_);
+        });
+        if (!possible) {
+            return fail(path(), "\"" + token_text_ + "...\" is not one of " + allowed->dump());
+        }
+    }
+    auto constant = token_schema_->find("const");
+    if (constant != token_schema_->end() && constant->is_string() && !startsWith(constant->get_ref<const std::string&>(), token_text_)) {
+        return fail(path(), "\"" + token_text_ + "...\" does not match the constant " + constant->dump());
+    }
+    auto max_length = token_schema_->find("maxLength");
+    if (max_length != token_schema_->end() && max_length->is_number_unsigned() && countCodePoints(token_text_) > max_length->get<size_t>()) {
+        return fail(path(), "string is longer than " + max_length->dump() + " characters");
+    }
+    return true;
+}
+
+bool JsonSchemaValidator::endString() {
+    std::optional<std::string> value = JsonExtractor::unescape(token_text_);
+    if (!value) {
+        return fail(path(!token_is_key_), "invalid escape sequence in string");
+    }
+    if (!token_is_key_) {
+        return checkScalar(nlohmann::json(std::move(*value))) && valueDone();
+    }
+
+    Frame& frame = stack_.back();
+    if (std::find(frame.keys.begin(), frame.keys.end(), *value) != frame.keys.end()) {
+        return fail(path(false), "duplicate property \"" + *value + "\"");
+    }
+    if (forbidsUnknownProperties(frame.schema)) {
+        const nlohmann::json* properties = findProperties(frame.schema);
+        if (!properties || !properties->contains(*value)) {
+            return fail(path(false), "unexpected property \"" + *value + "\"");
+        }
+    }
+    frame.key = *value;
+    frame.keys.push_back(std::move(*value));
+    ++frame.count;
+    frame.expect = Expect::Colon;
+    return true;
+}
+
+bool JsonSchemaValidator::endScalar() {
+    const bool is_number = token_ == Token::Number;
+    token_ = Token::None;
+    nlohmann::json value = nlohmann::json::parse(token_text_, nullptr, false);
+    if (value.is_discarded() || value.is_number() != is_number) {
+        return fail(path(), std::string(is_number ? "invalid number" : "invalid literal") + " \"" + token_text_ + "\"");
+    }
+    return checkScalar(value) && valueDone();
+}
+
+bool JsonSchemaValidator::checkScalar(const nlohmann::json& value) {
+    const nlohmann::json* schema = token_schema_;
+    if (!schema || !schema->is_object()) {
+        return true;
+    }
+    if (value.is_string()) {
+        size_t length = countCodePoints(value.get_ref<const std::string&>());
+        auto min_length = schema->find("minLength");
+        if (min_length != schema->end() && min_length->is_number_unsigned() && length < min_length->get<size_t>()) {
+            return fail(path(), "string is shorter than " + min_length->dump() + " characters");
+        }
+        auto max_length = schema->find("maxLength");
+        if (max_length != schema->end() && max_length->is_number_unsigned() && length > max_length->get<size_t>()) {
+            return fail(path(), "string is longer than " + max_length->dump() + " characters");
+        }
+    } else if (value.is_number()) {
+        double number = value.get<double>();
+        if (listsType(*schema, "integer") && !listsType(*schema, "number") && value.is_number_float() && std::floor(number) != number) {
+            return fail(path(), "expected integer, got " + token_text_);
+        }
+        if (std::optional<double> minimum = numberKeyword(*schema, "minimum"); minimum && number < *minimum) {
+            return fail(path(), token_text_ + " is less than the minimum " + schema->at("minimum").dump());
+        }
+        if (std::optional<double> maximum = numberKeyword(*schema, "maximum"); maximum && number > *maximum) {
+            return fail(path(), token_text_ + " is greater than the maximum " + schema->at("maximum").dump());
+        }
+        if (std::optional<double> minimum = numberKeyword(*schema, "exclusiveMinimum"); minimum && number <= *minimum) {
+            return fail(path(), token_text_ + " is not greater than " + schema->at("exclusiveMinimum").dump());
+        }
+        if (std::optional<double> maximum = numberKeyword(*schema, "exclusiveMaximum"); maximum && number >= *maximum) {
+            return fail(path(), token_text_ + " is not less than " + schema->at("exclusiveMaximum").dump());
+        }
+    }
+    auto allowed = schema->find("enum");
+    if (allowed != schema->end() && allowed->is_array() && std::find(allowed->begin(), allowed->end(), value) == allowed->end()) {
+        return fail(path(), "value is not one of " + allowed->dump());
+    }
+    auto constant = schema->find("const");
+    if (constant != schema->end() && *constant != value) {
+        return fail(path(), "value does not match the constant " + constant->dump());
+    }
+    return true;
+}
+
+bool JsonSchemaValidator::closeContainer() {
+    const Frame& frame = stack_.back();
+    if (frame.schema && frame.schema->is_object()) {
+        if (frame.is_object) {
+            auto required = frame.schema->find("required");
+            if (required != frame.schema->end() && required->is_array()) {
+                for (const auto& name : *required) {
+                    if (name.is_string() && std::find(frame.keys.begin(), frame.keys.end(), name.get<std::string>()) == frame.keys.end()) {
+                        return fail(path(false), "missing required property " + name.dump());
+                    }
+                }
+            }
+        } else {
+            auto min_items = frame.schema->find("minItems");
+            if (min_items != frame.schema->end() && min_items->is_number_unsigned() && frame.count < min_items->get<size_t>()) {
+                return fail(path(false), "array has fewer than " + min_items->dump() + " items");
+            }
+        }
+    }
+    stack_.pop_back();
+    return valueDone();
+}
+
+bool JsonSchemaValidator::valueDone() {
+    if (stack_.empty()) {
+        phase_ = Phase::AfterDocument;
+    } else {
+        stack_.back().expect = Expect::CommaOrEnd;
+    }
+    return true;
+}
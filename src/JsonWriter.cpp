@@ -0,0 +1,235 @@
+#include "JsonWriter.h"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#define HAICL_JSON_WRITER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Returns true if `c` cannot appear unescaped inside a JSON string.
+inline bool needsEscape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+size_t findEscapeScalar(const char* data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        if (needsEscape(static_cast<unsigned char>(data[i]))) {
+            return i;
+        }
+    }
+    return size;
+}
+
+#ifdef HAICL_JSON_WRITER_X86
+
+size_t findEscapeSse2(const char* data, size_t size) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control_max = _mm_set1_epi8(0x1F);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        // Unsigned c <= 0x1F  <=>  max(c, 0x1F) == 0x1F
+        __m128i is_control = _mm_cmpeq_epi8(_mm_max_epu8(chunk, control_max), control_max);
+        __m128i hits = _mm_or_si128(is_control, _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+        }
+    }
+    return i + findEscapeScalar(data + i, size - i);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define HAICL_JSON_WRITER_AVX2 1
+
+__attribute__((target("avx2")))
+size_t findEscapeAvx2(const char* data, size_t size) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control_max = _mm256_set1_epi8(0x1F);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i is_control = _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, control_max), control_max);
+        __m256i hits = _mm256_or_si256(is_control, _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+        if (mask != 0) {
+            return i + static_cast<size_t>(__builtin_ctz(mask));
+        }
+    }
+    return i + findEscapeSse2(data + i, size - i);
+}
+#endif
+
+#endif // HAICL_JSON_WRITER_X86
+
+using FindEscapeFn = size_t (*)(const char*, size_t);
+
+FindEscapeFn selectFindEscape() {
+#if defined(HAICL_JSON_WRITER_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        return findEscapeAvx2;
+    }
+#endif
+#if defined(HAICL_JSON_WRITER_X86)
+    return findEscapeSse2;
+#else
+    return findEscapeScalar;
+#endif
+}
+
+// Resolved once; the CPU does not change underneath us.
+const FindEscapeFn find_escape = selectFindEscape();
+
+void appendEscapedChar(std::string& out, unsigned char c) {
+    static const char hex_digits[] = "0123456789abcdef";
+    switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default: {
+            char buf[6] = {'\\', 'u', '0', '0', hex_digits[c >> 4], hex_digits[c & 0x0F]};
+            out.append(buf, sizeof(buf));
+            break;
+        }
+    }
+}
+
+} // namespace
+
+void appendJsonEscaped(std::string& out, std::string_view text) {
+    const char* data = text.data();
+    size_t remaining = text.size();
+    while (remaining > 0) {
+        size_t clean = find_escape(data, remaining);
+        out.append(data, clean);
+        if (clean == remaining) {
+            break;
+        }
+        appendEscapedChar(out, static_cast<unsigned char>(data[clean]));
+        data += clean + 1;
+        remaining -= clean + 1;
+    }
+}
+
+JsonWriter::JsonWriter(std::string& out)
+    : out_(out) {
+}
+
+void JsonWriter::separate() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (!first_in_scope_.empty()) {
+        if (first_in_scope_.back()) {
+            first_in_scope_.back() = false;
+        } else {
+            out_ += ',';
+        }
+    }
+}
+
+void JsonWriter::beginObject() {
+    separate();
+    out_ += '{';
+    first_in_scope_.push_back(true);
+}
+
+void JsonWriter::endObject() {
+    out_ += '}';
+    first_in_scope_.pop_back();
+}
+
+void JsonWriter::beginArray() {
+    separate();
+    out_ += '[';
+    first_in_scope_.push_back(true);
+}
+
+void JsonWriter::endArray() {
+    out_ += ']';
+    first_in_scope_.pop_back();
+}
+
+void JsonWriter::key(std::string_view name) {
+    separate();
+    out_ += '"';
+    appendJsonEscaped(out_, name);
+    out_ += "\":";
+    after_key_ = true;
+}
+
+void JsonWriter::value(std::string_view text) {
+    separate();
+    out_ += '"';
+    appendJsonEscaped(out_, text);
+    out_ += '"';
+}
+
+void JsonWriter::value(const char* text) {
+    value(std::string_view(text));
+}
+
+void JsonWriter::value(const std::string& text) {
+    value(std::string_view(text));
+}
+
+void JsonWriter::value(bool flag) {
+    separate();
+    out_ += flag ? "true" : "false";
+}
+
+void JsonWriter::value(int number) {
+    value(static_cast<long long>(number));
+}
+
+void JsonWriter::value(long long number) {
+    separate();
+    char buf[24];
+    auto result = std::to_chars(buf, buf + sizeof(buf), number);
+    out_.append(buf, result.ptr);
+}
+
+void JsonWriter::value(double number) {
+    separate();
+    if (!std::isfinite(number)) {
+        // JSON has no representation for NaN/Inf; mirror nlohmann::json and emit null.
+        out_ += "null";
+        return;
+    }
+    char buf[32];
+    auto result = std::to_chars(buf, buf + sizeof(buf), number);
+    out_.append(buf, result.ptr);
+}
+
+void JsonWriter::null() {
+    separate();
+    out_ += "null";
+}
+
+void JsonWriter::rawValue(std::string_view json) {
+    separate();
+    out_ += json;
+}
+
+void JsonWriter::rawMembers(std::string_view members) {
+    if (members.empty()) {
+        return;
+    }
+    separate();
+    out_ += members;
+}
+
+void JsonWriter::rawElements(std::string_view elements) {
+    rawMembers(elements);
+}
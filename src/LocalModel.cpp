@@ -0,0 +1,311 @@
+#include "LocalModel.h"
+#include "JsonExtractor.h"
+#include "ProviderTraits.h"
+#include "SseParser.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+// Limit for one embeddings request; local servers embed the inputs sequentially anyway.
+constexpr size_t kMaxEmbeddingInputsPerRequest = 64;
+
+// Ollama reads a bare number as seconds and anything else as a Go duration ("30m", "1h").
+std::string keepAliveValue(const std::string& keep_alive) {
+    if (keep_alive.empty()) {
+        return "";
+    }
+    size_t digits = keep_alive[0] == '-' ? 1 : 0;
+    bool numeric = digits < keep_alive.size() && keep_alive.find_first_not_of("0123456789", digits) == std::string::npos;
+    std::string value;
+    JsonWriter writer(value);
+    if (numeric) {
+        writer.rawValue(keep_alive);
+    } else {
+        writer.value(keep_alive);
+    }
+    return value;
+}
+
+} // namespace
+
+LocalModel::LocalModel(const std::string& base_url, const std::string& model_name, Api api, const std::string& keep_alive, int num_ctx)
+    : base_url_(base_url),
+      model_name_(model_name),
+      api_(api),
+      keep_alive_(keepAliveValue(keep_alive)),
+      num_ctx_(num_ctx) {
+    while (!base_url_.empty() && base_url_.back() == '/') {
+        base_url_.pop_back();
+    }
+    if (api_ == Api::LlamaCpp && !keep_alive.empty()) {
+        std::cerr << "Warning: keep_alive is ignored by llama.cpp servers, which keep their model loaded." << std::endl;
+    }
+}
+
+std::optional<LocalModel::Api> LocalModel::parseApi(const std::string& name) {
+    if (name == "ollama") {
+        return Api::Ollama;
+    }
+    if (name == "llamacpp" || name == "llama.cpp") {
+        return Api::LlamaCpp;
+    }
+    return std::nullopt;
+}
+
+std::string LocalModel::serializeParams(const GenerationParams& params) const {
+    // Sampling settings. Ollama takes them inside "options", where its own tunables (repeat_penalty,
+    // mirostat, num_gpu...) live as well, so unknown parameters are forwarded there too.
+    std::string options;
+    JsonWriter writer(options);
+    writer.beginObject();
+    if (api_ == Api::Ollama) {
+        ProviderTraits::writeSamplingParams<ProviderTraits::Ollama>(writer, params);
+    } else {
+        ProviderTraits::writeSamplingParams<ProviderTraits::LlamaCpp>(writer, params);
+    }
+    if (api_ == Api::Ollama && num_ctx_ > 0 && !params.extra.contains("num_ctx")) {
+        // Sent with every request: a different num_ctx than the loaded one makes Ollama reload the model.
+        writer.key("num_ctx");
+        writer.value(num_ctx_);
+    }
+    for (auto it = params.extra.begin(); it != params.extra.end(); ++it) {
+        writer.key(it.key());
+        writer.rawValue(it.value().dump());
+    }
+    writer.endObject();
+
+    std::string object;
+    JsonWriter members(object);
+    members.beginObject();
+    if (api_ == Api::LlamaCpp) {
+        members.rawMembers(options.substr(1, options.size() - 2));
+    } else if (options.size() > 2) {
+        members.key("options");
+        members.rawValue(options);
+    }
+    if (!params.json_schema.is_null()) {
+        if (api_ == Api::Ollama) {
+            members.key("format");
+            members.rawValue(params.json_schema.dump());
+        } else {
+            // llama.cpp turns the schema into a grammar that constrains sampling.
+            members.key("response_format");
+            members.beginObject();
+            members.key("type");
+            members.value("json_schema");
+            members.key("json_schema");
+            members.beginObject();
+            members.key("schema");
+            members.rawValue(params.json_schema.dump());
+            members.endObject();
+            members.endObject();
+        }
+    }
+    members.endObject();
+    return object.substr(1, object.size() - 2);
+}
+
+std::string LocalModel::chatUrl() const {
+    return base_url_ + std::string(api_ == Api::Ollama ? ProviderTraits::Ollama::endpoint : ProviderTraits::LlamaCpp::endpoint);
+}
+
+std::string LocalModel::buildRequest(const std::vector<Message>& messages, const GenerationParams& params, bool stream) {
+    const std::string& encoded_messages = api_ == Api::Ollama ? message_cache_.encode(messages, ProviderTraits::encodeMessage<ProviderTraits::Ollama>)
+                                                              : message_cache_.encode(messages, ProviderTraits::encodeMessage<ProviderTraits::LlamaCpp>);
+    std::string request_body;
+    request_body.reserve(encoded_messages.size() + 512);
+
+    JsonWriter writer(request_body);
+    writer.beginObject();
+    writer.key("model");
+    writer.value(model_name_);
+    writer.key("stream");
+    writer.value(stream);
+    if (api_ == Api::Ollama) {
+        if (!keep_alive_.empty()) {
+            writer.key("keep_alive");
+            writer.rawValue(keep_alive_);
+        }
+    } else {
+        // Reuse the KV cache of the previous turn for the unchanged conversation prefix.
+        writer.key("cache_prompt");
+        writer.value(true);
+        if (stream) {
+            writer.key("stream_options");
+            writer.beginObject();
+            writer.key("include_usage");
+            writer.value(true);
+            writer.endObject();
+        }
+    }
+    writer.key("messages");
+    writer.beginArray();
+    writer.rawElements(encoded_messages);
+    writer.endArray();
+    writer.rawMembers(params_fragment_.get(params, [this](const GenerationParams& p) { return serializeParams(p); }));
+    writer.endObject();
+    return request_body;
+}
+
+std::optional<TokenUsage> LocalModel::parseUsage(std::string_view raw_response) const {
+    return api_ == Api::Ollama ? ProviderTraits::parseUsage<ProviderTraits::Ollama>(raw_response) : ProviderTraits::parseUsage<ProviderTraits::LlamaCpp>(raw_response);
+}
+
+std::optional<Message> LocalModel::parseReply(const std::string& raw_response) {
+    std::optional<std::string> content =
+        JsonExtractor::getString(raw_response, api_ == Api::Ollama ? ProviderTraits::Ollama::reply_text : ProviderTraits::LlamaCpp::reply_text);
+    if (content) {
+        return Message{"assistant", std::move(*content)};
+    }
+    std::optional<nlohmann::json> response = HttpClient::parseResponse(raw_response);
+    if (response) {
+        std::cerr << "Error: Unexpected local server response format: " << response->dump(2) << std::endl;
+    }
+    return std::nullopt;
+}
+
+std::optional<Message> LocalModel::sendMessage(const std::vector<Message>& messages, const GenerationParams& params) {
+    return send(messages, params, nullptr);
+}
+
+std::optional<Message> LocalModel::sendMessageStreaming(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback& on_delta) {
+    return send(messages, params, &on_delta);
+}
+
+std::optional<Message> LocalModel::send(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback* on_delta) {
+    last_usage_.reset();
+    const std::map<std::string, std::string> headers = {{"Content-Type", "application/json"}};
+    if (!on_delta) {
+        std::optional<std::string> raw_response = http_client_.postSerializedRaw(chatUrl(), headers, buildRequest(messages, params, false));
+        if (!raw_response) {
+            return std::nullopt;
+        }
+        std::optional<Message> reply = parseReply(*raw_response);
+        if (reply) {
+            last_usage_ = parseUsage(*raw_response);
+        }
+        return reply;
+    }
+
+    Message reply{"assistant", ""};
+    bool stream_failed = false;
+    bool finished = false;
+    const JsonPath& delta_path = api_ == Api::Ollama ? ProviderTraits::Ollama::stream_text : ProviderTraits::LlamaCpp::stream_text;
+    // Both APIs stream one JSON object per event: a line of NDJSON (Ollama) or an SSE data field.
+    auto on_event = [&](std::string_view data) {
+        if (api_ == Api::Ollama ? ProviderTraits::isFinalStreamEvent<ProviderTraits::Ollama>(data)
+                                : ProviderTraits::isFinalStreamEvent<ProviderTraits::LlamaCpp>(data)) {
+            finished = true;
+        }
+        if (data == "[DONE]") {
+            return true;
+        }
+        std::optional<std::string> delta = JsonExtractor::getString(data, delta_path);
+        if (delta) {
+            if (!delta->empty()) {
+                reply.content += *delta;
+                if (!(*on_delta)(*delta)) {
+                    return false;
+                }
+            }
+        } else if (std::optional<std::string_view> error = JsonExtractor::findValue(data, {"error"})) {
+            std::cerr << "Error: Local model stream failed: " << *error << std::endl;
+            stream_failed = true;
+            return false;
+        }
+        if (std::optional<TokenUsage> usage = parseUsage(data)) {
+            last_usage_ = usage;
+        }
+        return true;
+    };
+
+    bool complete;
+    std::string body = buildRequest(messages, params, true);
+    if (api_ == Api::Ollama) {
+        std::string pending; // Start of an incomplete line
+        complete = http_client_.postStreaming(chatUrl(), headers, body, [&](std::string_view chunk) {
+            size_t start = 0;
+            for (size_t newline = chunk.find('\n'); newline != std::string_view::npos; newline = chunk.find('\n', start)) {
+                std::string_view line = chunk.substr(start, newline - start);
+                if (!pending.empty()) {
+                    pending.append(line);
+                    line = pending;
+                }
+                bool keep_going = line.empty() || on_event(line);
+                pending.clear();
+                if (!keep_going) {
+                    return false;
+                }
+                start = newline + 1;
+            }
+            pending.append(chunk.substr(start));
+            return true;
+        });
+        if (complete && !pending.empty() && !on_event(pending)) {
+            complete = false;
+        }
+    } else {
+        SseParser parser(on_event);
+        complete = http_client_.postStreaming(chatUrl(), headers, body, [&parser](std::string_view chunk) { return parser.feed(chunk); });
+    }
+    if (complete && !stream_failed && !finished) {
+        std::cerr << "Error: The local model stream ended before the reply was complete." << std::endl;
+    } else if (complete && !stream_failed && reply.content.empty()) {
+        std::cerr << "Error: The local model returned an empty reply." << std::endl;
+    }
+    if (!complete || stream_failed || !finished || reply.content.empty()) {
+        last_usage_.reset();
+        return std::nullopt;
+    }
+    return reply;
+}
+
+std::optional<EmbeddingMatrix> LocalModel::embedBatch(const std::vector<std::string>& texts) {
+    EmbeddingMatrix matrix;
+    matrix.rows = texts.size();
+    const std::map<std::string, std::string> headers = {{"Content-Type", "application/json"}};
+    const std::string url = base_url_ + (api_ == Api::Ollama ? "/api/embed" : "/v1/embeddings");
+    std::vector<float> embedding;
+    for (size_t begin = 0; begin < texts.size(); begin += kMaxEmbeddingInputsPerRequest) {
+        size_t end = std::min(texts.size(), begin + kMaxEmbeddingInputsPerRequest);
+        std::string request_body;
+        JsonWriter writer(request_body);
+        writer.beginObject();
+        writer.key("model");
+        writer.value(embedding_model_);
+        if (api_ == Api::Ollama && !keep_alive_.empty()) {
+            writer.key("keep_alive");
+            writer.rawValue(keep_alive_);
+        }
+        writer.key("input");
+        writer.beginArray();
+        for (size_t i = begin; i < end; ++i) {
+            writer.value(texts[i]);
+        }
+        writer.endArray();
+        writer.endObject();
+
+        std::optional<std::string> raw_response = http_client_.postSerializedRaw(url, headers, request_body);
+        if (!raw_response) {
+            return std::nullopt;
+        }
+        // Ollama: {"embeddings": [[...], ...]}; llama.cpp: OpenAI-style {"data": [{"embedding": [...]}, ...]}.
+        std::optional<std::string_view> list = JsonExtractor::findValue(*raw_response, {api_ == Api::Ollama ? "embeddings" : "data"});
+        std::optional<std::vector<std::string_view>> items = list ? JsonExtractor::arrayElements(*list) : std::nullopt;
+        if (!items || items->size() != end - begin) {
+            std::cerr << "Error: Unexpected local embeddings response: " << raw_response->substr(0, 512) << std::endl;
+            return std::nullopt;
+        }
+        for (size_t i = 0; i < items->size(); ++i) {
+            std::optional<std::string_view> value = api_ == Api::Ollama ? std::optional<std::string_view>((*items)[i])
+                                                                        : JsonExtractor::findValue((*items)[i], {"embedding"});
+            embedding.clear();
+            if (!value || !JsonExtractor::appendFloats(*value, embedding) || embedding.empty() || !matrix.assignRow(begin + i, embedding)) {
+                std::cerr << "Error: Malformed or inconsistent embedding in local embeddings response." << std::endl;
+                return std::nullopt;
+            }
+        }
+    }
+    return matrix;
+}
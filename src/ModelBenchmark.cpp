@@ -0,0 +1,232 @@
+#include "ModelBenchmark.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+struct Percentiles {
+    size_t count = 0;
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+};
+
+// Nearest-rank percentiles, so every reported value is an observed one.
+Percentiles percentiles(std::vector<double> values) {
+    Percentiles result;
+    result.count = values.size();
+    if (values.empty()) {
+        return result;
+    }
+    std::sort(values.begin(), values.end());
+    auto rank = [&values](double p) {
+        size_t index = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(values.size())));
+        return values[std::max<size_t>(index, 1) - 1];
+    };
+    double sum = 0.0;
+    for (double value : values) {
+        sum += value;
+    }
+    result.mean = sum / static_cast<double>(values.size());
+    result.p50 = rank(50);
+    result.p90 = rank(90);
+    result.p99 = rank(99);
+    return result;
+}
+
+struct ResultStats {
+    size_t errors = 0;
+    Percentiles first_token_ms;
+    Percentiles total_ms;
+    Percentiles tokens_per_second;
+    long long completion_tokens = 0;
+};
+
+ResultStats statistics(const ModelBenchmark::Result& result) {
+    ResultStats stats;
+    std::vector<double> first_token_ms;
+    std::vector<double> total_ms;
+    std::vector<double> tokens_per_second;
+    for (const auto& sample : result.samples) {
+        if (!sample.ok) {
+            ++stats.errors;
+            continue;
+        }
+        total_ms.push_back(sample.timing.total_seconds * 1000.0);
+        if (sample.timing.first_token_seconds) {
+            first_token_ms.push_back(*sample.timing.first_token_seconds * 1000.0);
+        }
+        if (sample.usage && sample.usage->completion_tokens > 0) {
+            stats.completion_tokens += sample.usage->completion_tokens;
+            tokens_per_second.push_back(sample.timing.tokensPerSecond(sample.usage->completion_tokens));
+        }
+    }
+    stats.first_token_ms = percentiles(std::move(first_token_ms));
+    stats.total_ms = percentiles(std::move(total_ms));
+    stats.tokens_per_second = percentiles(std::move(tokens_per_second));
+    return stats;
+}
+
+nlohmann::ordered_json percentilesJson(const Percentiles& values) {
+    if (values.count == 0) {
+        return nullptr;
+    }
+    auto round = [](double value) { return std::round(value * 10.0) / 10.0; };
+    return {{"count", values.count}, {"mean", round(values.mean)}, {"p50", round(values.p50)}, {"p90", round(values.p90)}, {"p99", round(values.p99)}};
+}
+
+// "p50/p90/p99", or "-" if nothing was measured.
+std::string formatPercentiles(const Percentiles& values, int precision) {
+    if (values.count == 0) {
+        return "-";
+    }
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(precision) << values.p50 << "/" << values.p90 << "/" << values.p99;
+    return oss.str();
+}
+
+} // namespace
+
+std::vector<std::string> ModelBenchmark::defaultPrompts() {
+    return {
+        "Reply with the single word: ready",
+        "List five prime numbers greater than 100, one per line.",
+        "Write a C++ function that reverses a singly linked list. Only output the code.",
+        "Explain in about 150 words why the sky appears blue.",
+        "Summarize the plot of Romeo and Juliet in three sentences.",
+    };
+}
+
+std::optional<ModelBenchmark::Target> ModelBenchmark::parseTarget(const std::string& spec) {
+    size_t slash = spec.find('/');
+    Target target;
+    target.provider = spec.substr(0, slash);
+    if (slash != std::string::npos) {
+        target.model = spec.substr(slash + 1);
+    }
+    if (target.provider.empty() || (slash != std::string::npos && target.model.empty())) {
+        return std::nullopt;
+    }
+    return target;
+}
+
+std::optional<std::vector<ModelBenchmark::Result>> ModelBenchmark::run(const std::vector<Target>& targets, const std::vector<std::string>& prompts, size_t runs,
+                                                                       size_t concurrency, const ModelFactory& create_model) {
+    concurrency = std::max<size_t>(concurrency, 1);
+    const size_t jobs = prompts.size() * runs;
+    std::vector<Result> results(targets.size());
+    // Models are not thread-safe: one per worker.
+    std::vector<std::vector<std::unique_ptr<IAIModel>>> models(targets.size());
+    for (size_t t = 0; t < targets.size(); ++t) {
+        for (size_t w = 0; w < concurrency; ++w) {
+            std::unique_ptr<IAIModel> model = create_model(targets[t]);
+            if (!model) {
+                return std::nullopt;
+            }
+            models[t].push_back(std::move(model));
+        }
+        results[t].target = targets[t];
+        results[t].model_name = models[t].front()->modelName();
+        results[t].samples.resize(jobs);
+    }
+
+    std::vector<std::atomic<size_t>> next_job(targets.size());
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < targets.size(); ++t) {
+        for (size_t w = 0; w < concurrency; ++w) {
+            workers.emplace_back([&, t, w]() {
+                IAIModel& model = *models[t][w];
+                for (size_t job = next_job[t]++; job < jobs; job = next_job[t]++) {
+                    // Every prompt once before any is repeated.
+                    std::vector<Message> messages = {{"user", prompts[job % prompts.size()]}};
+                    Sample& sample = results[t].samples[job];
+                    TurnTimer timer;
+                    std::optional<Message> reply = model.sendMessageStreaming(messages, targets[t].params, [&timer](std::string_view) {
+                        timer.markDelta();
+                        return true;
+                    });
+                    sample.timing = timer.elapsed();
+                    sample.ok = reply.has_value();
+                    if (reply) {
+                        sample.usage = model.lastUsage();
+                    }
+                }
+            });
+        }
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return results;
+}
+
+std::string ModelBenchmark::formatTable(const std::vector<Result>& results) {
+    const std::vector<std::string> header = {"Target", "Requests", "Errors", "TTFT ms p50/p90/p99", "Total ms p50/p90/p99", "Tokens/s p50/p90/p99"};
+    std::vector<std::vector<std::string>> rows = {header};
+    for (const auto& result : results) {
+        ResultStats stats = statistics(result);
+        std::ostringstream error_rate;
+        error_rate << std::fixed << std::setprecision(1) << (result.samples.empty() ? 0.0 : 100.0 * static_cast<double>(stats.errors) / static_cast<double>(result.samples.size())) << "%";
+        rows.push_back({result.target.label(), std::to_string(result.samples.size()), error_rate.str(), formatPercentiles(stats.first_token_ms, 0),
+                        formatPercentiles(stats.total_ms, 0), formatPercentiles(stats.tokens_per_second, 1)});
+    }
+    std::vector<size_t> widths(header.size(), 0);
+    for (const auto& row : rows) {
+        for (size_t i = 0; i < row.size(); ++i) {
+            widths[i] = std::max(widths[i], row[i].size());
+        }
+    }
+    std::ostringstream table;
+    for (size_t r = 0; r < rows.size(); ++r) {
+        for (size_t i = 0; i < rows[r].size(); ++i) {
+            // The target is left-aligned, figures right-aligned.
+            table << (i == 0 ? std::left : std::right) << std::setw(static_cast<int>(widths[i])) << rows[r][i] << (i + 1 < rows[r].size() ? "  " : "\n");
+        }
+        if (r == 0) {
+            size_t total_width = 0;
+            for (size_t width : widths) {
+                total_width += width + 2;
+            }
+            table << std::string(total_width - 2, '-') << "\n";
+        }
+    }
+    return table.str();
+}
+
+nlohmann::ordered_json ModelBenchmark::toJson(const std::vector<Result>& results, size_t prompt_count, size_t runs, size_t concurrency) {
+    std::time_t now = std::time(nullptr);
+    std::tm utc{};
+    gmtime_r(&now, &utc);
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+    nlohmann::ordered_json report;
+    report["generated_at"] = timestamp;
+    report["prompts"] = prompt_count;
+    report["runs"] = runs;
+    report["concurrency"] = concurrency;
+    report["targets"] = nlohmann::ordered_json::array();
+    for (const auto& result : results) {
+        ResultStats stats = statistics(result);
+        nlohmann::ordered_json entry;
+        entry["target"] = result.target.label();
+        entry["provider"] = result.target.provider;
+        entry["model"] = result.model_name;
+        entry["requests"] = result.samples.size();
+        entry["errors"] = stats.errors;
+        entry["error_rate"] = result.samples.empty() ? 0.0 : static_cast<double>(stats.errors) / static_cast<double>(result.samples.size());
+        entry["first_token_ms"] = percentilesJson(stats.first_token_ms);
+        entry["total_ms"] = percentilesJson(stats.total_ms);
+        entry["tokens_per_second"] = percentilesJson(stats.tokens_per_second);
+        entry["completion_tokens"] = stats.completion_tokens;
+        report["targets"].push_back(std::move(entry));
+    }
+    return report;
+}
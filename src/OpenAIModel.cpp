@@ -1,61 +1,378 @@
 
 #include "OpenAIModel.h"
+#include "JsonExtractor.h"
+#include "JsonWriter.h"
+#include "ProviderTraits.h"
+#include "Base64.h"
+#include "SseParser.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
-OpenAIModel::OpenAIModel(const std::string& api_key, const std::string& base_url, const std::string& model_name)
+namespace {
+
+// Limits for one /embeddings request (the API accepts up to 2048 inputs).
+constexpr size_t kMaxEmbeddingInputsPerRequest = 512;
+constexpr size_t kMaxEmbeddingBytesPerRequest = 1 << 20;
+
+// True if `schema` is accepted by structured outputs in strict mode: every object lists all of its
+// properties as required and sets additionalProperties to false. Other schemas are sent without
+// "strict", so the API still uses them (best effort) instead of rejecting the request.
+bool supportsStrictMode(const nlohmann::json& schema) {
+    if (schema.is_array()) {
+        for (const auto& item : schema) {
+            if (!supportsStrictMode(item)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (!schema.is_object()) {
+        return true;
+    }
+    if (auto properties = schema.find("properties"); properties != schema.end() && properties->is_object()) {
+        auto additional = schema.find("additionalProperties");
+        if (additional == schema.end() || *additional != false) {
+            return false;
+        }
+        auto required = schema.find("required");
+        if (required == schema.end() || !required->is_array()) {
+            return false;
+        }
+        for (auto it = properties->begin(); it != properties->end(); ++it) {
+            if (std::find(required->begin(), required->end(), it.key()) == required->end() || !supportsStrictMode(it.value())) {
+                return false;
+            }
+        }
+    } else if (schema.value("type", nlohmann::json()) == "object" && schema.value("additionalProperties", nlohmann::json()) != false) {
+        return false;
+    }
+    for (const char* key : {"items", "anyOf"}) {
+        if (auto sub = schema.find(key); sub != schema.end() && !supportsStrictMode(*sub)) {
+            return false;
+        }
+    }
+    for (const char* key : {"$defs", "definitions"}) {
+        if (auto defs = schema.find(key); defs != schema.end() && defs->is_object()) {
+            for (const auto& def : *defs) {
+                if (!supportsStrictMode(def)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+OpenAIModel::OpenAIModel(const std::string& api_key, const std::string& base_url, const std::string& model_name, const std::string& api_mode, const std::string& system_prompt)
     : api_key_(api_key),
       base_url_(base_url),
-      model_name_(model_name) {
+      model_name_(model_name),
+      use_responses_api_(api_mode == "responses"),
+      system_prompt_(system_prompt) {
+    if (!system_prompt_.empty()) {
+        JsonWriter writer(system_prompt_fragment_);
+        ProviderTraits::encodeMessage<ProviderTraits::OpenAIChat>(writer, {"system", system_prompt_});
+    }
+    if (api_mode != "chat" && api_mode != "responses") {
+        std::cerr << "Warning: Unknown OpenAI api_mode '" << api_mode << "', using chat completions." << std::endl;
+    }
 }
 
-std::optional<Message> OpenAIModel::sendMessage(const std::vector<Message>& messages, const std::map<std::string, std::string>& model_params) {
-    nlohmann::json request_body;
-    request_body["model"] = model_name_;
-    request_body["stream"] = false;
+bool OpenAIModel::setTools(const std::vector<ToolDefinition>& tools) {
+    if (use_responses_api_) {
+        return tools.empty(); // Function calling is only implemented for chat completions
+    }
+    tools_fragment_.clear();
+    if (tools.empty()) {
+        return true;
+    }
+    std::string object;
+    JsonWriter writer(object);
+    writer.beginObject();
+    writer.key("tools");
+    writer.beginArray();
+    for (const auto& tool : tools) {
+        writer.beginObject();
+        writer.key("type");
+        writer.value("function");
+        writer.key("function");
+        writer.beginObject();
+        writer.key("name");
+        writer.value(tool.name);
+        writer.key("description");
+        writer.value(tool.description);
+        if (!tool.parameters.empty()) {
+            writer.key("parameters");
+            writer.rawValue(tool.parameters.dump());
+        }
+        writer.endObject();
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.endObject();
+    tools_fragment_ = object.substr(1, object.size() - 2);
+    return true;
+}
 
-    nlohmann::json messages_array = nlohmann::json::array();
-    for (const auto& msg : messages) {
-        messages_array.push_back({{"role", msg.role}, {"content", msg.content}});
-    }
-    request_body["messages"] = messages_array;
-
-    // Add model parameters if provided
-    for (const auto& param : model_params) {
-        // Basic type handling for common parameters. More robust parsing might be needed for complex types.
-        if (param.first == "temperature") {
-            try {
-                request_body[param.first] = std::stod(param.second);
-            } catch (const std::exception& e) {
-                std::cerr << "Warning: Could not parse temperature value ";
-            }
-        } else if (param.first == "max_tokens") {
-            try {
-                request_body[param.first] = std::stoi(param.second);
-            } catch (const std::exception& e) {
-                std::cerr << "Warning: Could not parse max_tokens value ";
+void OpenAIModel::invalidateConversationCache(size_t first_changed_index) {
+    message_cache_.invalidate(first_changed_index);
+    // A stored response is only reusable if every message it covers is unchanged.
+    while (!response_chain_.empty() && response_chain_.back().message_count > first_changed_index) {
+        response_chain_.pop_back();
+    }
+}
+
+nlohmann::json OpenAIModel::exportConversationState() const {
+    if (!use_responses_api_ || response_chain_.empty()) {
+        return nullptr;
+    }
+    nlohmann::json chain = nlohmann::json::array();
+    for (const auto& link : response_chain_) {
+        chain.push_back({{"message_count", link.message_count}, {"response_id", link.response_id}});
+    }
+    return {{"provider", "openai"}, {"api_mode", "responses"}, {"base_url", base_url_}, {"model", model_name_}, {"response_chain", chain}};
+}
+
+void OpenAIModel::importConversationState(const nlohmann::json& state) {
+    response_chain_.clear();
+    if (!use_responses_api_ || !state.is_object()) {
+        return;
+    }
+    // Response ids are only meaningful to the server and model that produced them.
+    if (state.value("provider", "") != "openai" || state.value("api_mode", "") != "responses" ||
+        state.value("base_url", "") != base_url_ || state.value("model", "") != model_name_) {
+        return;
+    }
+    try {
+        for (const auto& link : state.at("response_chain")) {
+            size_t message_count = link.at("message_count").get<size_t>();
+            if (!response_chain_.empty() && message_count <= response_chain_.back().message_count) {
+                break; // Corrupt ordering; keep what is consistent so far
             }
-        } else {
-            request_body[param.first] = param.second;
+            response_chain_.push_back({message_count, link.at("response_id").get<std::string>()});
         }
+    } catch (const nlohmann::json::exception& e) {
+        std::cerr << "Warning: Ignoring malformed OpenAI conversation state: " << e.what() << std::endl;
     }
+}
+
+std::string OpenAIModel::serializeParams(const GenerationParams& params) {
+    std::string object;
+    JsonWriter writer(object);
+    writer.beginObject();
+    ProviderTraits::writeSamplingParams<ProviderTraits::OpenAIChat>(writer, params);
+    if (!params.json_schema.is_null()) {
+        writer.key("response_format");
+        writer.beginObject();
+        writer.key("type");
+        writer.value("json_schema");
+        writer.key("json_schema");
+        writer.beginObject();
+        writer.key("name");
+        writer.value("response");
+        if (supportsStrictMode(params.json_schema)) {
+            writer.key("strict");
+            writer.value(true);
+        }
+        writer.key("schema");
+        writer.rawValue(params.json_schema.dump());
+        writer.endObject();
+        writer.endObject();
+    }
+    for (auto it = params.extra.begin(); it != params.extra.end(); ++it) {
+        writer.key(it.key());
+        writer.rawValue(it.value().dump());
+    }
+    writer.endObject();
+    // Strip the braces: the fragment is spliced into the request object as members.
+    return object.substr(1, object.size() - 2);
+}
 
+std::string OpenAIModel::serializeResponsesParams(const GenerationParams& params) {
+    std::string object;
+    JsonWriter writer(object);
+    writer.beginObject();
+    ProviderTraits::writeSamplingParams<ProviderTraits::OpenAIResponses>(writer, params);
+    if (!params.json_schema.is_null()) {
+        writer.key("text");
+        writer.beginObject();
+        writer.key("format");
+        writer.beginObject();
+        writer.key("type");
+        writer.value("json_schema");
+        writer.key("name");
+        writer.value("response");
+        if (supportsStrictMode(params.json_schema)) {
+            writer.key("strict");
+            writer.value(true);
+        }
+        writer.key("schema");
+        writer.rawValue(params.json_schema.dump());
+        writer.endObject();
+        writer.endObject();
+    }
+    for (auto it = params.extra.begin(); it != params.extra.end(); ++it) {
+        writer.key(it.key());
+        writer.rawValue(it.value().dump());
+    }
+    writer.endObject();
+    return object.substr(1, object.size() - 2);
+}
+
+std::map<std::string, std::string> OpenAIModel::requestHeaders() const {
     std::map<std::string, std::string> headers;
     headers["Content-Type"] = "application/json";
     headers["Authorization"] = "Bearer " + api_key_;
+    return headers;
+}
 
-    std::string url = base_url_ + "/chat/completions";
+std::optional<TokenUsage> OpenAIModel::lastUsage() const {
+    return last_usage_;
+}
+
+void OpenAIModel::setTokenizer(std::shared_ptr<BpeTokenizer> tokenizer) {
+    tokenizer_ = std::move(tokenizer);
+}
+
+std::optional<size_t> OpenAIModel::countTokens(const std::vector<Message>& messages) const {
+    if (!tokenizer_ || !tokenizer_->isLoaded()) {
+        return std::nullopt;
+    }
+    // Chat format framing: 3 tokens per message plus the role, and 3 tokens priming the reply.
+    constexpr size_t kTokensPerMessage = 3;
+    constexpr size_t kReplyPrimingTokens = 3;
+    size_t total = kReplyPrimingTokens;
+    if (!system_prompt_.empty()) {
+        total += kTokensPerMessage + tokenizer_->count("system") + tokenizer_->count(system_prompt_);
+    }
+    for (const auto& msg : messages) {
+        total += kTokensPerMessage + tokenizer_->count(msg.role) + tokenizer_->count(msg.content);
+    }
+    return total;
+}
+
+void OpenAIModel::countMissingUsage(const std::vector<Message>& messages, const std::vector<Message>& replies) {
+    if (last_usage_) {
+        return;
+    }
+    std::optional<size_t> prompt_tokens = countTokens(messages);
+    if (!prompt_tokens) {
+        return;
+    }
+    TokenUsage usage;
+    usage.prompt_tokens = static_cast<long long>(*prompt_tokens);
+    for (const auto& reply : replies) {
+        usage.completion_tokens += static_cast<long long>(tokenizer_->count(reply.content));
+    }
+    last_usage_ = usage;
+}
+
+std::optional<Message> OpenAIModel::sendMessage(const std::vector<Message>& messages, const GenerationParams& params) {
+    std::optional<std::vector<Message>> candidates = sendMessageCandidates(messages, params);
+    if (!candidates) {
+        return std::nullopt;
+    }
+    return std::move(candidates->front());
+}
+
+std::optional<std::vector<Message>> OpenAIModel::sendMessageCandidates(const std::vector<Message>& messages, const GenerationParams& params) {
+    last_usage_.reset();
+    if (use_responses_api_) {
+        std::optional<Message> reply = sendResponse(messages, params);
+        if (!reply) {
+            return std::nullopt;
+        }
+        return std::vector<Message>{std::move(*reply)};
+    }
+    std::optional<std::vector<Message>> replies = sendChatCompletion(messages, params);
+    if (replies) {
+        countMissingUsage(messages, *replies);
+    }
+    return replies;
+}
+
+std::string OpenAIModel::buildChatRequest(const std::vector<Message>& messages, const GenerationParams& params, bool stream) {
+    // Serialize straight into the outgoing buffer instead of building a JSON DOM first.
+    // Messages already sent in earlier turns come from the prefix cache; only new ones are encoded.
+    const std::string& encoded_messages = message_cache_.encode(messages, ProviderTraits::encodeMessage<ProviderTraits::OpenAIChat>);
+    std::string request_body;
+    request_body.reserve(encoded_messages.size() + 512);
+
+    JsonWriter writer(request_body);
+    writer.beginObject();
+    writer.key("model");
+    writer.value(model_name_);
+    writer.key("stream");
+    writer.value(stream);
+    if (stream) {
+        // Usage then arrives in a final chunk without choices.
+        writer.key("stream_options");
+        writer.beginObject();
+        writer.key("include_usage");
+        writer.value(true);
+        writer.endObject();
+    }
 
-    std::optional<nlohmann::json> response = http_client_.post(url, headers, request_body);
+    // Keep the system prompt first so every turn shares the same leading bytes.
+    writer.key("messages");
+    writer.beginArray();
+    writer.rawElements(system_prompt_fragment_);
+    writer.rawElements(encoded_messages);
+    writer.endArray();
+    writer.rawMembers(tools_fragment_);
+
+    // Parameters are validated at startup; their serialized form is cached across requests.
+    writer.rawMembers(params_fragment_.get(params, serializeParams));
+    writer.endObject();
+    return request_body;
+}
+
+std::optional<std::vector<Message>> OpenAIModel::sendChatCompletion(const std::vector<Message>& messages, const GenerationParams& params) {
+    std::string url = base_url_ + std::string(ProviderTraits::OpenAIChat::endpoint);
+    std::optional<std::string> raw_response = http_client_.postSerializedRaw(url, requestHeaders(), buildChatRequest(messages, params, false));
+    if (!raw_response) {
+        return std::nullopt;
+    }
+
+    // Fast path: pull out just the reply fields from the raw buffer without building a DOM.
+    // Every choice (one per requested candidate) is returned in order.
+    std::optional<std::string_view> choices = JsonExtractor::findValue(*raw_response, {"choices"});
+    std::optional<std::vector<std::string_view>> items = choices ? JsonExtractor::arrayElements(*choices) : std::nullopt;
+    if (items && !items->empty()) {
+        std::vector<Message> replies;
+        for (std::string_view item : *items) {
+            std::optional<Message> reply = parseChoice(item);
+            if (!reply) {
+                replies.clear();
+                break;
+            }
+            replies.push_back(std::move(*reply));
+        }
+        if (!replies.empty()) {
+            last_usage_ = ProviderTraits::parseUsage<ProviderTraits::OpenAIChat>(*raw_response);
+            return replies;
+        }
+    }
+
+    // Unexpected shape: fall back to a full parse for validation and diagnostics.
+    std::optional<nlohmann::json> response = HttpClient::parseResponse(raw_response);
 
     if (response) {
         try {
             if (response->contains("choices") && !(*response)["choices"].empty()) {
-                const auto& choice = (*response)["choices"][0];
-                if (choice.contains("message")) {
-                    Message reply;
-                    reply.role = choice["message"]["role"].get<std::string>();
-                    reply.content = choice["message"]["content"].get<std::string>();
-                    return reply;
+                std::vector<Message> replies;
+                for (const auto& choice : (*response)["choices"]) {
+                    // Choices without text content (e.g. refusals) are skipped.
+                    if (choice.contains("message") && choice["message"].value("content", nlohmann::json()).is_string()) {
+                        replies.push_back({choice["message"]["role"].get<std::string>(), choice["message"]["content"].get<std::string>()});
+                    }
+                }
+                if (!replies.empty()) {
+                    last_usage_ = ProviderTraits::parseUsage<ProviderTraits::OpenAIChat>(*raw_response);
+                    return replies;
                 }
             }
             std::cerr << "Error: Unexpected API response format: " << response->dump(2) << std::endl;
@@ -67,4 +384,265 @@ std::optional<Message> OpenAIModel::sendMessage(const std::vector<Message>& mess
     return std::nullopt;
 }
 
+std::optional<Message> OpenAIModel::sendMessageStreaming(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback& on_delta) {
+    if (use_responses_api_) {
+        return IAIModel::sendMessageStreaming(messages, params, on_delta);
+    }
+    last_usage_.reset();
+    Message reply{"assistant", ""};
+    bool stream_failed = false;
+    bool finished = false;
+    SseParser parser([&](std::string_view data) {
+        if (ProviderTraits::isFinalStreamEvent<ProviderTraits::OpenAIChat>(data)) {
+            finished = true;
+        }
+        if (data == "[DONE]") {
+            return true;
+        }
+        if (std::optional<std::string> delta = JsonExtractor::getString(data, ProviderTraits::OpenAIChat::stream_text)) {
+            if (!delta->empty()) {
+                reply.content += *delta;
+                if (!on_delta(*delta)) {
+                    return false;
+                }
+            }
+        } else if (std::optional<std::string_view> error = JsonExtractor::findValue(data, {"error"})) {
+            std::cerr << "Error: OpenAI stream failed: " << *error << std::endl;
+            stream_failed = true;
+            return false;
+        }
+        if (std::optional<TokenUsage> usage = ProviderTraits::parseUsage<ProviderTraits::OpenAIChat>(data)) {
+            last_usage_ = usage;
+        }
+        return true;
+    });
+    std::string url = base_url_ + std::string(ProviderTraits::OpenAIChat::endpoint);
+    bool complete = http_client_.postStreaming(url, requestHeaders(), buildChatRequest(messages, params, true),
+                                               [&parser](std::string_view chunk) { return parser.feed(chunk); });
+    if (complete && !stream_failed && !finished) {
+        std::cerr << "Error: The OpenAI stream ended before the reply was complete." << std::endl;
+    } else if (complete && !stream_failed && reply.content.empty()) {
+        std::cerr << "Error: OpenAI returned an empty reply." << std::endl;
+    }
+    if (!complete || stream_failed || !finished || reply.content.empty()) {
+        last_usage_.reset();
+        return std::nullopt;
+    }
+    countMissingUsage(messages, {reply});
+    return reply;
+}
+
+std::optional<Message> OpenAIModel::parseChoice(std::string_view choice) {
+    std::optional<std::string_view> message = JsonExtractor::findValue(choice, {"message"});
+    if (!message) {
+        return std::nullopt;
+    }
+    Message reply;
+    reply.role = JsonExtractor::getString(*message, {"role"}).value_or("assistant");
+    std::optional<std::string> content = JsonExtractor::getString(*message, {"content"});
+    std::optional<std::string_view> tool_calls = JsonExtractor::findValue(*message, {"tool_calls"});
+    if (tool_calls && *tool_calls != "null") {
+        std::optional<std::vector<std::string_view>> calls = JsonExtractor::arrayElements(*tool_calls);
+        if (!calls) {
+            return std::nullopt;
+        }
+        for (std::string_view call : *calls) {
+            std::optional<std::string> name = JsonExtractor::getString(call, {"function", "name"});
+            if (!name) {
+                return std::nullopt;
+            }
+            reply.tool_calls.push_back({JsonExtractor::getString(call, {"id"}).value_or(""), std::move(*name),
+                                        JsonExtractor::getString(call, {"function", "arguments"}).value_or("{}")});
+        }
+    }
+    // With tool calls the content is usually null.
+    if (!content && reply.tool_calls.empty()) {
+        return std::nullopt;
+    }
+    reply.content = content.value_or("");
+    return reply;
+}
+
+std::optional<Message> OpenAIModel::sendResponse(const std::vector<Message>& messages, const GenerationParams& params) {
+    // Resume from the newest stored response that still covers only an unchanged prefix
+    // and leaves at least one new message to send.
+    while (!response_chain_.empty() && response_chain_.back().message_count >= messages.size()) {
+        response_chain_.pop_back();
+    }
+    if (!response_chain_.empty()) {
+        const ResponseLink link = response_chain_.back();
+        std::optional<Message> reply = postResponse(messages, link.message_count, link.response_id, params);
+        if (reply) {
+            return reply;
+        }
+        // The chain is broken (e.g. the stored response expired); replay the full history instead.
+        std::cerr << "Warning: Could not continue from stored response " << link.response_id << ", resending full conversation." << std::endl;
+        response_chain_.clear();
+    }
+    return postResponse(messages, 0, "", params);
+}
+
+std::optional<Message> OpenAIModel::postResponse(const std::vector<Message>& messages, size_t first_message, const std::string& previous_response_id, const GenerationParams& params) {
+    std::string request_body;
+    size_t content_bytes = 0;
+    for (size_t i = first_message; i < messages.size(); ++i) {
+        content_bytes += messages[i].content.size();
+    }
+    request_body.reserve(content_bytes + 512);
+
+    JsonWriter writer(request_body);
+    writer.beginObject();
+    writer.key("model");
+    writer.value(model_name_);
+    writer.key("store");
+    writer.value(true);
+    if (!system_prompt_.empty()) {
+        // Instructions are not carried over through previous_response_id, so they are sent every turn.
+        writer.key("instructions");
+        writer.value(system_prompt_);
+    }
+    if (!previous_response_id.empty()) {
+        writer.key("previous_response_id");
+        writer.value(previous_response_id);
+    }
+    writer.key("input");
+    writer.beginArray();
+    for (size_t i = first_message; i < messages.size(); ++i) {
+        ProviderTraits::encodeMessage<ProviderTraits::OpenAIResponses>(writer, messages[i]);
+    }
+    writer.endArray();
+    writer.rawMembers(responses_params_fragment_.get(params, serializeResponsesParams));
+    writer.endObject();
+
+    std::string url = base_url_ + std::string(ProviderTraits::OpenAIResponses::endpoint);
+
+    std::optional<std::string> raw_response = http_client_.postSerializedRaw(url, requestHeaders(), request_body);
+    if (!raw_response) {
+        return std::nullopt;
+    }
+
+    std::optional<std::string> response_id = JsonExtractor::getString(*raw_response, {"id"});
+    std::optional<Message> reply;
+    // Fast path: a plain reply has the message as the first output item with one output_text part.
+    if (std::optional<std::string> text = JsonExtractor::getString(*raw_response, ProviderTraits::OpenAIResponses::reply_text)) {
+        reply = Message{"assistant", std::move(*text)};
+    } else if (std::optional<nlohmann::json> response = HttpClient::parseResponse(raw_response)) {
+        // Otherwise (e.g. reasoning items first) collect the text of every output message.
+        try {
+            std::string text;
+            bool found = false;
+            for (const auto& item : response->at("output")) {
+                if (item.value("type", "") != "message" || !item.contains("content")) {
+                    continue;
+                }
+                for (const auto& part : item["content"]) {
+                    if (part.value("type", "") == "output_text") {
+                        text += part.at("text").get<std::string>();
+                        found = true;
+                    }
+                }
+            }
+            if (found) {
+                reply = Message{"assistant", text};
+            } else {
+                std::cerr << "Error: Unexpected Responses API response format: " << response->dump(2) << std::endl;
+            }
+        } catch (const nlohmann::json::exception& e) {
+            std::cerr << "Error parsing OpenAI Responses API response: " << e.what() << std::endl;
+            std::cerr << "Response was: " << response->dump(2) << std::endl;
+        }
+    }
+
+    if (reply) {
+        last_usage_ = ProviderTraits::parseUsage<ProviderTraits::OpenAIResponses>(*raw_response);
+    }
+    if (reply && response_id) {
+        // The stored response now covers everything sent plus the reply it produced.
+        response_chain_.push_back({messages.size() + 1, *response_id});
+    }
+    return reply;
+}
+
+void OpenAIModel::setEmbeddingModel(const std::string& model_name, const std::string& base_url, bool base64_encoding) {
+    embedding_model_ = model_name;
+    embedding_base_url_ = base_url;
+    embedding_base64_ = base64_encoding;
+}
+
+std::optional<EmbeddingMatrix> OpenAIModel::embedBatch(const std::vector<std::string>& texts) {
+    EmbeddingMatrix matrix;
+    matrix.rows = texts.size();
+    const std::string url = (embedding_base_url_.empty() ? base_url_ : embedding_base_url_) + "/embeddings";
+    size_t begin = 0;
+    while (begin < texts.size()) {
+        // As many inputs per request as the limits allow.
+        size_t end = begin;
+        size_t batch_bytes = 0;
+        while (end < texts.size() && end - begin < kMaxEmbeddingInputsPerRequest &&
+               (end == begin || batch_bytes + texts[end].size() <= kMaxEmbeddingBytesPerRequest)) {
+            batch_bytes += texts[end].size();
+            ++end;
+        }
+
+        std::string request_body;
+        request_body.reserve(batch_bytes + 128);
+        JsonWriter writer(request_body);
+        writer.beginObject();
+        writer.key("model");
+        writer.value(embedding_model_);
+        writer.key("input");
+        writer.beginArray();
+        for (size_t i = begin; i < end; ++i) {
+            writer.value(texts[i]);
+        }
+        writer.endArray();
+        if (embedding_base64_) {
+            writer.key("encoding_format");
+            writer.value("base64");
+        }
+        writer.endObject();
+
+        std::optional<std::string> raw_response = http_client_.postSerializedRaw(url, requestHeaders(), request_body);
+        if (!raw_response || !parseEmbeddings(*raw_response, begin, end - begin, matrix)) {
+            return std::nullopt;
+        }
+        begin = end;
+    }
+    return matrix;
+}
 
+bool OpenAIModel::parseEmbeddings(const std::string& raw_response, size_t first_row, size_t count, EmbeddingMatrix& matrix) {
+    // Embeddings are decoded straight from the raw buffer into the matrix; a DOM of thousands of
+    // numbers per input would dominate the cost of large batches.
+    std::optional<std::string_view> data = JsonExtractor::findValue(raw_response, {"data"});
+    std::optional<std::vector<std::string_view>> items = data ? JsonExtractor::arrayElements(*data) : std::nullopt;
+    if (!items || items->size() != count) {
+        std::cerr << "Error: Unexpected OpenAI embeddings response: " << raw_response.substr(0, 512) << std::endl;
+        return false;
+    }
+    std::vector<float> embedding;
+    std::string bytes;
+    for (size_t position = 0; position < items->size(); ++position) {
+        std::string_view item = (*items)[position];
+        // Servers return the items in input order, but "index" is authoritative when present.
+        long long index = JsonExtractor::getInteger(item, {"index"}).value_or(static_cast<long long>(position));
+        std::optional<std::string_view> value = JsonExtractor::findValue(item, {"embedding"});
+        embedding.clear();
+        bool ok = value && index >= 0 && static_cast<size_t>(index) < count;
+        if (ok && value->front() == '"') {
+            // encoding_format=base64: little-endian float32 values.
+            ok = Base64::decode(value->substr(1, value->size() - 2), bytes) && bytes.size() % sizeof(float) == 0;
+            if (ok) {
+                embedding.resize(bytes.size() / sizeof(float));
+                std::memcpy(embedding.data(), bytes.data(), bytes.size());
+            }
+        } else if (ok) {
+            ok = JsonExtractor::appendFloats(*value, embedding);
+        }
+        if (!ok || embedding.empty() || !matrix.assignRow(first_row + static_cast<size_t>(index), embedding)) {
+            std::cerr << "Error: Malformed or inconsistent embedding in OpenAI embeddings response." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
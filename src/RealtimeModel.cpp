@@ -0,0 +1,266 @@
+#include "RealtimeModel.h"
+#include "HttpClient.h"
+#include "JsonExtractor.h"
+#include "JsonWriter.h"
+#include "ProviderTraits.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+// The longest pause between two events of a response before the connection is given up.
+constexpr int kIdleTimeoutMs = 120000;
+// How long a cancelled response may take to acknowledge the cancellation.
+constexpr int kCancelTimeoutMs = 10000;
+
+// Ids of client events whose failure is harmless (see isBestEffortError()).
+constexpr std::string_view kCancelIdPrefix = "haicl_cancel_";
+constexpr std::string_view kDeleteIdPrefix = "haicl_delete_";
+
+} // namespace
+
+RealtimeModel::RealtimeModel(const std::string& api_key, const std::string& url, const std::string& model_name, const std::string& system_prompt)
+    : api_key_(api_key),
+      url_(url),
+      model_name_(model_name),
+      system_prompt_(system_prompt) {
+}
+
+std::string RealtimeModel::nextId(const char* kind) {
+    return "haicl_" + std::string(kind) + "_" + std::to_string(next_id_++);
+}
+
+std::string RealtimeModel::serializeParams(const GenerationParams& params) {
+    std::string object;
+    JsonWriter writer(object);
+    writer.beginObject();
+    writer.key("modalities");
+    writer.beginArray();
+    writer.value("text");
+    writer.endArray();
+    ProviderTraits::writeSamplingParams<ProviderTraits::OpenAIRealtime>(writer, params);
+    if (!params.json_schema.is_null()) {
+        std::cerr << "Warning: The realtime API has no structured output mode; replies are only validated against the schema." << std::endl;
+    }
+    for (auto it = params.extra.begin(); it != params.extra.end(); ++it) {
+        writer.key(it.key());
+        writer.rawValue(it.value().dump());
+    }
+    writer.endObject();
+    return object.substr(1, object.size() - 2);
+}
+
+bool RealtimeModel::isBestEffortError(std::string_view event) {
+    std::optional<std::string> event_id = JsonExtractor::getString(event, {"error", "event_id"});
+    return event_id && (event_id->rfind(kCancelIdPrefix, 0) == 0 || event_id->rfind(kDeleteIdPrefix, 0) == 0);
+}
+
+bool RealtimeModel::openSession() {
+    closeSession();
+    std::string url = url_ + (url_.find('?') == std::string::npos ? "?" : "&") + "model=" + model_name_;
+    if (!socket_.connect(url, {{"Authorization", "Bearer " + api_key_}, {"OpenAI-Beta", "realtime=v1"}})) {
+        return false;
+    }
+    // The server announces the session before anything else.
+    std::optional<std::string> event = socket_.receiveText(kIdleTimeoutMs);
+    if (!event) {
+        return false;
+    }
+    if (JsonExtractor::getString(*event, {"type"}).value_or("") != "session.created") {
+        std::cerr << "Error: Realtime session not created: " << JsonExtractor::getString(*event, {"error", "message"}).value_or(*event) << std::endl;
+        closeSession();
+        return false;
+    }
+
+    std::string update;
+    JsonWriter writer(update);
+    writer.beginObject();
+    writer.key("type");
+    writer.value("session.update");
+    writer.key("session");
+    writer.beginObject();
+    writer.key("modalities");
+    writer.beginArray();
+    writer.value("text");
+    writer.endArray();
+    if (!system_prompt_.empty()) {
+        writer.key("instructions");
+        writer.value(system_prompt_);
+    }
+    writer.endObject();
+    writer.endObject();
+    return socket_.sendText(update);
+}
+
+void RealtimeModel::closeSession() {
+    socket_.close();
+    // A new session starts with an empty conversation.
+    synced_.clear();
+    synced_ids_.clear();
+    stale_from_ = static_cast<size_t>(-1);
+}
+
+bool RealtimeModel::deleteItem(const std::string& item_id) {
+    std::string event;
+    JsonWriter writer(event);
+    writer.beginObject();
+    writer.key("type");
+    writer.value("conversation.item.delete");
+    writer.key("event_id");
+    writer.value(nextId("delete"));
+    writer.key("item_id");
+    writer.value(item_id);
+    writer.endObject();
+    return socket_.sendText(event);
+}
+
+bool RealtimeModel::syncConversation(const std::vector<Message>& messages) {
+    if (!socket_.isOpen() && !openSession()) {
+        return false;
+    }
+    size_t common = 0;
+    size_t limit = std::min({synced_.size(), messages.size(), stale_from_});
+    while (common < limit && synced_[common].role == messages[common].role && synced_[common].content == messages[common].content) {
+        ++common;
+    }
+    stale_from_ = static_cast<size_t>(-1);
+    // The session must not keep what the local history no longer has.
+    for (size_t i = common; i < synced_ids_.size(); ++i) {
+        if (!synced_ids_[i].empty() && !deleteItem(synced_ids_[i])) {
+            closeSession();
+            return false;
+        }
+    }
+    synced_.resize(common);
+    synced_ids_.resize(common);
+
+    for (size_t i = common; i < messages.size(); ++i) {
+        const Message& msg = messages[i];
+        std::string item_id = nextId("item");
+        std::string event;
+        JsonWriter writer(event);
+        writer.beginObject();
+        writer.key("type");
+        writer.value("conversation.item.create");
+        writer.key("item");
+        writer.beginObject();
+        writer.key("id");
+        writer.value(item_id);
+        writer.key("type");
+        writer.value("message");
+        ProviderTraits::writeMessageMembers<ProviderTraits::OpenAIRealtime>(writer, msg, ProviderTraits::roleOf(msg.role));
+        writer.endObject();
+        writer.endObject();
+        if (!socket_.sendText(event)) {
+            closeSession();
+            return false;
+        }
+        synced_.push_back(msg);
+        synced_ids_.push_back(std::move(item_id));
+    }
+    return true;
+}
+
+void RealtimeModel::cancelResponse(std::string reply_item_id) {
+    if (!socket_.sendText(R"({"type":"response.cancel","event_id":")" + nextId("cancel") + "\"}")) {
+        closeSession();
+        return;
+    }
+    while (true) {
+        std::optional<std::string> event = socket_.receiveText(kCancelTimeoutMs);
+        if (!event) {
+            closeSession();
+            return;
+        }
+        std::string type = JsonExtractor::getString(*event, {"type"}).value_or("");
+        if (type == "response.output_item.added" && reply_item_id.empty()) {
+            reply_item_id = JsonExtractor::getString(*event, {"item", "id"}).value_or("");
+        } else if (type == "response.done") {
+            break;
+        }
+    }
+    // The partial reply is not part of the local history.
+    if (!reply_item_id.empty() && !deleteItem(reply_item_id)) {
+        closeSession();
+    }
+}
+
+std::optional<Message> RealtimeModel::sendMessage(const std::vector<Message>& messages, const GenerationParams& params) {
+    return send(messages, params, nullptr);
+}
+
+std::optional<Message> RealtimeModel::sendMessageStreaming(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback& on_delta) {
+    return send(messages, params, &on_delta);
+}
+
+std::optional<Message> RealtimeModel::send(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback* on_delta) {
+    last_usage_.reset();
+    if (!syncConversation(messages)) {
+        return std::nullopt;
+    }
+    std::string request;
+    JsonWriter writer(request);
+    writer.beginObject();
+    writer.key("type");
+    writer.value("response.create");
+    writer.key("response");
+    writer.beginObject();
+    writer.rawMembers(params_fragment_.get(params, serializeParams));
+    writer.endObject();
+    writer.endObject();
+    if (!socket_.sendText(request)) {
+        closeSession();
+        return std::nullopt;
+    }
+
+    Message reply{"assistant", ""};
+    std::string reply_item_id;
+    while (true) {
+        std::optional<std::string> event = socket_.receiveText(kIdleTimeoutMs);
+        if (!event) {
+            // Reported by the socket (unless cancelled); the session is gone with the connection.
+            closeSession();
+            return std::nullopt;
+        }
+        std::optional<std::string> type = JsonExtractor::getString(*event, {"type"});
+        if (!type) {
+            continue;
+        }
+        // Older sessions call the text events response.text.*, newer ones response.output_text.*.
+        if (*type == "response.text.delta" || *type == "response.output_text.delta") {
+            std::optional<std::string> delta = JsonExtractor::getString(*event, ProviderTraits::OpenAIRealtime::stream_text);
+            if (delta && !delta->empty()) {
+                reply.content += *delta;
+                if (on_delta && !(*on_delta)(*delta)) {
+                    cancelResponse(reply_item_id);
+                    return std::nullopt;
+                }
+            }
+        } else if (*type == "response.output_item.added") {
+            reply_item_id = JsonExtractor::getString(*event, {"item", "id"}).value_or("");
+        } else if (*type == "response.done") {
+            std::string status = JsonExtractor::getString(*event, {"response", "status"}).value_or("");
+            // "incomplete": cut off by max_response_output_tokens, like a length-limited completion.
+            if (status == "completed" || status == "incomplete") {
+                last_usage_ = ProviderTraits::parseUsage<ProviderTraits::OpenAIRealtime>(*event);
+                synced_.push_back(reply);
+                synced_ids_.push_back(reply_item_id);
+                return reply;
+            }
+            std::cerr << "Error: Realtime response " << status << ": " << JsonExtractor::findValue(*event, {"response", "status_details"}).value_or("null") << std::endl;
+            if (!reply_item_id.empty() && !deleteItem(reply_item_id)) {
+                closeSession();
+            }
+            return std::nullopt;
+        } else if (*type == "error" && !isBestEffortError(*event)) {
+            std::cerr << "Error: Realtime API error: " << JsonExtractor::getString(*event, {"error", "message"}).value_or(*event) << std::endl;
+            // Whatever was refused, the session no longer matches what was sent: start over next time.
+            closeSession();
+            return std::nullopt;
+        }
+    }
+}
+
+void RealtimeModel::invalidateConversationCache(size_t first_changed_index) {
+    stale_from_ = std::min(stale_from_, first_changed_index);
+}
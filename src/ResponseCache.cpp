@@ -0,0 +1,203 @@
+#include "ResponseCache.h"
+#include "JsonWriter.h"
+#include "Sha256.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Bumped whenever the key derivation or entry format changes.
+constexpr int kCacheFormatVersion = 1;
+
+// Eviction shrinks the cache to this fraction of the limit so it does not run on every store.
+constexpr double kEvictToRatio = 0.9;
+
+// Temporary files older than this were left behind by an interrupted write.
+constexpr auto kStaleTempFileAge = std::chrono::hours(1);
+
+long long unixNow() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+ResponseCache::ResponseCache(fs::path directory, long long ttl_seconds, uintmax_t max_bytes)
+    : directory_(std::move(directory)), ttl_seconds_(ttl_seconds), max_bytes_(max_bytes) {
+}
+
+fs::path ResponseCache::defaultDirectory() {
+    if (const char* xdg_cache = std::getenv("XDG_CACHE_HOME"); xdg_cache && *xdg_cache) {
+        return fs::path(xdg_cache) / "haicl";
+    }
+    if (const char* home_dir = std::getenv("HOME")) {
+        return fs::path(home_dir) / ".cache" / "haicl";
+    }
+    return fs::current_path() / ".haicl-cache";
+}
+
+std::string ResponseCache::makeKey(const IAIModel& model, const GenerationParams& params, const std::vector<Message>& messages) {
+    // Canonical form: fixed field order, sorted parameter keys, messages in order.
+    std::string canonical;
+    JsonWriter writer(canonical);
+    writer.beginObject();
+    writer.key("version");
+    writer.value(kCacheFormatVersion);
+    writer.key("provider");
+    writer.value(model.providerName());
+    writer.key("scope");
+    writer.value(model.cacheScope());
+    writer.key("model");
+    writer.value(model.modelName());
+    writer.key("params");
+    writer.rawValue(params.toJson().dump());
+    writer.key("messages");
+    writer.beginArray();
+    for (const auto& msg : messages) {
+        writer.beginArray();
+        writer.value(msg.role);
+        writer.value(msg.content);
+        writer.endArray();
+    }
+    writer.endArray();
+    writer.endObject();
+    return Sha256::hex(canonical);
+}
+
+fs::path ResponseCache::entryPath(const std::string& key) const {
+    return directory_ / key.substr(0, 2) / (key.substr(2) + ".json");
+}
+
+std::optional<Message> ResponseCache::lookup(const std::string& key) {
+    ++stats_.lookups;
+    fs::path path = entryPath(key);
+    std::ifstream ifs(path);
+    if (!ifs.is_open()) {
+        return std::nullopt;
+    }
+    try {
+        nlohmann::json entry = nlohmann::json::parse(ifs);
+        ifs.close();
+        if (ttl_seconds_ > 0 && unixNow() - entry.at("created").get<long long>() > ttl_seconds_) {
+            std::error_code ec;
+            fs::remove(path, ec);
+            return std::nullopt;
+        }
+        const nlohmann::json& message = entry.at("message");
+        Message reply{message.at("role").get<std::string>(), message.at("content").get<std::string>()};
+        // Mark the entry as recently used for LRU eviction.
+        std::error_code ec;
+        fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+        ++stats_.hits;
+        return reply;
+    } catch (const nlohmann::json::exception&) {
+        // Corrupt entry (e.g. written by an incompatible version); treat as a miss and replace it.
+        std::error_code ec;
+        fs::remove(path, ec);
+        return std::nullopt;
+    }
+}
+
+void ResponseCache::store(const std::string& key, const Message& reply) {
+    fs::path path = entryPath(key);
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    if (ec) {
+        std::cerr << "Warning: Could not create response cache directory " << path.parent_path() << ": " << ec.message() << std::endl;
+        return;
+    }
+
+    nlohmann::json entry = {{"created", unixNow()}, {"message", {{"role", reply.role}, {"content", reply.content}}}};
+    std::ostringstream suffix;
+    suffix << ".tmp." << std::hex << std::random_device{}();
+    fs::path temp_path = path;
+    temp_path += suffix.str();
+    {
+        std::ofstream ofs(temp_path, std::ios::binary | std::ios::trunc);
+        ofs << entry.dump();
+        if (!ofs) {
+            std::cerr << "Warning: Could not write response cache entry " << temp_path << std::endl;
+            ofs.close();
+            fs::remove(temp_path, ec);
+            return;
+        }
+    }
+    // rename() atomically replaces any existing entry, so readers see either the old or the new file.
+    fs::rename(temp_path, path, ec);
+    if (ec) {
+        std::cerr << "Warning: Could not store response cache entry " << path << ": " << ec.message() << std::endl;
+        fs::remove(temp_path, ec);
+        return;
+    }
+    ++stats_.stores;
+
+    // One eviction pass per process keeps stores cheap while bounding the cache across runs.
+    if (!evicted_) {
+        evicted_ = true;
+        evict();
+    }
+}
+
+void ResponseCache::evict() {
+    struct EntryInfo {
+        fs::file_time_type last_used;
+        uintmax_t size;
+        fs::path path;
+    };
+    const auto now = fs::file_time_type::clock::now();
+    std::vector<EntryInfo> entries;
+    uintmax_t total_bytes = 0;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(directory_, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code entry_ec;
+        if (!it->is_regular_file(entry_ec)) {
+            continue;
+        }
+        const fs::path& path = it->path();
+        fs::file_time_type last_used = it->last_write_time(entry_ec);
+        if (entry_ec) {
+            continue;
+        }
+        if (path.extension() != ".json") {
+            if (path.filename().string().find(".tmp.") != std::string::npos && now - last_used > kStaleTempFileAge) {
+                fs::remove(path, entry_ec);
+            }
+            continue;
+        }
+        // The modification time is never older than the creation time, so this entry has expired.
+        if (ttl_seconds_ > 0 && now - last_used > std::chrono::seconds(ttl_seconds_)) {
+            fs::remove(path, entry_ec);
+            continue;
+        }
+        uintmax_t size = it->file_size(entry_ec);
+        if (entry_ec) {
+            continue;
+        }
+        total_bytes += size;
+        entries.push_back({last_used, size, path});
+    }
+
+    if (max_bytes_ == 0 || total_bytes <= max_bytes_) {
+        return;
+    }
+    std::sort(entries.begin(), entries.end(), [](const EntryInfo& a, const EntryInfo& b) {
+        return a.last_used < b.last_used;
+    });
+    const uintmax_t target = static_cast<uintmax_t>(static_cast<double>(max_bytes_) * kEvictToRatio);
+    for (const auto& entry : entries) {
+        if (total_bytes <= target) {
+            break;
+        }
+        std::error_code remove_ec;
+        if (fs::remove(entry.path, remove_ec)) {
+            total_bytes -= entry.size;
+        }
+    }
+}
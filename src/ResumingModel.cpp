@@ -0,0 +1,117 @@
+#include "ResumingModel.h"
+#include "HttpClient.h"
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+// How much of an instructed continuation is held back to recognize text repeated from the partial reply.
+constexpr size_t kRepeatWindow = 256;
+// Shorter matches are as likely to be the genuine continuation (e.g. a common word).
+constexpr size_t kMinRepeat = 8;
+
+constexpr const char* kContinuePrompt = "Your previous reply was cut off. Continue it exactly where it stopped, without repeating any of it and without any preamble.";
+
+} // namespace
+
+ResumingModel::ResumingModel(std::unique_ptr<IAIModel> inner, size_t max_resumes)
+    : inner_(std::move(inner)),
+      max_resumes_(max_resumes) {
+}
+
+void ResumingModel::addInnerUsage() {
+    if (std::optional<TokenUsage> usage = inner_->lastUsage()) {
+        if (!usage_) {
+            usage_ = TokenUsage{};
+        }
+        usage_->add(*usage);
+    }
+}
+
+std::optional<Message> ResumingModel::sendMessage(const std::vector<Message>& messages, const GenerationParams& params) {
+    usage_.reset();
+    incomplete_ = false;
+    std::optional<Message> reply = inner_->sendMessage(messages, params);
+    addInnerUsage();
+    return reply;
+}
+
+std::optional<std::vector<Message>> ResumingModel::sendMessageCandidates(const std::vector<Message>& messages, const GenerationParams& params) {
+    usage_.reset();
+    incomplete_ = false;
+    std::optional<std::vector<Message>> candidates = inner_->sendMessageCandidates(messages, params);
+    addInnerUsage();
+    return candidates;
+}
+
+std::vector<Message> ResumingModel::continuationRequest(const std::vector<Message>& messages, const std::string& partial) const {
+    std::vector<Message> request = messages;
+    request.push_back({"assistant", partial});
+    if (!inner_->continuesAssistantMessage()) {
+        request.push_back({"user", kContinuePrompt});
+    }
+    return request;
+}
+
+size_t ResumingModel::repeatedLength(std::string_view partial, std::string_view continuation) {
+    for (size_t length = std::min(partial.size(), continuation.size()); length >= kMinRepeat; --length) {
+        if (partial.substr(partial.size() - length) == continuation.substr(0, length)) {
+            return length;
+        }
+    }
+    return 0;
+}
+
+std::optional<Message> ResumingModel::sendMessageStreaming(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback& on_delta) {
+    usage_.reset();
+    incomplete_ = false;
+    // Everything delivered to `on_delta` so far, over all requests.
+    std::string received;
+    bool stopped = false;
+    auto forward = [&](std::string_view delta) {
+        received += delta;
+        stopped = !on_delta(delta);
+        return !stopped;
+    };
+    std::optional<Message> reply = inner_->sendMessageStreaming(messages, params, forward);
+    addInnerUsage();
+
+    // A reply constrained to a JSON Schema cannot be continued: the continuation would have to be a
+    // complete document of its own.
+    size_t resumes = 0;
+    while (!reply && !stopped && !received.empty() && params.json_schema.is_null() && !HttpClient::cancelRequested()) {
+        if (resumes == max_resumes_) {
+            // Keeping what arrived beats asking the same question again from the start.
+            std::cerr << "Warning: The reply was still incomplete after " << max_resumes_ << " continuation requests; keeping the " << received.size() << " bytes received." << std::endl;
+            incomplete_ = true;
+            return Message{"assistant", std::move(received)};
+        }
+        ++resumes;
+        std::cerr << "Warning: The reply was cut off after " << received.size() << " bytes; requesting the rest (" << resumes << "/" << max_resumes_ << ")." << std::endl;
+        std::vector<Message> request = continuationRequest(messages, received);
+        // Without prefill the model may start by repeating the end of the partial reply, so the start
+        // of its continuation is held back until that can be told apart.
+        bool holding = !inner_->continuesAssistantMessage();
+        std::string held;
+        auto release = [&]() {
+            holding = false;
+            std::string_view rest = std::string_view(held).substr(repeatedLength(received, held));
+            return rest.empty() || forward(rest);
+        };
+        reply = inner_->sendMessageStreaming(request, params, [&](std::string_view delta) {
+            if (!holding) {
+                return forward(delta);
+            }
+            held += delta;
+            return held.size() < kRepeatWindow || release();
+        });
+        addInnerUsage();
+        if (holding && !release()) {
+            return std::nullopt;
+        }
+    }
+    if (reply && resumes > 0) {
+        reply->content = std::move(received);
+    }
+    return reply;
+}
@@ -0,0 +1,346 @@
+#include "RouterModel.h"
+#include "ContextWindow.h"
+#include "HttpClient.h"
+#include "JsonSchemaValidator.h"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <string_view>
+
+namespace {
+
+// Weight of new observations in a route's moving averages.
+constexpr double kStatsWeight = 0.3;
+// A route is paused once its average error rate reaches this (after at least kMinRequests requests).
+constexpr double kPauseErrorRate = 0.5;
+constexpr size_t kMinRequests = 2;
+// How long a failing or slow route is left out before it gets another request.
+constexpr std::chrono::seconds kPauseDuration(30);
+
+// Prompts this long (in estimated tokens) count as complex for their length alone.
+constexpr double kLongPromptTokens = 500.0;
+
+// Words of prompts that ask for more than a quick answer (matched on the lowercased prompt).
+constexpr std::string_view kReasoningWords[] = {
+    "why", "explain", "prove", "derive", "step by step", "analy", "compare", "design", "architect",
+    "optimi", "debug", "refactor", "implement", "trade-off", "tradeoff", "evaluate", "reason",
+    "为什么", "解释", "证明", "推导", "分析", "比较", "设计", "架构", "优化", "调试", "重构", "实现", "评估",
+};
+
+// Signs of source code in a prompt.
+constexpr std::string_view kCodeMarkers[] = {"```", "#include", "def ", "function ", "};", "=>", "::"};
+
+// Openings of replies in which the model says it cannot answer (matched on the lowercased start).
+constexpr std::string_view kHedgingPhrases[] = {
+    "i'm not sure", "i am not sure", "i'm not certain", "i don't know", "i do not know", "i cannot answer",
+    "i can't answer", "i'm unable to", "i am unable to", "not enough information",
+    "我不确定", "我不知道", "无法回答",
+};
+// How much of a reply's start is searched for hedging.
+constexpr size_t kHedgingWindow = 300;
+
+// Lowercases ASCII letters and turns typographic apostrophes into plain ones.
+std::string normalize(std::string_view text) {
+    std::string normalized;
+    normalized.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text.compare(i, 3, "\xE2\x80\x99") == 0) {
+            normalized += '\'';
+            i += 2;
+        } else {
+            normalized += static_cast<char>(std::tolower(static_cast<unsigned char>(text[i])));
+        }
+    }
+    return normalized;
+}
+
+template <size_t N>
+size_t countContained(const std::string& text, const std::string_view (&words)[N]) {
+    return static_cast<size_t>(std::count_if(std::begin(words), std::end(words), [&text](std::string_view word) {
+        return text.find(word) != std::string::npos;
+    }));
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+size_t promptTokens(const std::vector<Message>& messages) {
+    size_t tokens = 0;
+    for (const auto& msg : messages) {
+        tokens += ContextWindowManager::estimateTokens(msg.content);
+    }
+    return tokens;
+}
+
+// Complexity of the latest user message: the one the reply is about.
+double latestPromptComplexity(const std::vector<Message>& messages) {
+    auto last_user = std::find_if(messages.rbegin(), messages.rend(), [](const Message& msg) { return msg.role == "user"; });
+    return last_user != messages.rend() ? RouterModel::complexityScore(last_user->content) : 0.0;
+}
+
+} // namespace
+
+RouterModel::RouterModel(std::vector<Route> routes, bool cascade)
+    : routes_(std::move(routes)),
+      stats_(routes_.size()),
+      cascade_(cascade) {
+}
+
+double RouterModel::complexityScore(const std::string& prompt) {
+    std::string text = normalize(prompt);
+    double score = 0.4 * std::min(1.0, static_cast<double>(ContextWindowManager::estimateTokens(prompt)) / kLongPromptTokens);
+    if (countContained(text, kCodeMarkers) > 0) {
+        score += 0.25;
+    }
+    score += 0.1 * static_cast<double>(std::min<size_t>(countContained(text, kReasoningWords), 3));
+    // Several questions or a list of requirements.
+    if (std::count(text.begin(), text.end(), '?') >= 2 || std::count(text.begin(), text.end(), '\n') >= 4) {
+        score += 0.1;
+    }
+    return std::min(score, 1.0);
+}
+
+std::string RouterModel::rejectionReason(const Message& reply, const GenerationParams& params) {
+    if (!reply.tool_calls.empty()) {
+        return "";
+    }
+    if (reply.content.find_first_not_of(" \t\r\n") == std::string::npos) {
+        return "empty reply";
+    }
+    if (!params.json_schema.is_null() && !JsonSchemaValidator::validate(params.json_schema, reply.content)) {
+        return "reply does not match the JSON Schema";
+    }
+    if (countContained(normalize(std::string_view(reply.content).substr(0, kHedgingWindow)), kHedgingPhrases) > 0) {
+        return "low-confidence reply";
+    }
+    return "";
+}
+
+bool RouterModel::accepts(size_t index, size_t prompt_tokens) const {
+    const Route& route = routes_[index];
+    size_t limit = route.max_prompt_tokens > 0 ? route.max_prompt_tokens : ContextWindowManager::contextLimitForModel(route.model->modelName());
+    return (limit == 0 || prompt_tokens <= limit) && std::chrono::steady_clock::now() >= stats_[index].paused_until;
+}
+
+size_t RouterModel::firstRoute(size_t prompt_tokens, double complexity) const {
+    for (size_t i = 0; i + 1 < routes_.size(); ++i) {
+        if (complexity <= routes_[i].max_complexity && accepts(i, prompt_tokens)) {
+            return i;
+        }
+    }
+    return routes_.size() - 1;
+}
+
+size_t RouterModel::nextRoute(size_t current, size_t prompt_tokens) const {
+    for (size_t i = current + 1; i + 1 < routes_.size(); ++i) {
+        if (accepts(i, prompt_tokens)) {
+            return i;
+        }
+    }
+    return current + 1 < routes_.size() ? routes_.size() - 1 : routes_.size();
+}
+
+void RouterModel::record(size_t index, bool ok, double latency_ms) {
+    RouteStats& stats = stats_[index];
+    double error = ok ? 0.0 : 1.0;
+    if (stats.requests++ == 0) {
+        stats.error_rate = error;
+        stats.latency_ms = ok ? latency_ms : 0.0;
+    } else {
+        stats.error_rate += kStatsWeight * (error - stats.error_rate);
+        if (ok) {
+            stats.latency_ms += kStatsWeight * (latency_ms - stats.latency_ms);
+        }
+    }
+    double max_latency_ms = routes_[index].max_latency_ms;
+    bool failing = stats.requests >= kMinRequests && stats.error_rate >= kPauseErrorRate;
+    bool slow = ok && max_latency_ms > 0.0 && stats.latency_ms > max_latency_ms;
+    // The last route takes every request no other route accepts, so it is never paused.
+    if ((failing || slow) && index + 1 < routes_.size()) {
+        std::cerr << "Warning: Pausing route " << routes_[index].tier << " for " << kPauseDuration.count() << " s ("
+                  << (failing ? "requests keep failing" : "average latency " + std::to_string(static_cast<long long>(stats.latency_ms)) + " ms") << ")." << std::endl;
+        stats.paused_until = std::chrono::steady_clock::now() + kPauseDuration;
+        // Judged afresh when it is back.
+        stats.requests = 0;
+    }
+}
+
+void RouterModel::addRouteUsage(size_t index) {
+    reply_route_ = index;
+    if (std::optional<TokenUsage> usage = routes_[index].model->lastUsage()) {
+        if (!usage_) {
+            usage_ = TokenUsage{};
+        }
+        usage_->add(*usage);
+    }
+}
+
+std::optional<Message> RouterModel::sendMessage(const std::vector<Message>& messages, const GenerationParams& params) {
+    return send(messages, params, nullptr);
+}
+
+std::optional<Message> RouterModel::sendMessageStreaming(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback& on_delta) {
+    return send(messages, params, &on_delta);
+}
+
+std::optional<Message> RouterModel::send(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback* on_delta) {
+    usage_.reset();
+    std::optional<Message> reply = sendAlongRoutes(messages, params, on_delta);
+    if (!reply) {
+        usage_.reset();
+    }
+    return reply;
+}
+
+std::optional<Message> RouterModel::sendAlongRoutes(const std::vector<Message>& messages, const GenerationParams& params, const DeltaCallback* on_delta) {
+    size_t prompt_tokens = promptTokens(messages);
+    double complexity = latestPromptComplexity(messages);
+
+    for (size_t index = firstRoute(prompt_tokens, complexity); index < routes_.size();) {
+        size_t next = nextRoute(index, prompt_tokens);
+        IAIModel& model = *routes_[index].model;
+        // Replies that may still be escalated are held back until they are checked.
+        bool checked = cascade_ && next < routes_.size();
+        bool delivered = false;
+        bool stopped = false;
+        std::optional<double> first_token_ms;
+        auto started = std::chrono::steady_clock::now();
+        std::optional<Message> reply;
+        if (on_delta) {
+            reply = model.sendMessageStreaming(messages, params, [&](std::string_view delta) {
+                if (!first_token_ms) {
+                    first_token_ms = millisecondsSince(started);
+                }
+                if (checked) {
+                    return !HttpClient::cancelRequested();
+                }
+                delivered = true;
+                stopped = !(*on_delta)(delta);
+                return !stopped;
+            });
+        } else {
+            reply = model.sendMessage(messages, params);
+        }
+        addRouteUsage(index);
+        if (stopped || (!reply && HttpClient::cancelRequested())) {
+            return std::nullopt;
+        }
+        record(index, reply.has_value(), first_token_ms.value_or(millisecondsSince(started)));
+        if (!reply) {
+            if (delivered || next == routes_.size()) {
+                return std::nullopt;
+            }
+            std::cerr << "Warning: Route " << routes_[index].tier << " failed; trying " << routes_[next].tier << "." << std::endl;
+            index = next;
+            continue;
+        }
+        if (checked) {
+            std::string reason = rejectionReason(*reply, params);
+            if (!reason.empty()) {
+                std::cerr << "Note: Escalating from " << routes_[index].tier << " to " << routes_[next].tier << " (" << reason << ")." << std::endl;
+                // The rejected reply is not part of the conversation, but the route may have kept it
+                // in its session (e.g. a realtime conversation or a stored Responses turn).
+                model.invalidateConversationCache(messages.size());
+                index = next;
+                continue;
+            }
+            if (on_delta && !(*on_delta)(reply->content)) {
+                return std::nullopt;
+            }
+        }
+        return reply;
+    }
+    return std::nullopt;
+}
+
+std::optional<std::vector<Message>> RouterModel::sendMessageCandidates(const std::vector<Message>& messages, const GenerationParams& params) {
+    usage_.reset();
+    size_t prompt_tokens = promptTokens(messages);
+    double complexity = latestPromptComplexity(messages);
+
+    for (size_t index = firstRoute(prompt_tokens, complexity); index < routes_.size(); index = nextRoute(index, prompt_tokens)) {
+        auto started = std::chrono::steady_clock::now();
+        std::optional<std::vector<Message>> candidates = routes_[index].model->sendMessageCandidates(messages, params);
+        addRouteUsage(index);
+        if (!candidates && HttpClient::cancelRequested()) {
+            usage_.reset();
+            return std::nullopt;
+        }
+        record(index, candidates.has_value(), millisecondsSince(started));
+        if (candidates) {
+            return candidates;
+        }
+    }
+    usage_.reset();
+    return std::nullopt;
+}
+
+std::string RouterModel::cacheScope() const {
+    std::string scope;
+    for (const auto& route : routes_) {
+        scope += route.model->providerName() + "/" + route.model->modelName() + "\n" + route.model->cacheScope() + "\n";
+    }
+    return scope;
+}
+
+void RouterModel::invalidateConversationCache(size_t first_changed_index) {
+    for (auto& route : routes_) {
+        route.model->invalidateConversationCache(first_changed_index);
+    }
+}
+
+bool RouterModel::setCachedPrefix(size_t message_count) {
+    bool supported = false;
+    for (auto& route : routes_) {
+        supported = route.model->setCachedPrefix(message_count) || supported;
+    }
+    return supported;
+}
+
+bool RouterModel::setTools(const std::vector<ToolDefinition>& tools) {
+    bool supported = std::all_of(routes_.begin(), routes_.end(), [&tools](Route& route) { return route.model->setTools(tools); });
+    if (!supported && !tools.empty()) {
+        // No route may call tools that are not going to be run.
+        for (auto& route : routes_) {
+            route.model->setTools({});
+        }
+    }
+    return supported;
+}
+
+nlohmann::json RouterModel::exportConversationState() const {
+    nlohmann::json routes = nlohmann::json::array();
+    bool any = false;
+    for (const auto& route : routes_) {
+        routes.push_back(route.model->exportConversationState());
+        any = any || !routes.back().is_null();
+    }
+    return any ? nlohmann::json{{"routes", routes}} : nlohmann::json();
+}
+
+void RouterModel::importConversationState(const nlohmann::json& state) {
+    const nlohmann::json routes = state.is_object() ? state.value("routes", nlohmann::json()) : nlohmann::json();
+    for (size_t i = 0; i < routes_.size(); ++i) {
+        routes_[i].model->importConversationState(routes.is_array() && i < routes.size() ? routes[i] : nlohmann::json());
+    }
+}
+
+std::optional<EmbeddingMatrix> RouterModel::embedBatch(const std::vector<std::string>& texts) {
+    for (auto& route : routes_) {
+        if (!route.model->embeddingModelName().empty()) {
+            return route.model->embedBatch(texts);
+        }
+    }
+    return std::nullopt;
+}
+
+std::string RouterModel::embeddingModelName() const {
+    for (const auto& route : routes_) {
+        std::string name = route.model->embeddingModelName();
+        if (!name.empty()) {
+            return name;
+        }
+    }
+    return "";
+}
@@ -0,0 +1,125 @@
+#include "SemanticCache.h"
+#include "JsonWriter.h"
+#include "Sha256.h"
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+SemanticCache::SemanticCache(fs::path directory, float min_similarity)
+    : directory_(std::move(directory)), min_similarity_(min_similarity) {
+}
+
+std::optional<std::string> SemanticCache::promptOf(const std::vector<Message>& messages) {
+    if (messages.empty() || messages.back().role != "user") {
+        return std::nullopt;
+    }
+    for (size_t i = 0; i + 1 < messages.size(); ++i) {
+        if (messages[i].role != "system") {
+            return std::nullopt;
+        }
+    }
+    return messages.back().content;
+}
+
+std::string SemanticCache::partitionKey(const IAIModel& model, const GenerationParams& params, const std::vector<Message>& messages) {
+    std::string canonical;
+    JsonWriter writer(canonical);
+    writer.beginObject();
+    writer.key("provider");
+    writer.value(model.providerName());
+    writer.key("scope");
+    writer.value(model.cacheScope());
+    writer.key("model");
+    writer.value(model.modelName());
+    writer.key("embedding_model");
+    writer.value(model.embeddingModelName());
+    writer.key("params");
+    writer.rawValue(params.toJson().dump());
+    writer.key("system");
+    writer.beginArray();
+    for (size_t i = 0; i + 1 < messages.size(); ++i) {
+        writer.value(messages[i].content);
+    }
+    writer.endArray();
+    writer.endObject();
+    return Sha256::hex(canonical);
+}
+
+fs::path SemanticCache::recordsPath(const std::string& partition) const {
+    return directory_ / (partition + ".jsonl");
+}
+
+VectorIndex& SemanticCache::index(const std::string& partition) {
+    std::unique_ptr<VectorIndex>& index = indexes_[partition];
+    if (!index) {
+        index = std::make_unique<VectorIndex>(directory_ / (partition + ".vec"));
+    }
+    return *index;
+}
+
+std::optional<SemanticCache::Hit> SemanticCache::lookup(const std::string& partition, const std::vector<float>& embedding) {
+    ++stats_.lookups;
+    std::optional<VectorIndex::Match> match = index(partition).findNearest(embedding);
+    if (!match || match->similarity < min_similarity_) {
+        return std::nullopt;
+    }
+    std::ifstream ifs(recordsPath(partition), std::ios::binary);
+    std::string line;
+    if (!ifs.seekg(static_cast<std::streamoff>(match->payload)) || !std::getline(ifs, line)) {
+        return std::nullopt;
+    }
+    try {
+        nlohmann::json record = nlohmann::json::parse(line);
+        Hit hit{{record.at("role").get<std::string>(), record.at("content").get<std::string>()},
+                record.at("prompt").get<std::string>(), match->similarity};
+        ++stats_.hits;
+        return hit;
+    } catch (const nlohmann::json::exception&) {
+        return std::nullopt;
+    }
+}
+
+void SemanticCache::store(const std::string& partition, const std::vector<float>& embedding, const std::string& prompt, const Message& reply) {
+    std::error_code ec;
+    fs::create_directories(directory_, ec);
+    fs::path records_path = recordsPath(partition);
+    int fd = ::open(records_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        std::cerr << "Warning: Could not open semantic cache " << records_path << ": " << std::strerror(errno) << std::endl;
+        return;
+    }
+    std::string line;
+    JsonWriter writer(line);
+    writer.beginObject();
+    writer.key("prompt");
+    writer.value(prompt);
+    writer.key("role");
+    writer.value(reply.role);
+    writer.key("content");
+    writer.value(reply.content);
+    writer.endObject();
+    line += '\n';
+
+    // The record's offset becomes the vector's payload; the lock keeps it exact with concurrent writers.
+    ::flock(fd, LOCK_EX);
+    struct stat info;
+    bool ok = ::fstat(fd, &info) == 0;
+    uint64_t offset = ok ? static_cast<uint64_t>(info.st_size) : 0;
+    ok = ok && ::write(fd, line.data(), line.size()) == static_cast<ssize_t>(line.size());
+    ::flock(fd, LOCK_UN);
+    ::close(fd);
+    if (!ok) {
+        std::cerr << "Warning: Could not write semantic cache " << records_path << std::endl;
+        return;
+    }
+    if (index(partition).append(embedding, offset)) {
+        ++stats_.stores;
+    }
+}
@@ -0,0 +1,56 @@
+#include "SseParser.h"
+
+SseParser::SseParser(EventCallback on_event) : on_event_(std::move(on_event)) {}
+
+bool SseParser::feed(std::string_view bytes) {
+    // Complete lines are parsed straight from `bytes`; only a trailing partial line is copied.
+    while (!bytes.empty()) {
+        size_t end = bytes.find('\n');
+        if (end == std::string_view::npos) {
+            pending_.append(bytes);
+            return true;
+        }
+        bool keep_going;
+        if (pending_.empty()) {
+            keep_going = processLine(bytes.substr(0, end));
+        } else {
+            pending_.append(bytes.substr(0, end));
+            keep_going = processLine(pending_);
+            pending_.clear();
+        }
+        if (!keep_going) {
+            return false;
+        }
+        bytes.remove_prefix(end + 1);
+    }
+    return true;
+}
+
+bool SseParser::processLine(std::string_view line) {
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    if (line.empty()) {
+        // A blank line ends the event.
+        if (!has_data_) {
+            return true;
+        }
+        has_data_ = false;
+        bool keep_going = on_event_(data_);
+        data_.clear();
+        return keep_going;
+    }
+    if (line.substr(0, 5) != "data:") {
+        return true; // Comments (":..."), event names, ids and retry hints are not needed
+    }
+    line.remove_prefix(5);
+    if (!line.empty() && line.front() == ' ') {
+        line.remove_prefix(1);
+    }
+    if (has_data_) {
+        data_ += '\n';
+    }
+    data_.append(line);
+    has_data_ = true;
+    return true;
+}
@@ -0,0 +1,127 @@
+#include "StopCondition.h"
+#include <algorithm>
+
+namespace {
+
+// Length of the fence at the start of `line` (after up to three spaces of indentation), or 0.
+size_t fenceLength(std::string_view line, char& fence_char) {
+    size_t indent = line.find_first_not_of(' ');
+    if (indent == std::string_view::npos || indent > 3 || (line[indent] != '`' && line[indent] != '~')) {
+        return 0;
+    }
+    char c = line[indent];
+    size_t end = line.find_first_not_of(c, indent);
+    size_t length = (end == std::string_view::npos ? line.size() : end) - indent;
+    if (length < 3) {
+        return 0;
+    }
+    fence_char = c;
+    return length;
+}
+
+} // namespace
+
+StopCondition::StopCondition(const Rules& rules) : rules_(rules) {
+    for (const auto& stop : rules_.stop_strings) {
+        longest_stop_ = std::max(longest_stop_, stop.size());
+    }
+}
+
+void StopCondition::checkLine(size_t begin, size_t end, size_t& cut, std::string& reason) {
+    std::string_view line(text_.data() + begin, end - begin);
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    if (rules_.stop_regex) {
+        std::cmatch match;
+        if (std::regex_search(line.data(), line.data() + line.size(), match, *rules_.stop_regex) && begin + match.position(0) < cut) {
+            cut = begin + match.position(0);
+            reason = "stop pattern";
+        }
+    }
+    if (rules_.first_code_block) {
+        char fence_char = '`';
+        size_t length = fenceLength(line, fence_char);
+        if (fence_length_ == 0) {
+            if (length > 0) {
+                fence_length_ = length;
+                fence_char_ = fence_char;
+            }
+        } else if (length >= fence_length_ && fence_char == fence_char_ && line.find_first_not_of(" \t", line.find_first_not_of(' ') + length) == std::string_view::npos) {
+            if (end < cut) {
+                cut = end;
+                reason = "end of the first code block";
+            }
+        }
+    }
+}
+
+bool StopCondition::feed(std::string_view delta) {
+    if (stopped_) {
+        return false;
+    }
+    size_t old_size = text_.size();
+    text_.append(delta);
+    size_t cut = std::string::npos;
+    std::string reason;
+
+    if (longest_stop_ > 0) {
+        // A stop string may straddle the previous piece.
+        size_t from = old_size >= longest_stop_ ? old_size - longest_stop_ + 1 : 0;
+        for (const auto& stop : rules_.stop_strings) {
+            size_t position = stop.empty() ? std::string::npos : text_.find(stop, from);
+            if (position < cut) {
+                cut = position;
+                reason = "stop sequence \"" + stop + "\"";
+            }
+        }
+    }
+
+    if (rules_.stop_regex || rules_.first_code_block) {
+        for (size_t newline = text_.find('\n', old_size); newline != std::string::npos && line_start_ < cut; newline = text_.find('\n', line_start_)) {
+            checkLine(line_start_, newline, cut, reason);
+            line_start_ = newline + 1;
+        }
+        // The line still being received: `$` must not match at its current end.
+        if (rules_.stop_regex && line_start_ < cut && line_start_ < text_.size()) {
+            std::cmatch match;
+            const char* begin = text_.data() + line_start_;
+            if (std::regex_search(begin, static_cast<const char*>(text_.data() + text_.size()), match, *rules_.stop_regex, std::regex_constants::match_not_eol) &&
+                line_start_ + match.position(0) < cut) {
+                cut = line_start_ + match.position(0);
+                reason = "stop pattern";
+            }
+        }
+    }
+
+    if (rules_.max_chars > 0) {
+        for (size_t i = old_size; i < text_.size() && i < cut; ++i) {
+            // Continuation bytes (10xxxxxx) do not start a character.
+            if ((static_cast<unsigned char>(text_[i]) & 0xC0) != 0x80 && ++chars_ > rules_.max_chars) {
+                cut = i;
+                reason = "max_chars " + std::to_string(rules_.max_chars);
+                break;
+            }
+        }
+    }
+
+    if (cut == std::string::npos) {
+        return true;
+    }
+    text_.resize(cut);
+    stopped_ = true;
+    reason_ = std::move(reason);
+    return false;
+}
+
+bool StopCondition::truncate(const Rules& rules, std::string& text, std::string* reason) {
+    StopCondition condition(rules);
+    if (condition.feed(text)) {
+        return false;
+    }
+    text = std::move(condition.text_);
+    if (reason) {
+        *reason = condition.reason_;
+    }
+    return true;
+}
@@ -0,0 +1,260 @@
+#include "ToolExecutor.h"
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace {
+
+// Output beyond this is dropped so a runaway tool cannot flood the model's context.
+constexpr size_t kMaxToolOutputBytes = 64 * 1024;
+
+struct ProcessResult {
+    std::string output;
+    int exit_status = -1;
+    bool timed_out = false;
+    std::string spawn_error; // Set if the program could not be started
+};
+
+void closeFd(int& fd) {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+// Runs `command` with `input` on its standard input and collects stdout and stderr, killing its
+// process group once `timeout` has elapsed.
+ProcessResult runProcess(const std::vector<std::string>& command, const std::string& input, std::chrono::milliseconds timeout) {
+    ProcessResult result;
+    int in_pipe[2];
+    int out_pipe[2];
+    if (pipe2(in_pipe, O_CLOEXEC) != 0) {
+        result.spawn_error = std::strerror(errno);
+        return result;
+    }
+    if (pipe2(out_pipe, O_CLOEXEC) != 0) {
+        result.spawn_error = std::strerror(errno);
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+        return result;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in_pipe[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDERR_FILENO);
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    // Own process group, so a timeout also stops anything the tool started; SIGPIPE is ignored by
+    // HAICL but should behave normally in the tool.
+    sigset_t default_signals;
+    sigemptyset(&default_signals);
+    sigaddset(&default_signals, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attributes, &default_signals);
+    posix_spawnattr_setpgroup(&attributes, 0);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETPGROUP);
+
+    std::vector<char*> argv;
+    for (const auto& arg : command) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    pid_t pid;
+    int spawn_status = posix_spawnp(&pid, argv[0], &actions, &attributes, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    close(in_pipe[0]);
+    close(out_pipe[1]);
+    int in_fd = in_pipe[1];
+    int out_fd = out_pipe[0];
+    if (spawn_status != 0) {
+        result.spawn_error = std::strerror(spawn_status);
+        closeFd(in_fd);
+        closeFd(out_fd);
+        return result;
+    }
+    fcntl(in_fd, F_SETFL, fcntl(in_fd, F_GETFL) | O_NONBLOCK);
+    fcntl(out_fd, F_SETFL, fcntl(out_fd, F_GETFL) | O_NONBLOCK);
+
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    size_t written = 0;
+    if (input.empty()) {
+        closeFd(in_fd);
+    }
+    char buffer[8192];
+    while (out_fd >= 0) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (remaining.count() <= 0) {
+            result.timed_out = true;
+            break;
+        }
+        pollfd fds[2];
+        nfds_t count = 0;
+        fds[count++] = {out_fd, POLLIN, 0};
+        if (in_fd >= 0) {
+            fds[count++] = {in_fd, POLLOUT, 0};
+        }
+        if (poll(fds, count, static_cast<int>(remaining.count())) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (count > 1 && fds[1].revents != 0) {
+            ssize_t n = write(in_fd, input.data() + written, input.size() - written);
+            if (n > 0) {
+                written += static_cast<size_t>(n);
+            }
+            // Done, or the tool closed its input without reading everything (EPIPE).
+            if (written == input.size() || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+                closeFd(in_fd);
+            }
+        }
+        if (fds[0].revents != 0) {
+            ssize_t n = read(out_fd, buffer, sizeof(buffer));
+            if (n > 0) {
+                size_t keep = std::min(static_cast<size_t>(n), kMaxToolOutputBytes - std::min(kMaxToolOutputBytes, result.output.size()));
+                result.output.append(buffer, keep);
+            } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+                closeFd(out_fd); // The tool closed its output, normally by exiting
+            }
+        }
+    }
+    closeFd(in_fd);
+    closeFd(out_fd);
+
+    int status = 0;
+    while (!result.timed_out) {
+        pid_t waited = waitpid(pid, &status, WNOHANG);
+        if (waited == pid) {
+            break;
+        }
+        if (waited < 0 && errno != EINTR) {
+            return result;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            result.timed_out = true;
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    if (result.timed_out) {
+        kill(-pid, SIGKILL);
+        waitpid(pid, &status, 0);
+        return result;
+    }
+    result.exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    return result;
+}
+
+} // namespace
+
+ToolExecutor::ToolExecutor(std::vector<LocalTool> tools, size_t worker_count, size_t max_rounds)
+    : tools_(std::move(tools)), max_rounds_(max_rounds) {
+    // A tool exiting before reading all of its input must not kill HAICL with SIGPIPE.
+    std::signal(SIGPIPE, SIG_IGN);
+    worker_count = std::max<size_t>(1, worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers_.emplace_back(&ToolExecutor::workerLoop, this);
+    }
+}
+
+ToolExecutor::~ToolExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_available_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+std::vector<ToolDefinition> ToolExecutor::definitions() const {
+    std::vector<ToolDefinition> definitions;
+    for (const auto& tool : tools_) {
+        definitions.push_back(tool.definition);
+    }
+    return definitions;
+}
+
+void ToolExecutor::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_available_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return; // Stopping
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        task();
+    }
+}
+
+std::vector<Message> ToolExecutor::run(const std::vector<ToolCall>& calls) {
+    std::vector<Message> results(calls.size());
+    size_t pending = calls.size();
+    std::mutex done_mutex;
+    std::condition_variable done;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < calls.size(); ++i) {
+            queue_.push_back([this, &calls, &results, &pending, &done_mutex, &done, i]() {
+                Message result = runOne(calls[i]);
+                std::lock_guard<std::mutex> done_lock(done_mutex);
+                results[i] = std::move(result);
+                if (--pending == 0) {
+                    done.notify_one();
+                }
+            });
+        }
+    }
+    work_available_.notify_all();
+    std::unique_lock<std::mutex> done_lock(done_mutex);
+    done.wait(done_lock, [&pending]() { return pending == 0; });
+    return results;
+}
+
+Message ToolExecutor::runOne(const ToolCall& call) const {
+    Message result;
+    result.role = "tool";
+    result.tool_call_id = call.id;
+    result.tool_name = call.name;
+    auto tool = std::find_if(tools_.begin(), tools_.end(), [&call](const LocalTool& candidate) {
+        return candidate.definition.name == call.name;
+    });
+    if (tool == tools_.end()) {
+        result.content = "Error: unknown tool \"" + call.name + "\".";
+        return result;
+    }
+
+    ProcessResult process = runProcess(tool->command, call.arguments.empty() ? "{}" : call.arguments, tool->timeout);
+    if (!process.spawn_error.empty()) {
+        result.content = "Error: could not start tool \"" + call.name + "\": " + process.spawn_error;
+        return result;
+    }
+    result.content = std::move(process.output);
+    auto appendNote = [&result](const std::string& note) {
+        result.content += (result.content.empty() ? "[" : "\n[") + note + "]";
+    };
+    if (result.content.size() >= kMaxToolOutputBytes) {
+        appendNote("output truncated");
+    }
+    if (process.timed_out) {
+        appendNote("timed out after " + std::to_string(tool->timeout.count()) + " ms; the tool was stopped");
+    } else if (process.exit_status != 0) {
+        appendNote("exit status " + std::to_string(process.exit_status));
+    }
+    return result;
+}
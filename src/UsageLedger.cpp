@@ -0,0 +1,78 @@
+#include "UsageLedger.h"
+#include "json.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string formatLocalTime(std::time_t time, const char* format) {
+    std::tm local{};
+    localtime_r(&time, &local);
+    char buffer[64];
+    size_t length = std::strftime(buffer, sizeof(buffer), format, &local);
+    return std::string(buffer, length);
+}
+
+// Milliseconds, rounded to a tenth.
+double toMilliseconds(double seconds) {
+    return std::round(seconds * 10000.0) / 10.0;
+}
+
+} // namespace
+
+UsageLedger::UsageLedger(fs::path directory) : directory_(std::move(directory)) {}
+
+fs::path UsageLedger::defaultDirectory() {
+    if (const char* xdg_data = std::getenv("XDG_DATA_HOME"); xdg_data && *xdg_data) {
+        return fs::path(xdg_data) / "haicl" / "usage";
+    }
+    if (const char* home_dir = std::getenv("HOME")) {
+        return fs::path(home_dir) / ".local" / "share" / "haicl" / "usage";
+    }
+    return fs::current_path() / ".haicl-usage";
+}
+
+void UsageLedger::record(const std::string& provider, const std::string& model, const std::optional<TokenUsage>& usage, const TurnTiming& timing) {
+    std::time_t now = std::time(nullptr);
+    nlohmann::ordered_json entry = {
+        {"time", formatLocalTime(now, "%Y-%m-%dT%H:%M:%S%z")},
+        {"provider", provider},
+        {"model", model},
+        {"total_ms", toMilliseconds(timing.total_seconds)},
+    };
+    if (timing.first_token_seconds) {
+        entry["first_token_ms"] = toMilliseconds(*timing.first_token_seconds);
+    }
+    if (usage) {
+        entry["prompt_tokens"] = usage->prompt_tokens;
+        entry["cached_tokens"] = usage->cached_tokens;
+        entry["completion_tokens"] = usage->completion_tokens;
+        entry["tokens_per_second"] = std::round(timing.tokensPerSecond(usage->completion_tokens) * 10.0) / 10.0;
+    }
+    std::string line = entry.dump() + "\n";
+
+    std::error_code ec;
+    fs::create_directories(directory_, ec);
+    fs::path path = directory_ / (formatLocalTime(now, "%Y-%m-%d") + ".jsonl");
+    // O_APPEND makes the single write() land at the end even with several writers.
+    int fd = ec ? -1 : open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    int error = errno;
+    bool written = false;
+    if (fd >= 0) {
+        written = write(fd, line.data(), line.size()) == static_cast<ssize_t>(line.size());
+        error = errno;
+        close(fd);
+    }
+    if (!written && !warned_) {
+        std::cerr << "Warning: Could not append to usage ledger " << path << ": " << (ec ? ec.message() : std::strerror(error)) << std::endl;
+        warned_ = true;
+    }
+}
@@ -0,0 +1,30 @@
+#include "UsageStats.h"
+
+void SessionUsage::add(const std::optional<TokenUsage>& usage, const TurnTiming& timing) {
+    ++requests_;
+    total_seconds_ += timing.total_seconds;
+    if (timing.first_token_seconds) {
+        first_token_seconds_ += *timing.first_token_seconds;
+        ++streamed_requests_;
+    }
+    if (usage) {
+        totals_.add(*usage);
+        if (usage->completion_tokens > 0) {
+            generated_tokens_ += usage->completion_tokens;
+            generation_seconds_ += timing.generationSeconds();
+        }
+    }
+    last_usage_ = usage;
+    last_timing_ = timing;
+}
+
+std::optional<double> SessionUsage::averageFirstTokenSeconds() const {
+    if (streamed_requests_ == 0) {
+        return std::nullopt;
+    }
+    return first_token_seconds_ / static_cast<double>(streamed_requests_);
+}
+
+double SessionUsage::tokensPerSecond() const {
+    return generation_seconds_ > 0.0 ? static_cast<double>(generated_tokens_) / generation_seconds_ : 0.0;
+}
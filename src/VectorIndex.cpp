@@ -0,0 +1,168 @@
+#include "VectorIndex.h"
+#include "VectorMath.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kMagic[4] = {'H', 'V', 'I', '1'};
+constexpr size_t kHeaderSize = 16;
+
+// Writes all of `size` bytes, retrying short writes.
+bool writeAll(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, p, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+} // namespace
+
+VectorIndex::VectorIndex(std::filesystem::path path)
+    : path_(std::move(path)) {
+}
+
+VectorIndex::~VectorIndex() {
+    unmap();
+}
+
+void VectorIndex::unmap() {
+    if (mapping_) {
+        ::munmap(const_cast<unsigned char*>(mapping_), mapping_size_);
+        mapping_ = nullptr;
+        mapping_size_ = 0;
+    }
+}
+
+bool VectorIndex::refresh() {
+    int fd = ::open(path_.c_str(), O_RDONLY);
+    if (fd < 0) {
+        unmap();
+        rows_ = 0;
+        return false;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < kHeaderSize) {
+        ::close(fd);
+        unmap();
+        rows_ = 0;
+        return false;
+    }
+    size_t file_size = static_cast<size_t>(info.st_size);
+    if (mapping_ && file_size == mapping_size_) {
+        ::close(fd);
+        return true; // Nothing was appended since the last mapping
+    }
+    unmap();
+    void* mapping = ::mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Warning: Could not map vector index " << path_ << ": " << std::strerror(errno) << std::endl;
+        rows_ = 0;
+        return false;
+    }
+    mapping_ = static_cast<const unsigned char*>(mapping);
+    mapping_size_ = file_size;
+    if (std::memcmp(mapping_, kMagic, sizeof(kMagic)) != 0) {
+        std::cerr << "Warning: Ignoring vector index with an unknown format: " << path_ << std::endl;
+        unmap();
+        rows_ = 0;
+        return false;
+    }
+    std::memcpy(&dimension_, mapping_ + sizeof(kMagic), sizeof(dimension_));
+    // A row being appended by another process may be incomplete; it is picked up next time.
+    rows_ = dimension_ > 0 ? (file_size - kHeaderSize) / rowBytes() : 0;
+    return true;
+}
+
+std::optional<VectorIndex::Match> VectorIndex::findNearest(const std::vector<float>& query) {
+    if (!refresh() || rows_ == 0 || query.size() != dimension_) {
+        return std::nullopt;
+    }
+    const size_t row_bytes = rowBytes();
+    const unsigned char* row = mapping_ + kHeaderSize;
+    Match best{0, 0, -2.0f};
+    for (size_t i = 0; i < rows_; ++i, row += row_bytes) {
+        float similarity = VectorMath::dot(query.data(), reinterpret_cast<const float*>(row + sizeof(uint64_t)), dimension_);
+        if (similarity > best.similarity) {
+            best.row = i;
+            best.similarity = similarity;
+        }
+    }
+    std::memcpy(&best.payload, mapping_ + kHeaderSize + best.row * row_bytes, sizeof(uint64_t));
+    return best;
+}
+
+bool VectorIndex::append(const std::vector<float>& vector, uint64_t payload) {
+    if (vector.empty()) {
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(path_.parent_path(), ec);
+    int fd = ::open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        std::cerr << "Warning: Could not open vector index " << path_ << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    ::flock(fd, LOCK_EX);
+    bool ok = false;
+    bool reported = false;
+    struct stat info;
+    if (::fstat(fd, &info) == 0) {
+        size_t file_size = static_cast<size_t>(info.st_size);
+        uint32_t dimension = static_cast<uint32_t>(vector.size());
+        if (file_size < kHeaderSize) {
+            // New (or truncated) index: start over with this vector's dimension.
+            unsigned char header[kHeaderSize] = {};
+            std::memcpy(header, kMagic, sizeof(kMagic));
+            std::memcpy(header + sizeof(kMagic), &dimension, sizeof(dimension));
+            ok = ::ftruncate(fd, 0) == 0 && writeAll(fd, header, sizeof(header));
+            file_size = kHeaderSize;
+        } else {
+            unsigned char header[kHeaderSize];
+            uint32_t existing_dimension = 0;
+            if (::pread(fd, header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                std::memcmp(header, kMagic, sizeof(kMagic)) == 0) {
+                std::memcpy(&existing_dimension, header + sizeof(kMagic), sizeof(existing_dimension));
+            }
+            ok = existing_dimension == dimension;
+            if (!ok) {
+                std::cerr << "Warning: Embedding dimension " << dimension << " does not match vector index " << path_ << std::endl;
+                reported = true;
+            }
+        }
+        if (ok) {
+            const size_t row_bytes = sizeof(uint64_t) + vector.size() * sizeof(float);
+            // Drop a torn row left by an interrupted writer so rows stay aligned.
+            size_t torn = (file_size - kHeaderSize) % row_bytes;
+            if (torn != 0) {
+                ok = ::ftruncate(fd, static_cast<off_t>(file_size - torn)) == 0;
+            }
+            std::vector<unsigned char> row(row_bytes);
+            std::memcpy(row.data(), &payload, sizeof(payload));
+            std::memcpy(row.data() + sizeof(payload), vector.data(), vector.size() * sizeof(float));
+            ok = ok && writeAll(fd, row.data(), row.size());
+        }
+    }
+    if (!ok && !reported) {
+        std::cerr << "Warning: Could not append to vector index " << path_ << std::endl;
+    }
+    ::flock(fd, LOCK_UN);
+    ::close(fd);
+    return ok;
+}
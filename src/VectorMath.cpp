@@ -0,0 +1,148 @@
+#include "VectorMath.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#define HAICL_VECTOR_MATH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+float dotScalar(const float* a, const float* b, size_t size) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < size; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+#ifdef HAICL_VECTOR_MATH_X86
+
+float dotSse(const float* a, const float* b, size_t size) {
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 sum = _mm_add_ps(sum0, sum1);
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, sum);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + dotScalar(a + i, b + i, size - i);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define HAICL_VECTOR_MATH_AVX2 1
+
+__attribute__((target("avx2,fma")))
+float dotAvx2(const float* a, const float* b, size_t size) {
+    // Two independent accumulators hide the FMA latency.
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+    }
+    __m256 sum = _mm256_add_ps(sum0, sum1);
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, half);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + dotSse(a + i, b + i, size - i);
+}
+#endif
+
+#endif // HAICL_VECTOR_MATH_X86
+
+using DotFn = float (*)(const float*, const float*, size_t);
+
+DotFn selectDot() {
+#if defined(HAICL_VECTOR_MATH_AVX2)
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return dotAvx2;
+    }
+#endif
+#if defined(HAICL_VECTOR_MATH_X86)
+    return dotSse;
+#else
+    return dotScalar;
+#endif
+}
+
+// Resolved once; the CPU does not change underneath us.
+const DotFn dot_impl = selectDot();
+
+} // namespace
+
+namespace VectorMath {
+
+float dot(const float* a, const float* b, size_t size) {
+    return dot_impl(a, b, size);
+}
+
+bool normalize(std::vector<float>& vector) {
+    double norm_squared = 0.0;
+    for (float value : vector) {
+        norm_squared += static_cast<double>(value) * value;
+    }
+    double norm = std::sqrt(norm_squared);
+    if (!(norm > 0.0) || !std::isfinite(norm)) {
+        return false;
+    }
+    float scale = static_cast<float>(1.0 / norm);
+    for (float& value : vector) {
+        value *= scale;
+    }
+    return true;
+}
+
+void normalizeRows(EmbeddingMatrix& matrix) {
+    for (size_t i = 0; i < matrix.rows; ++i) {
+        float* row = matrix.row(i);
+        float norm = std::sqrt(dot_impl(row, row, matrix.dimension));
+        if (!(norm > 0.0f) || !std::isfinite(norm)) {
+            continue;
+        }
+        float scale = 1.0f / norm;
+        for (size_t j = 0; j < matrix.dimension; ++j) {
+            row[j] *= scale;
+        }
+    }
+}
+
+void dotRows(const float* query, const EmbeddingMatrix& matrix, std::vector<float>& scores) {
+    scores.resize(matrix.rows);
+    for (size_t i = 0; i < matrix.rows; ++i) {
+        scores[i] = dot_impl(query, matrix.row(i), matrix.dimension);
+    }
+}
+
+std::vector<ScoredRow> topK(const float* query, const EmbeddingMatrix& matrix, size_t k) {
+    k = std::min(k, matrix.rows);
+    std::vector<ScoredRow> best;
+    if (k == 0) {
+        return best;
+    }
+    best.reserve(k);
+    // Min-heap on score holding the best k rows seen so far.
+    auto worse = [](const ScoredRow& a, const ScoredRow& b) {
+        return a.score > b.score;
+    };
+    for (size_t i = 0; i < matrix.rows; ++i) {
+        float score = dot_impl(query, matrix.row(i), matrix.dimension);
+        if (best.size() < k) {
+            best.push_back({i, score});
+            std::push_heap(best.begin(), best.end(), worse);
+        } else if (score > best.front().score) {
+            std::pop_heap(best.begin(), best.end(), worse);
+            best.back() = {i, score};
+            std::push_heap(best.begin(), best.end(), worse);
+        }
+    }
+    std::sort_heap(best.begin(), best.end(), worse);
+    return best;
+}
+
+} // namespace VectorMath
@@ -0,0 +1,425 @@
+#include "WebSocketClient.h"
+#include "Base64.h"
+#include "HttpClient.h"
+#include <curl/curl.h>
+#include <poll.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+namespace {
+
+constexpr unsigned char kOpContinuation = 0x0;
+constexpr unsigned char kOpText = 0x1;
+constexpr unsigned char kOpBinary = 0x2;
+constexpr unsigned char kOpClose = 0x8;
+constexpr unsigned char kOpPing = 0x9;
+constexpr unsigned char kOpPong = 0xA;
+
+// Larger messages are refused instead of being buffered.
+constexpr uint64_t kMaxMessageBytes = 64ull << 20;
+constexpr long kConnectTimeoutMs = 30000;
+constexpr int kHandshakeTimeoutMs = 30000;
+constexpr int kSendTimeoutMs = 30000;
+// Cancellation is checked at least this often while waiting.
+constexpr int kPollSliceMs = 100;
+
+// SHA-1 (FIPS 180-4), only used to check the server's Sec-WebSocket-Accept. Returns the raw digest.
+std::string sha1(std::string_view data) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::string message(data);
+    uint64_t bit_length = static_cast<uint64_t>(data.size()) * 8;
+    message += static_cast<char>(0x80);
+    while (message.size() % 64 != 56) {
+        message += '\0';
+    }
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        message += static_cast<char>((bit_length >> shift) & 0xFF);
+    }
+    auto rotl = [](uint32_t x, int n) { return (x << n) | (x >> (32 - n)); };
+    for (size_t block = 0; block < message.size(); block += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const auto* p = reinterpret_cast<const unsigned char*>(message.data() + block + i * 4);
+            w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            uint32_t f;
+            uint32_t k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    std::string digest;
+    for (uint32_t word : h) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            digest += static_cast<char>((word >> shift) & 0xFF);
+        }
+    }
+    return digest;
+}
+
+// Value of the header `name` (lowercase) in an HTTP response head, or empty.
+std::string headerValue(const std::string& head, std::string_view name) {
+    size_t line_start = head.find("\r\n");
+    while (line_start != std::string::npos) {
+        line_start += 2;
+        size_t line_end = head.find("\r\n", line_start);
+        std::string_view line(head.data() + line_start, (line_end == std::string::npos ? head.size() : line_end) - line_start);
+        size_t colon = line.find(':');
+        if (colon == name.size() && std::equal(name.begin(), name.end(), line.begin(), [](char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); })) {
+            std::string_view value = line.substr(colon + 1);
+            size_t first = value.find_first_not_of(" \t");
+            size_t last = value.find_last_not_of(" \t");
+            return first == std::string_view::npos ? "" : std::string(value.substr(first, last - first + 1));
+        }
+        line_start = line_end;
+    }
+    return "";
+}
+
+// Called by curl at least once per second while it connects; a non-zero result aborts the attempt.
+int cancelProgressCallback(void*, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    return HttpClient::cancelRequested() ? 1 : 0;
+}
+
+} // namespace
+
+WebSocketClient::WebSocketClient() : random_(std::random_device{}()) {
+}
+
+WebSocketClient::~WebSocketClient() {
+    close();
+}
+
+bool WebSocketClient::connect(const std::string& url, const std::map<std::string, std::string>& headers) {
+    close();
+    bool secure = url.rfind("wss://", 0) == 0;
+    if (!secure && url.rfind("ws://", 0) != 0) {
+        std::cerr << "Error: WebSocket URLs must start with ws:// or wss://: " << url << std::endl;
+        return false;
+    }
+    size_t authority_start = secure ? 6 : 5;
+    size_t target_start = url.find_first_of("/?", authority_start);
+    std::string authority = url.substr(authority_start, target_start - authority_start);
+    std::string target = target_start == std::string::npos ? "/" : url.substr(target_start);
+    if (target[0] == '?') {
+        target.insert(0, "/");
+    }
+
+    if (HttpClient::cancelRequested()) {
+        return false;
+    }
+    HttpClient::ensureCurlInitialized();
+    CURL* curl = curl_easy_init();
+    if (!curl) {
+        return false;
+    }
+    // Only the connection (and TLS) is set up by curl; the upgrade request is sent below.
+    std::string connect_url = (secure ? "https://" : "http://") + authority + "/";
+    curl_easy_setopt(curl, CURLOPT_URL, connect_url.c_str());
+    curl_easy_setopt(curl, CURLOPT_CONNECT_ONLY, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, kConnectTimeoutMs);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, cancelProgressCallback);
+    CURLcode res = curl_easy_perform(curl);
+    if (res == CURLE_ABORTED_BY_CALLBACK) {
+        curl_easy_cleanup(curl);
+        return false; // Cancelled, not an error to report
+    }
+    if (res != CURLE_OK) {
+        std::cerr << "Error: WebSocket connection to " << authority << " failed: " << curl_easy_strerror(res) << std::endl;
+        curl_easy_cleanup(curl);
+        return false;
+    }
+    curl_ = curl;
+
+    std::string nonce(16, '\0');
+    for (char& c : nonce) {
+        c = static_cast<char>(random_() & 0xFF);
+    }
+    std::string key = Base64::encode(nonce);
+    std::string request = "GET " + target + " HTTP/1.1\r\nHost: " + authority + "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: " + key +
+                          "\r\nSec-WebSocket-Version: 13\r\n";
+    for (const auto& header : headers) {
+        request += header.first + ": " + header.second + "\r\n";
+    }
+    request += "\r\n";
+    if (!sendAll(request)) {
+        release();
+        return false;
+    }
+
+    // Anything after the response head already belongs to the first frames.
+    size_t head_end;
+    while ((head_end = received_.find("\r\n\r\n")) == std::string::npos) {
+        if (received_.size() > 64 * 1024 || !receiveMore(kHandshakeTimeoutMs)) {
+            release();
+            return false;
+        }
+    }
+    std::string head = received_.substr(0, head_end);
+    received_.erase(0, head_end + 4);
+    std::string status_line = head.substr(0, head.find("\r\n"));
+    if (status_line.size() < 12 || status_line.compare(9, 3, "101") != 0) {
+        // An API error usually explains itself in the (possibly partial) body.
+        std::cerr << "Error: WebSocket handshake rejected: " << status_line << (received_.empty() ? "" : ", Response: " + received_) << std::endl;
+        release();
+        return false;
+    }
+    if (headerValue(head, "sec-websocket-accept") != Base64::encode(sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC11D65"))) {
+        std::cerr << "Error: WebSocket handshake failed: invalid Sec-WebSocket-Accept from " << authority << std::endl;
+        release();
+        return false;
+    }
+    return true;
+}
+
+std::string WebSocketClient::encodeFrame(unsigned char opcode, std::string_view payload) {
+    std::string frame;
+    frame.reserve(payload.size() + 14);
+    frame += static_cast<char>(0x80 | opcode);
+    // Client frames are always masked (high bit of the length byte).
+    uint64_t size = payload.size();
+    if (size < 126) {
+        frame += static_cast<char>(0x80 | size);
+    } else if (size <= 0xFFFF) {
+        frame += static_cast<char>(0x80 | 126);
+        frame += static_cast<char>(size >> 8);
+        frame += static_cast<char>(size & 0xFF);
+    } else {
+        frame += static_cast<char>(0x80 | 127);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            frame += static_cast<char>((size >> shift) & 0xFF);
+        }
+    }
+    uint32_t mask = random_();
+    char key[4] = {static_cast<char>(mask >> 24), static_cast<char>(mask >> 16), static_cast<char>(mask >> 8), static_cast<char>(mask)};
+    frame.append(key, 4);
+    size_t start = frame.size();
+    frame.append(payload);
+    for (size_t i = 0; i < payload.size(); ++i) {
+        frame[start + i] ^= key[i & 3];
+    }
+    return frame;
+}
+
+bool WebSocketClient::sendText(std::string_view text) {
+    if (!curl_) {
+        return false;
+    }
+    if (!sendAll(encodeFrame(kOpText, text))) {
+        release();
+        return false;
+    }
+    return true;
+}
+
+bool WebSocketClient::sendAll(std::string_view data) {
+    while (!data.empty()) {
+        size_t sent = 0;
+        CURLcode res = curl_easy_send(static_cast<CURL*>(curl_), data.data(), data.size(), &sent);
+        if (res == CURLE_AGAIN) {
+            if (!waitForSocket(true, kSendTimeoutMs)) {
+                return false;
+            }
+            continue;
+        }
+        if (res != CURLE_OK) {
+            std::cerr << "Error: WebSocket send failed: " << curl_easy_strerror(res) << std::endl;
+            return false;
+        }
+        data.remove_prefix(sent);
+    }
+    return true;
+}
+
+bool WebSocketClient::receiveMore(int timeout_ms) {
+    char buffer[16384];
+    while (true) {
+        size_t received = 0;
+        CURLcode res = curl_easy_recv(static_cast<CURL*>(curl_), buffer, sizeof(buffer), &received);
+        if (res == CURLE_AGAIN) {
+            if (!waitForSocket(false, timeout_ms)) {
+                return false;
+            }
+            continue;
+        }
+        if (res != CURLE_OK) {
+            std::cerr << "Error: WebSocket receive failed: " << curl_easy_strerror(res) << std::endl;
+            return false;
+        }
+        if (received == 0) {
+            std::cerr << "Error: WebSocket connection closed by the server." << std::endl;
+            return false;
+        }
+        received_.append(buffer, received);
+        return true;
+    }
+}
+
+bool WebSocketClient::waitForSocket(bool for_write, int timeout_ms) {
+    curl_socket_t socket = CURL_SOCKET_BAD;
+    if (curl_easy_getinfo(static_cast<CURL*>(curl_), CURLINFO_ACTIVESOCKET, &socket) != CURLE_OK || socket == CURL_SOCKET_BAD) {
+        std::cerr << "Error: WebSocket connection lost." << std::endl;
+        return false;
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (true) {
+        if (HttpClient::cancelRequested()) {
+            return false;
+        }
+        int slice = kPollSliceMs;
+        if (timeout_ms > 0) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if (remaining <= 0) {
+                std::cerr << "Error: WebSocket timed out after " << timeout_ms / 1000 << " s." << std::endl;
+                return false;
+            }
+            slice = static_cast<int>(std::min<long long>(remaining, kPollSliceMs));
+        }
+        pollfd descriptor{socket, static_cast<short>(for_write ? POLLOUT : POLLIN), 0};
+        int ready = poll(&descriptor, 1, slice);
+        if (ready > 0) {
+            return true; // Also on hang-ups and errors, which the next send/recv reports
+        }
+        if (ready < 0 && errno != EINTR) {
+            std::cerr << "Error: WebSocket poll failed." << std::endl;
+            return false;
+        }
+    }
+}
+
+std::optional<std::string> WebSocketClient::receiveText(int idle_timeout_ms) {
+    while (curl_) {
+        if (HttpClient::cancelRequested()) {
+            close();
+            return std::nullopt;
+        }
+        // Header: FIN/opcode, mask bit and length, extended length, masking key (never set by servers).
+        size_t header_size = 2;
+        uint64_t length = 0;
+        bool complete = false;
+        if (received_.size() >= 2) {
+            unsigned char second = static_cast<unsigned char>(received_[1]);
+            length = second & 0x7F;
+            size_t extended = length == 126 ? 2 : (length == 127 ? 8 : 0);
+            header_size += extended + ((second & 0x80) ? 4 : 0);
+            if (received_.size() >= header_size) {
+                if (extended > 0) {
+                    length = 0;
+                    for (size_t i = 0; i < extended; ++i) {
+                        length = (length << 8) | static_cast<unsigned char>(received_[2 + i]);
+                    }
+                }
+                if (length > kMaxMessageBytes || message_.size() + length > kMaxMessageBytes) {
+                    std::cerr << "Error: WebSocket message exceeds " << (kMaxMessageBytes >> 20) << " MiB." << std::endl;
+                    close();
+                    return std::nullopt;
+                }
+                complete = received_.size() - header_size >= length;
+            }
+        }
+        if (!complete) {
+            if (!receiveMore(idle_timeout_ms)) {
+                close();
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        unsigned char first = static_cast<unsigned char>(received_[0]);
+        bool masked = (static_cast<unsigned char>(received_[1]) & 0x80) != 0;
+        std::string payload = received_.substr(header_size, static_cast<size_t>(length));
+        if (masked) {
+            const char* key = received_.data() + header_size - 4;
+            for (size_t i = 0; i < payload.size(); ++i) {
+                payload[i] ^= key[i & 3];
+            }
+        }
+        received_.erase(0, header_size + static_cast<size_t>(length));
+
+        unsigned char opcode = first & 0x0F;
+        if (opcode == kOpPing) {
+            if (!sendAll(encodeFrame(kOpPong, payload))) {
+                release();
+                return std::nullopt;
+            }
+            continue;
+        }
+        if (opcode == kOpPong) {
+            continue;
+        }
+        if (opcode == kOpClose) {
+            int code = payload.size() >= 2 ? (static_cast<unsigned char>(payload[0]) << 8) | static_cast<unsigned char>(payload[1]) : 1005;
+            std::cerr << "Error: WebSocket closed by the server (" << code << (payload.size() > 2 ? ": " + payload.substr(2) : "") << ")." << std::endl;
+            close();
+            return std::nullopt;
+        }
+        if (opcode == kOpText || opcode == kOpBinary) {
+            message_ = std::move(payload);
+        } else if (opcode == kOpContinuation) {
+            message_ += payload;
+        } else {
+            std::cerr << "Error: Unknown WebSocket opcode " << static_cast<int>(opcode) << "." << std::endl;
+            close();
+            return std::nullopt;
+        }
+        if (first & 0x80) {
+            std::string message = std::move(message_);
+            message_.clear();
+            return message;
+        }
+    }
+    return std::nullopt;
+}
+
+void WebSocketClient::close() {
+    if (!curl_) {
+        return;
+    }
+    // Status 1000 (normal closure); one attempt, the connection is dropped either way.
+    std::string frame = encodeFrame(kOpClose, std::string_view("\x03\xE8", 2));
+    size_t sent = 0;
+    curl_easy_send(static_cast<CURL*>(curl_), frame.data(), frame.size(), &sent);
+    release();
+}
+
+void WebSocketClient::release() {
+    if (curl_) {
+        curl_easy_cleanup(static_cast<CURL*>(curl_));
+        curl_ = nullptr;
+    }
+    received_.clear();
+    message_.clear();
+}
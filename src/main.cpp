@@ -4,70 +4,623 @@
 #include <vector>
 #include <map>
 #include <sstream>
+#include <iomanip>
+#include <iterator>
+#include <chrono>
+#include <csignal>
+#include <fstream>
 
 #include "ConfigManager.h"
 #include "CLIParser.h"
 #include "HttpClient.h"
 #include "IAIModel.h"
+#include "AsyncReply.h"
 #include "OpenAIModel.h"
 #include "GoogleAIModel.h"
+#include "LocalModel.h"
+#include "RealtimeModel.h"
 #include "HistoryManager.h"
 #include "TerminalBeautifier.h"
+#include "UsageStats.h"
+#include "UsageLedger.h"
+#include "ContextWindow.h"
+#include "BpeTokenizer.h"
+#include "ConversationCompactor.h"
+#include "ResponseCache.h"
+#include "CachingModel.h"
+#include "ResumingModel.h"
+#include "RouterModel.h"
+#include "SemanticCache.h"
+#include "ToolExecutor.h"
+#include "JsonSchemaValidator.h"
+#include "StopCondition.h"
+#include "ModelBenchmark.h"
 
-// Function to get AI model based on type and config
-std::unique_ptr<IAIModel> getAIModel(const ConfigManager& config, const std::string& model_type_arg, const std::string& model_name_arg) {
+std::unique_ptr<IAIModel> createRouterModel(const ConfigManager& config, std::shared_ptr<BpeTokenizer> tokenizer);
+
+// Function to get AI model based on type and config.
+// tokenizer: Counts tokens for OpenAI models (directly or as router routes) when the server reports none.
+std::unique_ptr<IAIModel> getAIModel(const ConfigManager& config, const std::string& model_type_arg, const std::string& model_name_arg,
+                                     std::shared_ptr<BpeTokenizer> tokenizer = nullptr) {
     std::string actual_model_type = model_type_arg.empty() ? config.getString("default_ai_model", "openai") : model_type_arg;
 
     if (actual_model_type == "openai") {
         std::string api_key = config.getString("openai.api_key");
         std::string base_url = config.getString("openai.base_url", "https://api.openai.com/v1");
         std::string model_name = model_name_arg.empty() ? config.getString("openai.model_name", "gpt-3.5-turbo") : model_name_arg;
+        std::string api_mode = config.getString("openai.api_mode", "chat");
+        std::string system_prompt = config.getString("openai.system_prompt");
         if (api_key.empty()) {
             std::cerr << TerminalBeautifier::red("Error: OpenAI API key not found. Please set OPENAI_API_KEY environment variable or in config.json.") << std::endl;
             return nullptr;
         }
         // Only create OpenAIModel if API key is present
-        return std::make_unique<OpenAIModel>(api_key, base_url, model_name);
+        auto model = std::make_unique<OpenAIModel>(api_key, base_url, model_name, api_mode, system_prompt);
+        model->setEmbeddingModel(config.getString("openai.embedding_model", "text-embedding-3-small"), config.getString("openai.embedding_base_url"),
+                                  config.getString("openai.embedding_encoding", "float") == "base64");
+        if (tokenizer) {
+            model->setTokenizer(std::move(tokenizer));
+        }
+        return model;
     } else if (actual_model_type == "google") {
         std::string api_key = config.getString("google.api_key");
         std::string base_url = config.getString("google.base_url", "https://generativelanguage.googleapis.com");
         std::string model_name = model_name_arg.empty() ? config.getString("google.model_name", "gemini-pro") : model_name_arg;
+        int cache_prefix_messages = config.getInt("google.context_cache.prefix_messages", 0);
+        int cache_ttl_seconds = config.getInt("google.context_cache.ttl_seconds", 3600);
         if (api_key.empty()) {
             std::cerr << TerminalBeautifier::red("Error: Google AI API key not found. Please set GOOGLE_API_KEY environment variable or in config.json.") << std::endl;
             return nullptr;
         }
         // Only create GoogleAIModel if API key is present
-        return std::make_unique<GoogleAIModel>(api_key, base_url, model_name);
+        auto model = std::make_unique<GoogleAIModel>(api_key, base_url, model_name, cache_prefix_messages > 0 ? static_cast<size_t>(cache_prefix_messages) : 0, cache_ttl_seconds);
+        model->setEmbeddingModel(config.getString("google.embedding_model", "text-embedding-004"));
+        return model;
+    } else if (actual_model_type == "local") {
+        std::string api_name = config.getString("local.api", "ollama");
+        std::optional<LocalModel::Api> api = LocalModel::parseApi(api_name);
+        if (!api) {
+            std::cerr << TerminalBeautifier::red("Error: Unknown local.api '" + api_name + "'. Use \"ollama\" or \"llamacpp\".") << std::endl;
+            return nullptr;
+        }
+        bool ollama = *api == LocalModel::Api::Ollama;
+        std::string base_url = config.getString("local.base_url", ollama ? "http://localhost:11434" : "http://localhost:8080");
+        std::string model_name = model_name_arg.empty() ? config.getString("local.model_name", ollama ? "llama3.2" : "default") : model_name_arg;
+        // No API key: the server runs on this machine or the local network.
+        auto model = std::make_unique<LocalModel>(base_url, model_name, *api, config.getString("local.keep_alive", ollama ? "30m" : ""),
+                                                  config.getInt("local.num_ctx", 0));
+        model->setEmbeddingModel(config.getString("local.embedding_model", "nomic-embed-text"));
+        return model;
+    } else if (actual_model_type == "realtime") {
+        // Same account as the HTTP API unless configured separately.
+        std::string api_key = config.getString("realtime.api_key", config.getString("openai.api_key"));
+        std::string base_url = config.getString("realtime.base_url", "wss://api.openai.com/v1/realtime");
+        std::string model_name = model_name_arg.empty() ? config.getString("realtime.model_name", "gpt-4o-realtime-preview") : model_name_arg;
+        if (api_key.empty()) {
+            std::cerr << TerminalBeautifier::red("Error: Realtime API key not found. Set realtime.api_key or openai.api_key in config.json, or OPENAI_API_KEY.") << std::endl;
+            return nullptr;
+        }
+        return std::make_unique<RealtimeModel>(api_key, base_url, model_name, config.getString("realtime.system_prompt"));
+    } else if (actual_model_type == "router") {
+        return createRouterModel(config, std::move(tokenizer));
     } else {
         std::cerr << TerminalBeautifier::red("Error: Unsupported AI model type: ") << actual_model_type << std::endl;
         return nullptr;
     }
 }
 
+// Lets `model` continue streamed replies cut off by a lost connection, unless "streaming.resume_attempts" is 0.
+std::unique_ptr<IAIModel> withStreamResume(const ConfigManager& config, std::unique_ptr<IAIModel> model) {
+    int resume_attempts = config.getInt("streaming.resume_attempts", 2);
+    if (!model || resume_attempts <= 0) {
+        return model;
+    }
+    return std::make_unique<ResumingModel>(std::move(model), static_cast<size_t>(resume_attempts));
+}
+
+// Builds the router from the "router" config section. "routes" lists the tiers from the cheapest to
+// the most capable model, each as {"target": "provider/model", "tier", "max_complexity",
+// "max_prompt_tokens", "max_latency_ms"}; "cascade" escalates unsatisfying replies.
+std::unique_ptr<IAIModel> createRouterModel(const ConfigManager& config, std::shared_ptr<BpeTokenizer> tokenizer) {
+    std::vector<RouterModel::Route> routes;
+    nlohmann::json entries = config.getJson("router.routes");
+    for (const auto& entry : entries.is_array() ? entries : nlohmann::json::array()) {
+        try {
+            std::optional<ModelBenchmark::Target> target = ModelBenchmark::parseTarget(entry.at("target").get<std::string>());
+            if (!target || target->provider == "router") {
+                std::cerr << TerminalBeautifier::yellow("Warning: Ignoring router route with an invalid target: ") << entry.dump() << std::endl;
+                continue;
+            }
+            std::unique_ptr<IAIModel> model = getAIModel(config, target->provider, target->model, tokenizer);
+            if (!model) {
+                return nullptr; // Reported by getAIModel()
+            }
+            RouterModel::Route route;
+            route.tier = entry.value("tier", target->label());
+            // Resumed within the route: a continuation must not be routed elsewhere.
+            route.model = withStreamResume(config, std::move(model));
+            route.max_complexity = entry.value("max_complexity", 1.0);
+            route.max_prompt_tokens = entry.value("max_prompt_tokens", static_cast<size_t>(0));
+            route.max_latency_ms = entry.value("max_latency_ms", 0.0);
+            routes.push_back(std::move(route));
+        } catch (const nlohmann::json::exception& e) {
+            std::cerr << TerminalBeautifier::yellow("Warning: Ignoring invalid router route: ") << e.what() << std::endl;
+        }
+    }
+    if (routes.empty()) {
+        std::cerr << TerminalBeautifier::red("Error: The router needs at least one valid entry in router.routes.") << std::endl;
+        return nullptr;
+    }
+    return std::make_unique<RouterModel>(std::move(routes), config.getBool("router.cascade", false));
+}
+
+// Builds the context window manager from the "context" config section.
+// The budget defaults to the model's known context limit minus the room reserved for the reply.
+ContextWindowManager createContextWindow(const ConfigManager& config, const IAIModel* model, const GenerationParams& model_params) {
+    int configured_budget = config.getInt("context.budget_tokens", 0);
+    int keep_last_messages = config.getInt("context.keep_last_messages", 4);
+    size_t budget = configured_budget > 0 ? static_cast<size_t>(configured_budget) : 0;
+    if (budget == 0 && model) {
+        int configured_limit = config.getInt("context.context_limit", 0);
+        size_t limit = configured_limit > 0 ? static_cast<size_t>(configured_limit) : ContextWindowManager::contextLimitForModel(model->modelName());
+        if (configured_limit <= 0 && model->providerName() == "local" && config.getInt("local.num_ctx", 0) > 0) {
+            // A local model only sees the context window it was loaded with.
+            limit = static_cast<size_t>(config.getInt("local.num_ctx", 0));
+        }
+        size_t reserve = model_params.max_tokens ? static_cast<size_t>(*model_params.max_tokens) : static_cast<size_t>(config.getInt("context.reserve_output_tokens", 4096));
+        if (limit > 0) {
+            budget = limit > reserve ? limit - reserve : limit / 2;
+        }
+    }
+    ContextWindowManager context_window(budget, keep_last_messages > 0 ? static_cast<size_t>(keep_last_messages) : 0);
+    int cache_prefix_messages = config.getInt("google.context_cache.prefix_messages", 0);
+    if (model && model->providerName() == "google" && cache_prefix_messages > 0) {
+        // The configured context cache prefix has to stay in every request, like one set with "cache N".
+        context_window.setPinnedPrefix(static_cast<size_t>(cache_prefix_messages));
+    }
+    return context_window;
+}
+
+// Creates the on-disk response cache from the "response_cache" config section, or nullptr if it is
+// disabled (by config or --no-cache).
+std::shared_ptr<ResponseCache> createResponseCache(const ConfigManager& config, const CommandLineArgs& args) {
+    if (args.no_cache || !config.getBool("response_cache.enabled", true)) {
+        return nullptr;
+    }
+    std::string directory = config.getString("response_cache.dir");
+    int ttl_seconds = config.getInt("response_cache.ttl_seconds", 7 * 24 * 3600);
+    int max_mb = config.getInt("response_cache.max_mb", 256);
+    return std::make_shared<ResponseCache>(directory.empty() ? ResponseCache::defaultDirectory() : std::filesystem::path(directory),
+                                           ttl_seconds > 0 ? ttl_seconds : 0,
+                                           max_mb > 0 ? static_cast<uintmax_t>(max_mb) * 1024 * 1024 : 0);
+}
+
+// Creates the semantic cache if enabled by --semantic-cache or "semantic_cache.enabled" (and caching is not disabled).
+std::shared_ptr<SemanticCache> createSemanticCache(const ConfigManager& config, const CommandLineArgs& args) {
+    if (args.no_cache || (!args.semantic_cache && !config.getBool("semantic_cache.enabled", false))) {
+        return nullptr;
+    }
+    std::string directory = config.getString("semantic_cache.dir");
+    double min_similarity = config.getDouble("semantic_cache.min_similarity", 0.92);
+    return std::make_shared<SemanticCache>(directory.empty() ? ResponseCache::defaultDirectory() / "semantic" : std::filesystem::path(directory),
+                                           static_cast<float>(min_similarity));
+}
+
+void printCacheStats(const ResponseCache* cache, const SemanticCache* semantic_cache) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1) << "[cache]";
+    if (cache) {
+        const ResponseCache::Stats& stats = cache->stats();
+        oss << " " << stats.hits << "/" << stats.lookups << " lookups hit ("
+            << stats.hitRate() * 100.0 << "%), " << stats.stores << " stored";
+    }
+    if (semantic_cache) {
+        const SemanticCache::Stats& stats = semantic_cache->stats();
+        oss << (cache ? ";" : "") << " semantic " << stats.hits << "/" << stats.lookups << " lookups hit, " << stats.stores << " stored";
+    }
+    std::cout << TerminalBeautifier::yellow(oss.str()) << std::endl;
+}
+
+// Creates the background compactor if enabled by --compact or "context.compaction.enabled".
+// Summaries are produced by a second model instance (optionally "context.compaction.model_name").
+std::unique_ptr<ConversationCompactor> createCompactor(const ConfigManager& config, const CommandLineArgs& args, const GenerationParams& model_params, const ContextWindowManager& context_window) {
+    if (!args.compact && !config.getBool("context.compaction.enabled", false)) {
+        return nullptr;
+    }
+    std::string model_name = config.getString("context.compaction.model_name");
+    std::unique_ptr<IAIModel> summary_model = getAIModel(config, args.model_type, model_name.empty() ? args.model_name : model_name);
+    if (!summary_model) {
+        return nullptr;
+    }
+    int configured_threshold = config.getInt("context.compaction.threshold_tokens", 0);
+    size_t threshold = configured_threshold > 0 ? static_cast<size_t>(configured_threshold)
+                                                : (context_window.budget() > 0 ? context_window.budget() / 2 : 16000);
+    int keep_last_messages = config.getInt("context.compaction.keep_last_messages", config.getInt("context.keep_last_messages", 4));
+    return std::make_unique<ConversationCompactor>(std::move(summary_model), model_params, threshold, keep_last_messages > 0 ? static_cast<size_t>(keep_last_messages) : 0);
+}
+
+// Creates the local tool runner if enabled by --tools or "tools.enabled". Each entry of
+// "tools.definitions" describes a tool to the model and names the program implementing it.
+std::unique_ptr<ToolExecutor> createToolExecutor(const ConfigManager& config, const CommandLineArgs& args) {
+    if (!args.tools && !config.getBool("tools.enabled", false)) {
+        return nullptr;
+    }
+    int default_timeout = config.getInt("tools.timeout_seconds", 30);
+    std::vector<LocalTool> tools;
+    nlohmann::json definitions = config.getJson("tools.definitions");
+    for (const auto& definition : definitions.is_array() ? definitions : nlohmann::json::array()) {
+        try {
+            LocalTool tool;
+            tool.definition.name = definition.at("name").get<std::string>();
+            tool.definition.description = definition.value("description", "");
+            tool.definition.parameters = definition.value("parameters", nlohmann::json::object());
+            const nlohmann::json& command = definition.at("command");
+            // A plain string is run by the shell; an array is used as argv directly.
+            tool.command = command.is_string() ? std::vector<std::string>{"/bin/sh", "-c", command.get<std::string>()}
+                                               : command.get<std::vector<std::string>>();
+            int timeout = definition.value("timeout_seconds", default_timeout);
+            tool.timeout = std::chrono::seconds(timeout > 0 ? timeout : 30);
+            if (tool.definition.name.empty() || tool.command.empty()) {
+                std::cerr << TerminalBeautifier::yellow("Warning: Ignoring tool definition without a name or command.") << std::endl;
+                continue;
+            }
+            tools.push_back(std::move(tool));
+        } catch (const nlohmann::json::exception& e) {
+            std::cerr << TerminalBeautifier::yellow("Warning: Ignoring invalid tool definition: ") << e.what() << std::endl;
+        }
+    }
+    if (tools.empty()) {
+        std::cerr << TerminalBeautifier::yellow("Warning: Tool calling is enabled but tools.definitions lists no valid tools.") << std::endl;
+        return nullptr;
+    }
+    int max_parallel = config.getInt("tools.max_parallel", 4);
+    int max_rounds = config.getInt("tools.max_rounds", 8);
+    return std::make_unique<ToolExecutor>(std::move(tools), max_parallel > 0 ? static_cast<size_t>(max_parallel) : 1,
+                                          max_rounds > 0 ? static_cast<size_t>(max_rounds) : 1);
+}
+
+// Loads the tokenizer rank file given on the command line or in config ("tokenizer.rank_file"), with
+// the pre-tokenization pattern from "tokenizer.pattern" ("cl100k" or "o200k"; by vocabulary size if unset).
+// Returns nullptr if none is configured or it cannot be loaded.
+std::shared_ptr<BpeTokenizer> loadTokenizer(const ConfigManager& config, const std::string& tokenizer_file_arg) {
+    std::string rank_file = tokenizer_file_arg.empty() ? config.getString("tokenizer.rank_file") : tokenizer_file_arg;
+    if (rank_file.empty()) {
+        return nullptr;
+    }
+    auto tokenizer = std::make_shared<BpeTokenizer>();
+    if (!tokenizer->loadRankFile(rank_file)) {
+        std::cerr << TerminalBeautifier::yellow("Warning: Tokenizer could not be loaded; token counts will be estimated.") << std::endl;
+        return nullptr;
+    }
+    std::string pattern = config.getString("tokenizer.pattern");
+    if (pattern == "cl100k") {
+        tokenizer->setPattern(BpeTokenizer::Pattern::Cl100k);
+    } else if (pattern == "o200k") {
+        tokenizer->setPattern(BpeTokenizer::Pattern::O200k);
+    } else if (!pattern.empty()) {
+        std::cerr << TerminalBeautifier::yellow("Warning: Unknown tokenizer.pattern '" + pattern + "'; expected cl100k or o200k.") << std::endl;
+    }
+    return tokenizer;
+}
+
+// Prints the token count of the prompt, or of standard input if no prompt was given.
+void handleCountTokens(const std::string& prompt, const std::shared_ptr<BpeTokenizer>& tokenizer) {
+    std::string text = prompt;
+    if (text.empty()) {
+        text.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    }
+    if (tokenizer) {
+        std::cout << tokenizer->count(text) << std::endl;
+    } else {
+        std::cout << ContextWindowManager::estimateTokens(text) << TerminalBeautifier::yellow(" (estimated; set --tokenizer or tokenizer.rank_file for a tokenizer count)") << std::endl;
+    }
+}
+
+// Formats prompt/cached/completion token counts for display.
+std::string formatTokenUsage(const TokenUsage& usage) {
+    std::ostringstream oss;
+    oss << "prompt " << usage.prompt_tokens << " tokens (cached " << usage.cached_tokens << ", "
+        << std::fixed << std::setprecision(1) << usage.cacheHitRate() * 100.0 << "%), completion "
+        << usage.completion_tokens << " tokens";
+    return oss.str();
+}
+
+// Formats time to first token, generation speed and total time for display.
+std::string formatTiming(const std::optional<double>& first_token_seconds, double tokens_per_second, double total_seconds) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(0);
+    if (first_token_seconds) {
+        oss << "first token " << *first_token_seconds * 1000.0 << " ms, ";
+    }
+    if (tokens_per_second > 0.0) {
+        oss << std::setprecision(1) << tokens_per_second << " tokens/s, " << std::setprecision(0);
+    }
+    oss << "total " << total_seconds * 1000.0 << " ms";
+    return oss.str();
+}
+
+// Where the usage of every request goes: the session totals, the usage ledger (if enabled) and,
+// with --stats, the terminal.
+struct UsageReport {
+    SessionUsage session;
+    UsageLedger* ledger = nullptr;
+    bool show = false;
+};
+
+// How the replies of every turn are requested, from the command line and config.
+struct TurnOptions {
+    size_t structured_attempts = 3; // Attempts allowed per turn when a JSON Schema is set
+    StopCondition::Rules stop;      // Client-side end of the reply
+};
+
+// Records the usage and timing of the last reply and prints them if requested.
+void reportTurnUsage(IAIModel* model, const TurnTiming& timing, UsageReport& report) {
+    if (model->lastReplyFromCache()) {
+        // No request was made: nothing to add to the session totals or the ledger.
+        if (report.show) {
+            std::cout << TerminalBeautifier::yellow("[usage] answered from the response cache; no tokens used") << std::endl;
+        }
+        return;
+    }
+    std::optional<TokenUsage> usage = model->lastUsage();
+    report.session.add(usage, timing);
+    if (report.ledger) {
+        report.ledger->record(model->replyProviderName(), model->replyModelName(), usage, timing);
+    }
+    if (report.show) {
+        std::string tokens = usage ? formatTokenUsage(*usage) : "tokens not reported by provider";
+        double tokens_per_second = usage ? timing.tokensPerSecond(usage->completion_tokens) : 0.0;
+        // Models that delegate (e.g. the router) name the model that answered.
+        std::string served_by = model->replyProviderName() != model->providerName() || model->replyModelName() != model->modelName()
+                                    ? model->replyProviderName() + "/" + model->replyModelName() + ": "
+                                    : "";
+        std::cout << TerminalBeautifier::yellow("[usage] " + served_by + tokens + "; " + formatTiming(timing.first_token_seconds, tokens_per_second, timing.total_seconds)) << std::endl;
+    }
+}
+
+void printSessionUsage(const SessionUsage& session_usage) {
+    std::cout << TerminalBeautifier::yellow("[session] " + std::to_string(session_usage.requests()) + (session_usage.requests() == 1 ? " request, " : " requests, ") + formatTokenUsage(session_usage.totals()) + "; " +
+                                            formatTiming(session_usage.averageFirstTokenSeconds(), session_usage.tokensPerSecond(), session_usage.totalSeconds()))
+              << std::endl;
+}
+
+// Prints the replies of one request, numbered when there are several candidates.
+void printCandidates(const std::vector<Message>& candidates) {
+    if (candidates.size() == 1) {
+        std::cout << TerminalBeautifier::bold(TerminalBeautifier::green("AI: ")) << candidates.front().content << std::endl;
+        return;
+    }
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        std::string label = "AI [" + std::to_string(i + 1) + "/" + std::to_string(candidates.size()) + "]: ";
+        std::cout << TerminalBeautifier::bold(TerminalBeautifier::green(label)) << candidates[i].content << std::endl;
+    }
+}
+
+// Asks which of `count` candidates continues the conversation. Empty input (or EOF) keeps the first.
+size_t pickCandidate(size_t count) {
+    if (count <= 1) {
+        return 0;
+    }
+    while (true) {
+        std::cout << TerminalBeautifier::yellow("Keep which candidate? [1-" + std::to_string(count) + ", Enter = 1]: ");
+        std::string choice;
+        if (!std::getline(std::cin, choice) || choice.empty()) {
+            return 0;
+        }
+        std::istringstream iss(choice);
+        size_t picked;
+        if (iss >> picked && picked >= 1 && picked <= count) {
+            return picked - 1;
+        }
+        std::cerr << TerminalBeautifier::red("Invalid candidate number.") << std::endl;
+    }
+}
+
+// Sends `messages` and, while the model answers with tool calls, runs all calls of a reply
+// concurrently and returns their results in a single follow-up request. Returns the final reply.
+std::optional<Message> sendWithTools(IAIModel* model, ToolExecutor& tools, std::vector<Message> messages, const GenerationParams& params, UsageReport& usage) {
+    for (size_t round = 0;; ++round) {
+        TurnTimer timer;
+        std::optional<Message> reply = model->sendMessage(messages, params);
+        if (!reply) {
+            return std::nullopt;
+        }
+        reportTurnUsage(model, timer.elapsed(), usage);
+        if (reply->tool_calls.empty()) {
+            return reply;
+        }
+        if (round >= tools.maxRounds()) {
+            std::cerr << TerminalBeautifier::red("Error: Gave up after " + std::to_string(round) + " rounds of tool calls without a final answer.") << std::endl;
+            return std::nullopt;
+        }
+        if (!reply->content.empty()) {
+            std::cout << TerminalBeautifier::bold(TerminalBeautifier::green("AI: ")) << reply->content << std::endl;
+        }
+        std::string names;
+        for (const auto& call : reply->tool_calls) {
+            names += (names.empty() ? "" : ", ") + call.name;
+        }
+        auto started = std::chrono::steady_clock::now();
+        std::vector<Message> results = tools.run(reply->tool_calls);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+        std::cout << TerminalBeautifier::yellow("[tools] " + names + " (" + std::to_string(results.size()) + " calls, " + std::to_string(elapsed.count()) + " ms)") << std::endl;
+        messages.push_back(std::move(*reply));
+        messages.insert(messages.end(), std::make_move_iterator(results.begin()), std::make_move_iterator(results.end()));
+    }
+}
+
+// Set by Ctrl-C while a reply is being generated (see sendInterruptible()).
+volatile std::sig_atomic_t g_reply_interrupted = 0;
+
+void onReplyInterrupt(int) {
+    g_reply_interrupted = 1;
+}
+
+// Streams a reply on a background thread while Ctrl-C cancels the request instead of ending the program.
+ReplySummary sendInterruptible(IAIModel* model, const std::vector<Message>& messages, const GenerationParams& params, IAIModel::DeltaCallback on_delta) {
+    auto previous_handler = std::signal(SIGINT, onReplyInterrupt);
+    ReplyHandle handle = model->sendMessageAsync(messages, params, std::move(on_delta));
+    while (!handle.waitFor(std::chrono::milliseconds(50))) {
+        if (g_reply_interrupted) {
+            handle.cancel();
+        }
+    }
+    std::signal(SIGINT, previous_handler);
+    return handle.wait();
+}
+
+// Reports a turn that produced no reply.
+void printRequestFailure() {
+    if (g_reply_interrupted) {
+        std::cerr << TerminalBeautifier::yellow("Reply cancelled.") << std::endl;
+    } else {
+        std::cerr << TerminalBeautifier::red("Failed to get a response from the AI. This might be due to network issues, invalid API key, or an issue with the AI service itself.") << std::endl;
+    }
+}
+
+// Streams a reply that must match params.json_schema, validating it while it arrives. A reply that
+// diverges from the schema is abandoned right there and requested again, up to `max_attempts` times.
+std::optional<Message> sendStructured(IAIModel* model, const std::vector<Message>& messages, const GenerationParams& params, size_t max_attempts, UsageReport& usage) {
+    for (size_t attempt = 1; attempt <= max_attempts; ++attempt) {
+        JsonSchemaValidator validator(params.json_schema);
+        size_t received = 0;
+        ReplySummary summary = sendInterruptible(model, messages, params, [&validator, &received](std::string_view delta) {
+            received += delta.size();
+            return validator.feed(delta);
+        });
+        if (summary.reply && validator.finish()) {
+            reportTurnUsage(model, summary.timing, usage);
+            return std::move(summary.reply);
+        }
+        if (summary.cancelled || validator.error().empty()) {
+            return std::nullopt; // The request itself failed or was cancelled
+        }
+        std::cerr << TerminalBeautifier::yellow("Warning: Attempt " + std::to_string(attempt) + "/" + std::to_string(max_attempts) +
+                                                " diverged from the JSON Schema after " + std::to_string(received) + " bytes (" +
+                                                validator.error() + ")" + (attempt < max_attempts ? "; retrying." : "."))
+                  << std::endl;
+    }
+    std::cerr << TerminalBeautifier::red("Error: No reply matched the JSON Schema after " + std::to_string(max_attempts) + " attempts.") << std::endl;
+    return std::nullopt;
+}
+
+// Streams a single reply, closing the request as soon as a client-side stop condition is met.
+std::optional<Message> sendUntilStop(IAIModel* model, const std::vector<Message>& messages, const GenerationParams& params, const StopCondition::Rules& rules, UsageReport& usage) {
+    StopCondition stop(rules);
+    IAIModel::DeltaCallback on_delta;
+    if (rules.active()) {
+        on_delta = [&stop](std::string_view delta) { return stop.feed(delta); };
+    }
+    // Streamed (where the provider supports it) to measure the time to the first token.
+    ReplySummary summary = sendInterruptible(model, messages, params, std::move(on_delta));
+    if (!summary.reply && stop.stopped()) {
+        std::cerr << TerminalBeautifier::yellow("Note: Stopped the reply early (" + stop.reason() + ").") << std::endl;
+        summary.reply = Message{"assistant", stop.text()};
+    }
+    if (!summary.reply) {
+        return std::nullopt;
+    }
+    reportTurnUsage(model, summary.timing, usage);
+    return std::move(summary.reply);
+}
+
+// Gets the reply (or, with several candidates requested, every candidate) for one user turn.
+std::optional<std::vector<Message>> requestReplies(IAIModel* model, ToolExecutor* tools, const std::vector<Message>& messages, const GenerationParams& params, const TurnOptions& turn, UsageReport& usage) {
+    g_reply_interrupted = 0;
+    if (!params.json_schema.is_null()) {
+        std::optional<Message> reply = sendStructured(model, messages, params, turn.structured_attempts, usage);
+        if (!reply) {
+            return std::nullopt;
+        }
+        return std::vector<Message>{std::move(*reply)};
+    }
+    if (tools) {
+        std::optional<Message> reply = sendWithTools(model, *tools, messages, params, usage);
+        if (!reply) {
+            return std::nullopt;
+        }
+        // Not streamed: stop conditions can only cut the final answer.
+        StopCondition::truncate(turn.stop, reply->content);
+        return std::vector<Message>{std::move(*reply)};
+    }
+    if (params.candidate_count.value_or(1) <= 1) {
+        std::optional<Message> reply = sendUntilStop(model, messages, params, turn.stop, usage);
+        if (!reply) {
+            return std::nullopt;
+        }
+        return std::vector<Message>{std::move(*reply)};
+    }
+    TurnTimer timer;
+    std::optional<std::vector<Message>> candidates = model->sendMessageCandidates(messages, params);
+    if (candidates) {
+        reportTurnUsage(model, timer.elapsed(), usage);
+        for (auto& candidate : *candidates) {
+            StopCondition::truncate(turn.stop, candidate.content);
+        }
+    }
+    return candidates;
+}
+
+// Opens the per-day usage ledger from the "usage_ledger" config section, or nullptr if it is disabled.
+std::unique_ptr<UsageLedger> createUsageLedger(const ConfigManager& config) {
+    if (!config.getBool("usage_ledger.enabled", true)) {
+        return nullptr;
+    }
+    std::string directory = config.getString("usage_ledger.dir");
+    return std::make_unique<UsageLedger>(directory.empty() ? UsageLedger::defaultDirectory() : std::filesystem::path(directory));
+}
+
 // Function to handle quick question mode
-void handleQuickQuestion(IAIModel* model, const std::string& prompt, const std::map<std::string, std::string>& model_params) {
+void handleQuickQuestion(IAIModel* model, ToolExecutor* tools, const std::string& prompt, const GenerationParams& model_params, const TurnOptions& turn, UsageReport& usage) {
     std::cout << TerminalBeautifier::bold(TerminalBeautifier::cyan("You: ")) << prompt << std::endl;
     if (!model) {
         std::cerr << TerminalBeautifier::red("Error: AI model not initialized. Cannot send message.") << std::endl;
         return;
     }
     std::vector<Message> messages = {{"user", prompt}};
-    std::optional<Message> reply = model->sendMessage(messages, model_params);
-    if (reply) {
-        std::cout << TerminalBeautifier::bold(TerminalBeautifier::green("AI: ")) << reply->content << std::endl;
+    std::optional<std::vector<Message>> candidates = requestReplies(model, tools, messages, model_params, turn, usage);
+    if (candidates) {
+        printCandidates(*candidates);
     } else {
-        std::cerr << TerminalBeautifier::red("Failed to get a response from the AI. This might be due to network issues, invalid API key, or an issue with the AI service itself.") << std::endl;
+        printRequestFailure();
+    }
+}
+
+// Saves the conversation and, if the model keeps provider-side state for it, that state alongside.
+void saveConversationWithState(HistoryManager& history_manager, IAIModel* model, const std::vector<Message>& conversation) {
+    std::string filename = history_manager.saveConversation(conversation);
+    if (!filename.empty() && model) {
+        nlohmann::json state = model->exportConversationState();
+        if (!state.is_null()) {
+            history_manager.saveConversationState(filename, state);
+        }
+    }
+}
+
+// Resets the model's per-conversation state after a history file was loaded and restores any saved state.
+void restoreConversationState(HistoryManager& history_manager, IAIModel* model, const std::string& filename) {
+    if (!model) {
+        return;
+    }
+    model->invalidateConversationCache();
+    if (std::optional<nlohmann::json> state = history_manager.loadConversationState(filename)) {
+        model->importConversationState(*state);
     }
 }
 
 // Function to handle interactive mode
-void handleInteractiveMode(IAIModel* model, HistoryManager& history_manager, const CommandLineArgs& args, const std::map<std::string, std::string>& initial_model_params) {
+void handleInteractiveMode(IAIModel* model, HistoryManager& history_manager, const CommandLineArgs& args, const GenerationParams& initial_model_params, const TurnOptions& turn, UsageReport& usage, ContextWindowManager& context_window, ConversationCompactor* compactor, ToolExecutor* tools) {
     std::vector<Message> conversation;
 
     if (!args.load_history_file.empty()) {
         std::optional<std::vector<Message>> loaded_conversation = history_manager.loadConversation(args.load_history_file);
         if (loaded_conversation) {
             conversation = *loaded_conversation;
+            context_window.invalidate();
+            if (compactor) {
+                compactor->cancel();
+            }
+            restoreConversationState(history_manager, model, args.load_history_file);
             std::cout << TerminalBeautifier::yellow("Loaded conversation from: ") << args.load_history_file << std::endl;
             for (const auto& msg : conversation) {
                 if (msg.role == "user") {
@@ -95,7 +648,7 @@ void handleInteractiveMode(IAIModel* model, HistoryManager& history_manager, con
             break;
         } else if (user_input == "save") {
             if (!conversation.empty()) {
-                history_manager.saveConversation(conversation);
+                saveConversationWithState(history_manager, model, conversation);
             } else {
                 std::cout << TerminalBeautifier::yellow("No conversation to save.") << std::endl;
             }
@@ -126,6 +679,18 @@ void handleInteractiveMode(IAIModel* model, HistoryManager& history_manager, con
                 }
             }
             continue;
+        } else if (user_input == "stats") {
+            if (usage.session.requests() == 0) {
+                std::cout << TerminalBeautifier::yellow("No requests sent yet.") << std::endl;
+            } else {
+                const std::optional<TokenUsage>& last_usage = usage.session.lastUsage();
+                const TurnTiming& last_timing = *usage.session.lastTiming();
+                std::string tokens = last_usage ? formatTokenUsage(*last_usage) : "tokens not reported by provider";
+                double tokens_per_second = last_usage ? last_timing.tokensPerSecond(last_usage->completion_tokens) : 0.0;
+                std::cout << TerminalBeautifier::yellow("[last] " + tokens + "; " + formatTiming(last_timing.first_token_seconds, tokens_per_second, last_timing.total_seconds)) << std::endl;
+                printSessionUsage(usage.session);
+            }
+            continue;
         } else if (user_input == "help") {
             std::cout << TerminalBeautifier::yellow("Available commands:") << std::endl;
             std::cout << TerminalBeautifier::yellow("  exit: Quit the interactive mode.") << std::endl;
@@ -134,6 +699,8 @@ void handleInteractiveMode(IAIModel* model, HistoryManager& history_manager, con
             std::cout << TerminalBeautifier::yellow("  show: Display the current conversation.") << std::endl;
             std::cout << TerminalBeautifier::yellow("  load <filename>: Load a conversation from a specified file.") << std::endl;
             std::cout << TerminalBeautifier::yellow("  modify <index> <new_content>: Modify a message at a specific index in the current conversation.") << std::endl;
+            std::cout << TerminalBeautifier::yellow("  cache <count>: Cache the first <count> messages provider-side and reuse them in later requests (0 to disable).") << std::endl;
+            std::cout << TerminalBeautifier::yellow("  stats: Show token usage and speed of the last request and of the session.") << std::endl;
             std::cout << TerminalBeautifier::yellow("  help: Display this help message.") << std::endl;
             continue;
         } else if (user_input.rfind("load ", 0) == 0) { // Starts with "load "
@@ -141,6 +708,11 @@ void handleInteractiveMode(IAIModel* model, HistoryManager& history_manager, con
             std::optional<std::vector<Message>> loaded_conv = history_manager.loadConversation(filename_to_load);
             if (loaded_conv) {
                 conversation = *loaded_conv;
+                context_window.invalidate();
+                if (compactor) {
+                    compactor->cancel();
+                }
+                restoreConversationState(history_manager, model, filename_to_load);
                 std::cout << TerminalBeautifier::yellow("Loaded conversation from: ") << filename_to_load << std::endl;
                 for (const auto& msg : conversation) {
                     if (msg.role == "user") {
@@ -153,6 +725,26 @@ void handleInteractiveMode(IAIModel* model, HistoryManager& history_manager, con
                 std::cerr << TerminalBeautifier::red("Failed to load conversation.") << std::endl;
             }
             continue;
+        } else if (user_input.rfind("cache ", 0) == 0) { // Starts with "cache "
+            std::istringstream iss(user_input.substr(6));
+            size_t prefix_count;
+            if (!(iss >> prefix_count) || prefix_count > conversation.size()) {
+                std::cerr << TerminalBeautifier::red("Invalid message count.") << std::endl;
+            } else if (!model || !model->setCachedPrefix(prefix_count)) {
+                std::cerr << TerminalBeautifier::red("The current AI model does not support explicit context caching.") << std::endl;
+            } else if (prefix_count == 0) {
+                context_window.setPinnedPrefix(0);
+                std::cout << TerminalBeautifier::yellow("Context caching disabled.") << std::endl;
+            } else {
+                // Keep the cached prefix in every request, even when older turns are trimmed.
+                context_window.setPinnedPrefix(prefix_count);
+                if (context_window.trimmedCount() > 0) {
+                    // Pinning brings trimmed messages back into the window right after the prefix.
+                    model->invalidateConversationCache(prefix_count);
+                }
+                std::cout << TerminalBeautifier::yellow("The first ") << prefix_count << TerminalBeautifier::yellow(" messages will be cached and reused by later requests.") << std::endl;
+            }
+            continue;
         } else if (user_input.rfind("modify ", 0) == 0) { // Starts with "modify "
             std::istringstream iss(user_input.substr(7));
             size_t index;
@@ -166,10 +758,20 @@ void handleInteractiveMode(IAIModel* model, HistoryManager& history_manager, con
             if (index < conversation.size()) {
                 // Modify in memory first
                 conversation[index].content = new_content_str;
+                if (model) {
+                    model->invalidateConversationCache(context_window.windowIndexOf(index));
+                }
+                context_window.invalidate(index);
+                if (compactor) {
+                    compactor->cancel(); // A running summary may include the old content
+                }
                 std::cout << TerminalBeautifier::yellow("Message at index ") << index << TerminalBeautifier::yellow(" modified in current session.") << std::endl;
                 // Persist changes to file if a history file was loaded
                 if (!args.load_history_file.empty()) {
-                    history_manager.modifyMessage(args.load_history_file, index, new_content_str);
+                    if (history_manager.modifyMessage(args.load_history_file, index, new_content_str) && model) {
+                        // Saved provider state past the edited message is stale now.
+                        history_manager.saveConversationState(args.load_history_file, model->exportConversationState());
+                    }
                 }
             } else {
                 std::cerr << TerminalBeautifier::red("Invalid message index.") << std::endl;
@@ -179,13 +781,36 @@ void handleInteractiveMode(IAIModel* model, HistoryManager& history_manager, con
 
         // Only attempt to send message to AI if model is initialized
         if (model) {
+            size_t newly_summarized = compactor ? compactor->installFinished(context_window) : 0;
+            if (newly_summarized > 0) {
+                std::cout << TerminalBeautifier::yellow("[compaction] ") << newly_summarized
+                          << TerminalBeautifier::yellow(" earlier messages are now sent as a summary (the history file keeps them in full).") << std::endl;
+            }
             conversation.push_back({"user", user_input});
-            std::optional<Message> reply = model->sendMessage(conversation, initial_model_params);
-            if (reply) {
-                std::cout << TerminalBeautifier::bold(TerminalBeautifier::green("AI: ")) << reply->content << std::endl;
-                conversation.push_back(*reply);
+            // Only the part of the conversation that fits the token budget is sent.
+            const std::vector<Message>& request_messages = context_window.select(conversation);
+            if (context_window.windowMoved()) {
+                model->invalidateConversationCache(context_window.firstChangedIndex());
+                // A new summary moves the window too; the [compaction] note above already covers it.
+                if (newly_summarized == 0) {
+                    std::cout << TerminalBeautifier::yellow("[context] ") << context_window.trimmedCount()
+                              << TerminalBeautifier::yellow(" older messages are no longer sent to stay within ") << context_window.budget()
+                              << TerminalBeautifier::yellow(" tokens.") << std::endl;
+                }
+            }
+            // Tool calls and their results stay within this turn; only the final reply is kept.
+            std::optional<std::vector<Message>> candidates = requestReplies(model, tools, request_messages, initial_model_params, turn, usage);
+            if (candidates) {
+                printCandidates(*candidates);
+                // Only the chosen candidate becomes part of the conversation.
+                size_t picked = pickCandidate(candidates->size());
+                conversation.push_back(std::move((*candidates)[picked]));
+                if (compactor) {
+                    // Summarize while the user reads the reply and types the next message.
+                    compactor->maybeStart(conversation, context_window);
+                }
             } else {
-                std::cerr << TerminalBeautifier::red("Failed to get a response from the AI. This might be due to network issues, invalid API key, or an issue with the AI service itself.") << std::endl;
+                printRequestFailure();
                 conversation.pop_back(); // Remove user message if AI failed to respond
             }
         } else {
@@ -194,19 +819,147 @@ void handleInteractiveMode(IAIModel* model, HistoryManager& history_manager, con
         }
     }
 
+    if (args.show_stats && usage.session.requests() > 0) {
+        printSessionUsage(usage.session);
+    }
+
+    if (compactor && compactor->running()) {
+        std::cout << TerminalBeautifier::yellow("Discarding the unfinished background compaction (exiting once its request returns)...") << std::endl;
+        compactor->cancel();
+    }
+
     if (!conversation.empty() && args.save_history_file.empty()) {
         // Auto-save if not manually saved and conversation exists
-        history_manager.saveConversation(conversation);
+        saveConversationWithState(history_manager, model, conversation);
     } else if (!conversation.empty() && !args.save_history_file.empty()) {
         // If a specific save file was requested, save to that file
-        history_manager.saveConversation(conversation);
+        saveConversationWithState(history_manager, model, conversation);
+    }
+}
+
+// Builds the generation parameters for `model_type` from its "model_params" config and --param overrides.
+// Returns empty after reporting an invalid parameter.
+std::optional<GenerationParams> buildModelParams(const ConfigManager& config, const std::string& model_type, const std::vector<std::string>& overrides) {
+    std::string param_error;
+    std::optional<GenerationParams> model_params = GenerationParams::fromJson(config.getModelParams(model_type), param_error);
+    if (!model_params) {
+        std::cerr << TerminalBeautifier::red("Error: Invalid model_params in config.json: ") << param_error << std::endl;
+        return std::nullopt;
     }
+    for (const auto& param_str : overrides) {
+        size_t eq_pos = param_str.find("=");
+        if (eq_pos != std::string::npos) {
+            std::string key = param_str.substr(0, eq_pos);
+            std::string value = param_str.substr(eq_pos + 1);
+            if (!model_params->setFromString(key, value, param_error)) {
+                std::cerr << TerminalBeautifier::red("Error: Invalid model parameter: ") << param_error << std::endl;
+                return std::nullopt;
+            }
+        } else {
+            std::cerr << TerminalBeautifier::yellow("Warning: Invalid model parameter format: ") << param_str << ". Expected key=value." << std::endl;
+        }
+    }
+    return model_params;
+}
+
+// Runs "haicl bench-models": every prompt against every target, printing a comparison table and/or a JSON report.
+int runBenchModels(const ConfigManager& config, const CommandLineArgs& args) {
+    std::vector<ModelBenchmark::Target> targets;
+    for (const auto& spec : args.bench_targets) {
+        std::optional<ModelBenchmark::Target> target = ModelBenchmark::parseTarget(spec);
+        if (!target) {
+            std::cerr << TerminalBeautifier::red("Error: Invalid --target '" + spec + "'. Expected provider/model, e.g. openai/gpt-4o-mini.") << std::endl;
+            return 1;
+        }
+        std::optional<GenerationParams> params = buildModelParams(config, target->provider, args.model_params);
+        if (!params) {
+            return 1;
+        }
+        // One reply per request, and no schema: the comparison is about plain generation speed.
+        target->params = *params;
+        target->params.candidate_count.reset();
+        target->params.json_schema = nullptr;
+        targets.push_back(std::move(*target));
+    }
+
+    std::vector<std::string> prompts;
+    if (args.bench_prompts_file.empty()) {
+        prompts = ModelBenchmark::defaultPrompts();
+    } else {
+        std::ifstream prompts_file(args.bench_prompts_file);
+        std::string line;
+        while (std::getline(prompts_file, line)) {
+            if (!line.empty()) {
+                prompts.push_back(line);
+            }
+        }
+        if (prompts.empty()) {
+            std::cerr << TerminalBeautifier::red("Error: " + args.bench_prompts_file + " contains no prompts.") << std::endl;
+            return 1;
+        }
+    }
+
+    size_t runs = static_cast<size_t>(args.bench_runs);
+    size_t concurrency = static_cast<size_t>(args.bench_concurrency);
+    std::cerr << TerminalBeautifier::yellow("Sending " + std::to_string(prompts.size() * runs) + " requests to each of " + std::to_string(targets.size()) +
+                                            " target(s), " + std::to_string(concurrency) + " at a time per target...")
+              << std::endl;
+    // Responses are not cached here: every request must reach the provider to be measured.
+    std::optional<std::vector<ModelBenchmark::Result>> results = ModelBenchmark::run(targets, prompts, runs, concurrency, [&config](const ModelBenchmark::Target& target) {
+        return getAIModel(config, target.provider, target.model);
+    });
+    if (!results) {
+        return 1;
+    }
+
+    if (std::unique_ptr<UsageLedger> ledger = createUsageLedger(config)) {
+        for (const auto& result : *results) {
+            for (const auto& sample : result.samples) {
+                if (sample.ok) {
+                    ledger->record(result.target.provider, result.model_name, sample.usage, sample.timing);
+                }
+            }
+        }
+    }
+
+    nlohmann::ordered_json report = ModelBenchmark::toJson(*results, prompts.size(), runs, concurrency);
+    if (args.bench_report_file == "-") {
+        std::cout << report.dump(2) << std::endl;
+        return 0;
+    }
+    std::cout << ModelBenchmark::formatTable(*results);
+    if (!args.bench_report_file.empty()) {
+        std::ofstream report_file(args.bench_report_file);
+        if (!(report_file << report.dump(2) << std::endl)) {
+            std::cerr << TerminalBeautifier::red("Error: Could not write the report to " + args.bench_report_file) << std::endl;
+            return 1;
+        }
+        std::cout << "Report written to " << args.bench_report_file << std::endl;
+    }
+    return 0;
 }
 
 int main(int argc, char** argv) {
     ConfigManager config;
     config.loadConfig(); // Load default config.json and environment variables
 
+    CLIParser parser(argc, argv);
+    if (!parser.parse()) {
+        return 1; // Error or help requested
+    }
+
+    const CommandLineArgs& args = parser.getArgs();
+
+    // Commands whose stdout is data (a JSON report, a token count) run before the configuration dump.
+    if (args.bench_models) {
+        return runBenchModels(config, args);
+    }
+    std::shared_ptr<BpeTokenizer> tokenizer = loadTokenizer(config, args.tokenizer_file);
+    if (args.count_tokens) {
+        handleCountTokens(args.prompt, tokenizer);
+        return 0;
+    }
+
     // Debugging: Print loaded configuration
     std::cout << TerminalBeautifier::yellow("--- Loaded Configuration ---") << std::endl;
     std::cout << "Default AI Model: " << config.getString("default_ai_model", "N/A") << std::endl;
@@ -218,29 +971,80 @@ int main(int argc, char** argv) {
     std::cout << "Google Model Name: " << config.getString("google.model_name", "N/A") << std::endl;
     std::cout << TerminalBeautifier::yellow("--------------------------") << std::endl;
 
-    CLIParser parser(argc, argv);
-    if (!parser.parse()) {
-        return 1; // Error or help requested
+    // Determine model parameters, command line args override config.
+    // Everything is parsed and validated once here; providers only map the typed values.
+    std::string param_error;
+    std::string params_model_type = args.model_type.empty() ? config.getString("default_ai_model", "openai") : args.model_type;
+    std::optional<GenerationParams> parsed_params = buildModelParams(config, params_model_type, args.model_params);
+    if (!parsed_params) {
+        return 1;
     }
-
-    const CommandLineArgs& args = parser.getArgs();
-
-    // Determine model parameters, command line args override config
-    std::map<std::string, std::string> model_params = config.getModelParams(args.model_type.empty() ? config.getString("default_ai_model", "openai") : args.model_type);
-    for (const auto& param_str : args.model_params) {
-        size_t eq_pos = param_str.find("=");
-        if (eq_pos != std::string::npos) {
-            std::string key = param_str.substr(0, eq_pos);
-            std::string value = param_str.substr(eq_pos + 1);
-            model_params[key] = value;
-        } else {
-            std::cerr << TerminalBeautifier::yellow("Warning: Invalid model parameter format: ") << param_str << ". Expected key=value." << std::endl;
+    GenerationParams model_params = *parsed_params;
+    if (args.candidates > 0) {
+        model_params.candidate_count = args.candidates;
+    }
+    if (!args.json_schema_file.empty()) {
+        std::ifstream schema_file(args.json_schema_file);
+        nlohmann::json schema = nlohmann::json::parse(schema_file, nullptr, false);
+        if (schema.is_discarded() || !model_params.set("json_schema", schema, param_error)) {
+            std::cerr << TerminalBeautifier::red("Error: " + args.json_schema_file + " does not contain a JSON Schema object.") << std::endl;
+            return 1;
+        }
+    }
+    TurnOptions turn;
+    int max_attempts = config.getInt("structured_output.max_attempts", 3);
+    turn.structured_attempts = max_attempts > 0 ? static_cast<size_t>(max_attempts) : 1;
+    // --stop is also sent to the provider; enforcing it client-side covers APIs without a native stop.
+    model_params.stop.insert(model_params.stop.end(), args.stop_strings.begin(), args.stop_strings.end());
+    turn.stop.stop_strings = model_params.stop;
+    if (!args.stop_regex.empty()) {
+        try {
+            turn.stop.stop_regex.emplace(args.stop_regex);
+        } catch (const std::regex_error& e) {
+            std::cerr << TerminalBeautifier::red("Error: Invalid --stop-regex: " + std::string(e.what())) << std::endl;
+            return 1;
         }
     }
+    turn.stop.max_chars = args.max_chars > 0 ? static_cast<size_t>(args.max_chars) : 0;
+    turn.stop.first_code_block = args.first_code_block;
 
-    std::unique_ptr<IAIModel> ai_model = getAIModel(config, args.model_type, args.model_name);
+    std::unique_ptr<IAIModel> ai_model = getAIModel(config, args.model_type, args.model_name, tokenizer);
+    // A router resumes within each of its routes (see createRouterModel()).
+    if (ai_model && ai_model->providerName() != "router") {
+        ai_model = withStreamResume(config, std::move(ai_model));
+    }
+    std::shared_ptr<ResponseCache> response_cache = ai_model ? createResponseCache(config, args) : nullptr;
+    std::shared_ptr<SemanticCache> semantic_cache = ai_model ? createSemanticCache(config, args) : nullptr;
+    if (response_cache || semantic_cache) {
+        ai_model = std::make_unique<CachingModel>(std::move(ai_model), response_cache, args.refresh_cache,
+                                                  config.getBool("response_cache.deterministic_only", true), semantic_cache);
+    }
+
+    std::unique_ptr<ToolExecutor> tool_executor = ai_model ? createToolExecutor(config, args) : nullptr;
+    if (tool_executor && !ai_model->setTools(tool_executor->definitions())) {
+        std::cerr << TerminalBeautifier::yellow("Warning: The selected model (" + ai_model->providerName() + "/" + ai_model->modelName() +
+                                                ") does not support tool calling; tools are disabled.") << std::endl;
+        tool_executor.reset();
+    }
+    if (tool_executor && !model_params.json_schema.is_null()) {
+        std::cerr << TerminalBeautifier::yellow("Warning: Tools are not supported together with a JSON Schema for the reply; tools are disabled.") << std::endl;
+        ai_model->setTools({});
+        tool_executor.reset();
+    }
+    if (!model_params.json_schema.is_null() && model_params.candidate_count.value_or(1) > 1) {
+        std::cerr << TerminalBeautifier::yellow("Warning: Multiple candidates are not supported together with a JSON Schema; requesting one reply.") << std::endl;
+        model_params.candidate_count.reset();
+    }
+    if (tool_executor && model_params.candidate_count.value_or(1) > 1) {
+        std::cerr << TerminalBeautifier::yellow("Warning: Multiple candidates are not supported together with tools; requesting one reply.") << std::endl;
+        model_params.candidate_count.reset();
+    }
 
     HistoryManager history_manager;
+    std::unique_ptr<UsageLedger> usage_ledger = ai_model ? createUsageLedger(config) : nullptr;
+    UsageReport usage;
+    usage.ledger = usage_ledger.get();
+    usage.show = args.show_stats;
 
     if (!args.prompt.empty()) {
         // Quick question mode
@@ -248,10 +1052,21 @@ int main(int argc, char** argv) {
             std::cerr << TerminalBeautifier::red("Error: Cannot use quick question mode without an initialized AI model. Please ensure you have set a valid API key (e.g., OPENAI_API_KEY) and selected a supported model type (e.g., -t openai).") << std::endl;
             return 1;
         }
-        handleQuickQuestion(ai_model.get(), args.prompt, model_params);
+        handleQuickQuestion(ai_model.get(), tool_executor.get(), args.prompt, model_params, turn, usage);
+        if (args.show_stats && (response_cache || semantic_cache)) {
+            printCacheStats(response_cache.get(), semantic_cache.get());
+        }
     } else if (args.interactive_mode || !args.load_history_file.empty()) {
         // Interactive mode or load history to continue
-        handleInteractiveMode(ai_model.get(), history_manager, args, model_params);
+        ContextWindowManager context_window = createContextWindow(config, ai_model.get(), model_params);
+        if (tokenizer) {
+            context_window.setTokenCounter([tokenizer](const std::string& text) { return tokenizer->count(text); });
+        }
+        std::unique_ptr<ConversationCompactor> compactor = ai_model ? createCompactor(config, args, model_params, context_window) : nullptr;
+        handleInteractiveMode(ai_model.get(), history_manager, args, model_params, turn, usage, context_window, compactor.get(), tool_executor.get());
+        if (args.show_stats && (response_cache || semantic_cache)) {
+            printCacheStats(response_cache.get(), semantic_cache.get());
+        }
     } else {
         std::cout << TerminalBeautifier::yellow("No prompt or interactive mode specified. Use -h for help.") << std::endl;
     }
@@ -0,0 +1,52 @@
+"""bench-models and --count-tokens against a stand-in OpenAI server: stdout carries only their data.
+
+Usage: bench_models_test.py <path to haicl>
+"""
+
+import json
+import sys
+import unittest
+
+from stand_in import Haicl, StandIn, openai_completion, openai_stream
+
+
+def openai_app(handler, request):
+    body = request.json()
+    text = "Stand-in reply number one."
+    if body.get("stream"):
+        handler.send_chunks(openai_stream(text))
+    else:
+        handler.send_json(openai_completion(text))
+
+
+class BenchModelsTest(unittest.TestCase):
+    def setUp(self):
+        self.server = StandIn(openai_app).__enter__()
+        self.addCleanup(self.server.__exit__)
+        config = {
+            "default_ai_model": "openai",
+            "openai": {"api_key": "sk-secret-test-key", "base_url": self.server.url + "/v1", "model_name": "gpt-4o-mini"},
+            "response_cache": {"enabled": False},
+            "usage_ledger": {"enabled": False},
+        }
+        self.haicl = Haicl(BINARY, config)
+        self.addCleanup(self.haicl.__exit__)
+
+    def test_report_to_stdout_is_json(self):
+        result = self.haicl.run("bench-models", "--target", "openai/gpt-4o-mini", "--runs", "1", "--report", "-")
+        self.assertEqual(result.returncode, 0, result.stderr)
+        report = json.loads(result.stdout)
+        self.assertNotIn("sk-secret-test-key", result.stdout)
+        self.assertTrue(report)
+        self.assertTrue(self.server.requests("/v1/chat/completions"))
+
+    def test_count_tokens_prints_only_the_count(self):
+        result = self.haicl.run("--count-tokens", "-p", "one two three four")
+        self.assertEqual(result.returncode, 0, result.stderr)
+        self.assertRegex(result.stdout.strip(), r"^\d+")
+        self.assertNotIn("sk-secret-test-key", result.stdout)
+
+
+if __name__ == "__main__":
+    BINARY = sys.argv[1]
+    unittest.main(argv=sys.argv[:1])
@@ -0,0 +1,104 @@
+"""Gemini context caching against a stand-in server: tools inside the cache, rejected and evicted caches.
+
+Usage: google_context_cache_test.py <path to haicl>
+"""
+
+import sys
+import unittest
+
+from stand_in import Haicl, StandIn, sse_event
+
+MODEL = "gemini-1.5-flash-001"
+
+
+class GeminiApp:
+    """generateContent, streamGenerateContent and cachedContents. `cached_status` answers every request
+    that uses a cache with that error status instead (like Gemini does for tools next to a cache)."""
+
+    def __init__(self, cached_status=None):
+        self.cached_status = cached_status
+        self.caches = 0
+
+    def __call__(self, handler, request):
+        path = request.path.split("?")[0]
+        if path == "/v1beta/cachedContents" and request.method == "POST":
+            self.caches += 1
+            handler.send_json({"name": "cachedContents/c%d" % self.caches, "model": "models/" + MODEL})
+        elif path.startswith("/v1beta/cachedContents/") and request.method == "DELETE":
+            handler.send_json({})
+        elif path.endswith(":generateContent") or path.endswith(":streamGenerateContent"):
+            body = request.json()
+            if "cachedContent" in body and ("tools" in body or self.cached_status):
+                status = self.cached_status or 400
+                handler.send_json({"error": {"code": status, "message": "rejected by the stand-in"}}, status)
+                return
+            last = body["contents"][-1]["parts"][0]["text"]
+            reply = {"candidates": [{"content": {"role": "model", "parts": [{"text": "Gemini says: " + last}]}, "finishReason": "STOP"}],
+                     "usageMetadata": {"promptTokenCount": 10, "candidatesTokenCount": 3}}
+            if path.endswith(":streamGenerateContent"):
+                handler.send_chunks([sse_event(reply)])
+            else:
+                handler.send_json(reply)
+        else:
+            handler.send_json({"error": {"message": "not found"}}, 404)
+
+
+class GoogleContextCacheTest(unittest.TestCase):
+    def start(self, app, tools=False):
+        self.app = app
+        self.server = StandIn(app).__enter__()
+        self.addCleanup(self.server.__exit__)
+        config = {
+            "default_ai_model": "google",
+            "google": {"api_key": "test", "base_url": self.server.url, "model_name": MODEL,
+                       "context_cache": {"prefix_messages": 1}},
+            "response_cache": {"enabled": False},
+            "usage_ledger": {"enabled": False},
+        }
+        if tools:
+            config["tools"] = {"enabled": True, "definitions": [{"name": "clock", "description": "Current time",
+                                                                 "parameters": {"type": "object", "properties": {}}, "command": "date"}]}
+        self.haicl = Haicl(BINARY, config)
+        self.addCleanup(self.haicl.__exit__)
+
+    def chat(self, *prompts):
+        result = self.haicl.run("-i", stdin="\n".join(prompts) + "\nexit\n")
+        self.assertEqual(result.returncode, 0, result.stderr)
+        for prompt in prompts:
+            self.assertIn("Gemini says: " + prompt, result.stdout)
+        return result
+
+    def requests(self, method, marker):
+        return [r for r in self.server.requests() if r.method == method and marker in r.path]
+
+    def test_tools_are_declared_in_the_cache(self):
+        self.start(GeminiApp(), tools=True)
+        result = self.chat("first", "second")
+        self.assertNotIn("cached context failed", result.stderr)
+        (create,) = self.requests("POST", "/cachedContents")
+        self.assertEqual(create.json()["tools"][0]["functionDeclarations"][0]["name"], "clock")
+        first, cached = [r.json() for r in self.requests("POST", ":generateContent")]
+        self.assertIn("tools", first)
+        self.assertEqual(cached["cachedContent"], "cachedContents/c1")
+        self.assertNotIn("tools", cached)
+
+    def test_rejected_cache_is_deleted_and_not_recreated(self):
+        self.start(GeminiApp(cached_status=400))
+        result = self.chat("first", "second", "third")
+        self.assertIn("cached context failed", result.stderr)
+        # Created once, deleted after the rejection instead of being left to its TTL, never retried.
+        self.assertEqual(len(self.requests("POST", "/cachedContents")), 1)
+        self.assertEqual(len(self.requests("DELETE", "/cachedContents/c1")), 1)
+        self.assertEqual(len(self.requests("POST", ":streamGenerateContent")), 4)
+
+    def test_evicted_cache_is_recreated(self):
+        self.start(GeminiApp(cached_status=404))
+        self.chat("first", "second", "third")
+        # Gone server-side: nothing to delete, and the next turn caches the prefix again.
+        self.assertEqual(len(self.requests("POST", "/cachedContents")), 2)
+        self.assertEqual(self.requests("DELETE", "/cachedContents"), [])
+
+
+if __name__ == "__main__":
+    BINARY = sys.argv[1]
+    unittest.main(argv=sys.argv[:1])
@@ -0,0 +1,128 @@
+"""Local models against stand-in Ollama and llama.cpp servers: streaming, keep_alive, num_ctx, num_predict.
+
+Usage: local_model_test.py <path to haicl>
+"""
+
+import json
+import sys
+import unittest
+
+from stand_in import Haicl, StandIn, openai_stream
+
+REPLY = "Hello from the stand-in server, one small piece at a time."
+
+
+def ollama_lines(text, piece_size=6, done=True):
+    lines = [json.dumps({"model": "llama3.2", "message": {"role": "assistant", "content": text[i:i + piece_size]}, "done": False}) + "\n"
+             for i in range(0, len(text), piece_size)]
+    if done:
+        lines.append(json.dumps({"model": "llama3.2", "message": {"role": "assistant", "content": ""}, "done": True,
+                                 "prompt_eval_count": 12, "eval_count": len(lines)}) + "\n")
+    # Split every line across two chunks so the client has to reassemble them.
+    chunks = []
+    for line in lines:
+        chunks += [line[:9].encode(), line[9:].encode()]
+    return chunks
+
+
+def local_app(handler, request):
+    body = request.json()
+    last = body["messages"][-1]
+    if request.path == "/api/chat":
+        if last["role"] == "assistant" and "ALWAYS" in body["messages"][-2]["content"]:
+            # The continuation breaks off again.
+            handler.send_chunks(ollama_lines(REPLY[len(last["content"]):], done=False)[:4], "application/x-ndjson")
+        elif last["role"] == "assistant":
+            # Prefill: continue the partial reply the client sent back.
+            handler.send_chunks(ollama_lines(REPLY[len(last["content"]):]), "application/x-ndjson")
+        elif "CUT" in last["content"]:
+            handler.send_chunks(ollama_lines(REPLY, done=False)[:8], "application/x-ndjson")
+        else:
+            handler.send_chunks(ollama_lines(REPLY), "application/x-ndjson")
+    elif request.path == "/v1/chat/completions":
+        handler.send_chunks(openai_stream(REPLY, usage={"prompt_tokens": 12, "completion_tokens": 11}))
+    else:
+        handler.send_json({"error": "not found"}, 404)
+
+
+class LocalModelTest(unittest.TestCase):
+    def setUp(self):
+        self.server = StandIn(local_app).__enter__()
+        self.addCleanup(self.server.__exit__)
+
+    def haicl(self, **local):
+        local.setdefault("base_url", self.server.url)
+        config = {
+            "default_ai_model": "local",
+            "local": local,
+            "response_cache": {"enabled": False},
+            "usage_ledger": {"enabled": False},
+        }
+        haicl = Haicl(BINARY, config)
+        self.addCleanup(haicl.__exit__)
+        return haicl
+
+    def ask(self, haicl, *args):
+        result = haicl.run(*args)
+        self.assertEqual(result.returncode, 0, result.stderr)
+        self.assertIn(REPLY, result.stdout)
+        return result
+
+    def chat_bodies(self, path):
+        return [r.json() for r in self.server.requests(path)]
+
+    def test_ollama_streaming_and_options(self):
+        haicl = self.haicl(api="ollama", keep_alive="10m", num_ctx=8192)
+        result = self.ask(haicl, "-p", "hi", "--param", "max_tokens=64", "--stats")
+        self.assertIn("prompt 12 tokens", result.stdout)
+        (body,) = self.chat_bodies("/api/chat")
+        self.assertTrue(body["stream"])
+        self.assertEqual(body["keep_alive"], "10m")
+        self.assertEqual(body["options"]["num_ctx"], 8192)
+        self.assertEqual(body["options"]["num_predict"], 64)
+        self.assertNotIn("max_tokens", body["options"])
+
+    def test_ollama_keep_alive(self):
+        self.ask(self.haicl(api="ollama"), "-p", "hi")
+        self.ask(self.haicl(api="ollama", keep_alive="-1"), "-p", "hi")
+        self.ask(self.haicl(api="ollama", keep_alive="300"), "-p", "hi")
+        bodies = self.chat_bodies("/api/chat")
+        # Default, "until the server stops" and seconds: durations stay strings, numbers are sent as numbers.
+        self.assertEqual([b["keep_alive"] for b in bodies], ["30m", -1, 300])
+        self.assertTrue(all("options" not in b or "num_ctx" not in b["options"] for b in bodies))
+
+    def test_ollama_resumes_cut_stream(self):
+        result = self.ask(self.haicl(api="ollama"), "-p", "CUT")
+        self.assertIn("requesting the rest", result.stderr)
+        first, resumed = self.chat_bodies("/api/chat")
+        self.assertEqual(resumed["messages"][-1]["role"], "assistant")
+        self.assertTrue(REPLY.startswith(resumed["messages"][-1]["content"]))
+        self.assertEqual(result.stdout.count(REPLY), 1)
+
+    def test_ollama_keeps_partial_reply_when_resumes_run_out(self):
+        result = self.haicl(api="ollama").run("-i", stdin="CUT ALWAYS\nnext\nexit\n")
+        self.assertEqual(result.returncode, 0, result.stderr)
+        self.assertIn("still incomplete after 2 continuation requests", result.stderr)
+        *attempts, follow_up = self.chat_bodies("/api/chat")
+        self.assertEqual(len(attempts), 3)
+        # The partial reply stays in the conversation and is sent with the next turn.
+        self.assertEqual([m["role"] for m in follow_up["messages"]], ["user", "assistant", "user"])
+        partial = follow_up["messages"][1]["content"]
+        self.assertTrue(partial and REPLY.startswith(partial) and partial != REPLY)
+
+    def test_llamacpp_streaming_and_options(self):
+        haicl = self.haicl(api="llamacpp", num_ctx=4096)
+        result = self.ask(haicl, "-p", "hi", "--param", "max_tokens=32", "--stats")
+        self.assertIn("completion 11 tokens", result.stdout)
+        (body,) = self.chat_bodies("/v1/chat/completions")
+        self.assertTrue(body["stream"])
+        self.assertTrue(body["cache_prompt"])
+        self.assertEqual(body["n_predict"], 32)
+        # The context size is fixed when llama-server starts (-c); it is never sent.
+        self.assertNotIn("num_ctx", body)
+        self.assertNotIn("keep_alive", body)
+
+
+if __name__ == "__main__":
+    BINARY = sys.argv[1]
+    unittest.main(argv=sys.argv[:1])
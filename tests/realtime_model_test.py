@@ -0,0 +1,141 @@
+"""The Realtime model against a stand-in WebSocket server: handshake, masking, fragmentation, ping/pong
+and reconnecting with the conversation replayed after a dropped connection.
+
+Usage: realtime_model_test.py <path to haicl>
+"""
+
+import json
+import sys
+import unittest
+
+from stand_in import OP_CONTINUATION, OP_PING, OP_TEXT, Haicl, WebSocketStandIn
+
+CONTINUE_PROMPT = "Your previous reply was cut off."
+
+
+def item_text(item):
+    return item["content"][0]["text"]
+
+
+def reply_for(items):
+    """Echoes the last user message; after a cut-off reply, sends the rest of the one that was cut."""
+    last = items[-1]
+    if last["role"] == "user" and item_text(last).startswith(CONTINUE_PROMPT):
+        partial = item_text(items[-2])
+        return "Echo: " + item_text(items[-3]), len(partial)
+    return "Echo: " + item_text(last), 0
+
+
+def realtime_open(connection):
+    connection.items = []
+    connection.send_json({"type": "session.created", "session": {"id": "sess_stand_in"}})
+
+
+def realtime_app(connection, message):
+    event = json.loads(message)
+    if event["type"] == "session.update":
+        connection.send_json({"type": "session.updated", "session": event["session"]})
+    elif event["type"] == "conversation.item.create":
+        connection.items.append(event["item"])
+        connection.send_json({"type": "conversation.item.created", "item": event["item"]})
+    elif event["type"] == "conversation.item.delete":
+        connection.items = [i for i in connection.items if i["id"] != event["item_id"]]
+        connection.send_json({"type": "conversation.item.deleted", "item_id": event["item_id"]})
+    elif event["type"] == "response.create":
+        respond(connection)
+
+
+def respond(connection):
+    text, start = reply_for(connection.items)
+    prompt = item_text(connection.items[-1])
+    connection.send_json({"type": "response.created", "response": {"id": "resp_1", "status": "in_progress"}})
+    connection.send_json({"type": "response.output_item.added", "item": {"id": "item_reply", "type": "message", "role": "assistant"}})
+    if "PING" in prompt:
+        connection.send_frame(OP_PING, b"are you there")
+    pieces = [text[i:i + 6] for i in range(start, len(text), 6)]
+    for n, piece in enumerate(pieces):
+        delta = json.dumps({"type": "response.text.delta", "delta": piece}).encode()
+        if "FRAG" in prompt and n == 1:
+            # One message in three frames, with a control frame between the fragments.
+            connection.send_frame(OP_TEXT, delta[:10], fin=False)
+            connection.send_frame(OP_PING, b"mid-message")
+            connection.send_frame(OP_CONTINUATION, delta[10:20], fin=False)
+            connection.send_frame(OP_CONTINUATION, delta[20:])
+        else:
+            connection.send_frame(OP_TEXT, delta)
+        if "DROP" in prompt and n == 2:
+            connection.drop()
+            return
+    connection.items.append({"id": "item_reply", "role": "assistant", "content": [{"type": "text", "text": text[start:]}]})
+    connection.send_json({"type": "response.done", "response": {"id": "resp_1", "status": "completed",
+                          "usage": {"input_tokens": 20, "output_tokens": len(pieces), "input_token_details": {"cached_tokens": 0}}}})
+
+
+class RealtimeModelTest(unittest.TestCase):
+    def server(self, **options):
+        server = WebSocketStandIn(realtime_app, realtime_open, **options).__enter__()
+        self.addCleanup(server.__exit__)
+        return server
+
+    def haicl(self, server):
+        config = {
+            "default_ai_model": "realtime",
+            "realtime": {"api_key": "rt-test-key", "base_url": server.url + "/v1/realtime", "model_name": "gpt-4o-realtime-preview"},
+            "response_cache": {"enabled": False},
+            "usage_ledger": {"enabled": False},
+        }
+        haicl = Haicl(BINARY, config)
+        self.addCleanup(haicl.__exit__)
+        return haicl
+
+    def ask(self, server, prompt, *args):
+        result = self.haicl(server).run("-p", prompt, *args)
+        self.assertEqual(result.returncode, 0, result.stderr)
+        self.assertIn("Echo: " + prompt, result.stdout)
+        for connection in server.connections():
+            self.assertTrue(connection.closed.wait(10))
+            self.assertEqual(connection.unmasked_frames, 0)
+        return result
+
+    def test_handshake_and_masking(self):
+        server = self.server()
+        self.ask(server, "Hello over a socket")
+        (connection,) = server.connections()
+        self.assertEqual(connection.request_line, "GET /v1/realtime?model=gpt-4o-realtime-preview HTTP/1.1")
+        self.assertEqual(connection.headers["upgrade"], "websocket")
+        self.assertEqual(connection.headers["sec-websocket-version"], "13")
+        self.assertEqual(connection.headers["authorization"], "Bearer rt-test-key")
+        self.assertEqual(connection.headers["openai-beta"], "realtime=v1")
+        types = [json.loads(m)["type"] for m in connection.messages]
+        self.assertEqual(types, ["session.update", "conversation.item.create", "response.create"])
+
+    def test_rejects_wrong_accept_key(self):
+        server = self.server(accept_key="d3JvbmcgYWNjZXB0IGtleQ==")
+        result = self.haicl(server).run("-p", "hello")
+        self.assertIn("invalid Sec-WebSocket-Accept", result.stderr)
+        self.assertNotIn("Echo:", result.stdout)
+
+    def test_fragmented_message_and_ping(self):
+        server = self.server()
+        self.ask(server, "FRAG and PING in one reply")
+        (connection,) = server.connections()
+        # Both pings were answered with their payloads, the one between the fragments included.
+        self.assertEqual(connection.pongs, [b"are you there", b"mid-message"])
+
+    def test_reconnects_and_replays_after_drop(self):
+        server = self.server()
+        result = self.ask(server, "DROP the connection mid-reply")
+        self.assertIn("requesting the rest", result.stderr)
+        self.assertEqual(result.stdout.count("Echo: DROP the connection mid-reply"), 1)
+        first, second = server.connections()
+        # The new session gets the whole conversation again, then the partial reply to continue.
+        replayed = [json.loads(m)["item"] for m in second.messages if json.loads(m)["type"] == "conversation.item.create"]
+        self.assertEqual([i["role"] for i in replayed], ["user", "assistant", "user"])
+        self.assertEqual(item_text(replayed[0]), "DROP the connection mid-reply")
+        self.assertTrue("Echo: DROP the connection mid-reply".startswith(item_text(replayed[1])))
+        self.assertEqual(first.headers["authorization"], second.headers["authorization"])
+
+
+if __name__ == "__main__":
+    BINARY = sys.argv[1]
+    unittest.main(argv=sys.argv[:1])
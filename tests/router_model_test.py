@@ -0,0 +1,88 @@
+"""The router over two OpenAI routes of a stand-in server: escalation, failover, and the usage and
+tokenizer of the routes it tried.
+
+Usage: router_model_test.py <path to haicl>
+"""
+
+import base64
+import os
+import sys
+import unittest
+
+from stand_in import Haicl, StandIn, openai_stream
+
+
+def openai_app(handler, request):
+    body = request.json()
+    model = body["model"]
+    prompt = body["messages"][-1]["content"]
+    if model == "gpt-4o-mini" and "FAIL" in prompt:
+        handler.send_json({"error": {"message": "overloaded"}}, 500)
+        return
+    text = "I don't know." if model == "gpt-4o-mini" and "HARD" in prompt else "Answer from " + model + "."
+    events = openai_stream(text, usage={"prompt_tokens": 10, "completion_tokens": 4})
+    if "NOUSAGE" in prompt:
+        events = [e for e in events if b'"usage"' not in e]
+    handler.send_chunks(events)
+
+
+class RouterModelTest(unittest.TestCase):
+    def setUp(self):
+        self.server = StandIn(openai_app).__enter__()
+        self.addCleanup(self.server.__exit__)
+
+    def haicl(self, **extra):
+        config = {
+            "default_ai_model": "router",
+            "openai": {"api_key": "test", "base_url": self.server.url + "/v1"},
+            "router": {"cascade": True, "routes": [{"target": "openai/gpt-4o-mini", "tier": "cheap"},
+                                                   {"target": "openai/gpt-4o", "tier": "capable"}]},
+            "response_cache": {"enabled": False},
+            "usage_ledger": {"enabled": False},
+        }
+        config.update(extra)
+        haicl = Haicl(BINARY, config)
+        self.addCleanup(haicl.__exit__)
+        return haicl
+
+    def ask(self, haicl, prompt):
+        result = haicl.run("-p", prompt, "--stats")
+        self.assertEqual(result.returncode, 0, result.stderr)
+        return result
+
+    def models(self):
+        return [r.json()["model"] for r in self.server.requests("/v1/chat/completions")]
+
+    def test_escalation_adds_up_usage(self):
+        result = self.ask(self.haicl(), "HARD question")
+        self.assertIn("Escalating from cheap to capable", result.stderr)
+        self.assertIn("Answer from gpt-4o.", result.stdout)
+        self.assertEqual(self.models(), ["gpt-4o-mini", "gpt-4o"])
+        # Both requests were paid for; the reply is named after the route that gave it.
+        self.assertIn("[usage] openai/gpt-4o: prompt 20 tokens", result.stdout)
+
+    def test_failover_reports_the_answering_route(self):
+        result = self.ask(self.haicl(), "FAIL on the cheap route")
+        self.assertIn("Route cheap failed; trying capable", result.stderr)
+        self.assertIn("Answer from gpt-4o.", result.stdout)
+        self.assertIn("[usage] openai/gpt-4o: prompt 10 tokens", result.stdout)
+
+    def test_routes_count_missing_usage_with_the_tokenizer(self):
+        haicl = self.haicl()
+        without = self.ask(haicl, "NOUSAGE simple")
+        self.assertIn("tokens not reported by provider", without.stdout)
+
+        # Every byte is a token of its own, so the reply counts one token per byte.
+        rank_file = os.path.join(haicl.home, "bytes.tiktoken")
+        with open(rank_file, "w") as f:
+            f.writelines("%s %d\n" % (base64.b64encode(bytes([b])).decode(), b) for b in range(256))
+        result = haicl.run("-p", "NOUSAGE simple", "--stats", "--tokenizer", rank_file)
+        self.assertEqual(result.returncode, 0, result.stderr)
+        self.assertIn("Answer from gpt-4o-mini.", result.stdout)
+        self.assertIn("completion %d tokens" % len("Answer from gpt-4o-mini."), result.stdout)
+        self.assertEqual(self.models(), ["gpt-4o-mini", "gpt-4o-mini"])
+
+
+if __name__ == "__main__":
+    BINARY = sys.argv[1]
+    unittest.main(argv=sys.argv[:1])
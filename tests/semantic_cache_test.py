@@ -0,0 +1,89 @@
+"""Semantic response cache against a stand-in OpenAI server: hit, miss and the similarity threshold.
+
+Usage: semantic_cache_test.py <path to haicl>
+"""
+
+import sys
+import unittest
+
+from stand_in import Haicl, StandIn, cosine, embedding, openai_completion, openai_embeddings, openai_stream
+
+
+def openai_app(handler, request):
+    body = request.json()
+    if request.path.endswith("/embeddings"):
+        handler.send_json(openai_embeddings(body))
+        return
+    text = "Answer to: " + body["messages"][-1]["content"]
+    if body.get("stream"):
+        handler.send_chunks(openai_stream(text))
+    else:
+        handler.send_json(openai_completion(text))
+
+
+class SemanticCacheTest(unittest.TestCase):
+    def setUp(self):
+        self.server = StandIn(openai_app).__enter__()
+        self.addCleanup(self.server.__exit__)
+
+    def haicl(self, min_similarity):
+        config = {
+            "default_ai_model": "openai",
+            "openai": {"api_key": "test", "base_url": self.server.url + "/v1", "model_name": "gpt-4o-mini"},
+            "response_cache": {"enabled": False},
+            "usage_ledger": {"enabled": False},
+            "semantic_cache": {"enabled": True, "min_similarity": min_similarity},
+        }
+        haicl = Haicl(BINARY, config)
+        self.addCleanup(haicl.__exit__)
+        return haicl
+
+    def ask(self, haicl, prompt):
+        result = haicl.run("-p", prompt)
+        self.assertEqual(result.returncode, 0, result.stderr)
+        return result
+
+    def chat_requests(self):
+        return len(self.server.requests("/v1/chat/completions"))
+
+    def test_hit_and_miss(self):
+        haicl = self.haicl(0.92)
+        first = self.ask(haicl, "What is the capital of France?")
+        self.assertIn("Answer to: What is the capital of France?", first.stdout)
+        self.assertEqual(self.chat_requests(), 1)
+
+        # Same words, different case and punctuation: identical embedding, answered from the cache.
+        hit = self.ask(haicl, "what is the capital of france")
+        self.assertIn("Answer to: What is the capital of France?", hit.stdout)
+        self.assertIn("Answered from the semantic cache", hit.stderr)
+        self.assertEqual(self.chat_requests(), 1)
+
+        miss = self.ask(haicl, "How do I bake sourdough bread?")
+        self.assertIn("Answer to: How do I bake sourdough bread?", miss.stdout)
+        self.assertNotIn("semantic cache", miss.stderr)
+        self.assertEqual(self.chat_requests(), 2)
+        self.assertGreaterEqual(len(self.server.requests("/v1/embeddings")), 3)
+
+    def test_similarity_threshold(self):
+        stored = "alpha beta gamma delta epsilon"
+        similar = "alpha beta gamma delta zeta"
+        similarity = cosine(embedding(stored), embedding(similar))
+        self.assertTrue(0.7 < similarity < 0.92, similarity)
+
+        strict = self.haicl(0.92)
+        self.ask(strict, stored)
+        below = self.ask(strict, similar)
+        self.assertIn("Answer to: " + similar, below.stdout)
+        self.assertEqual(self.chat_requests(), 2)
+
+        lenient = self.haicl(0.7)
+        self.ask(lenient, stored)
+        above = self.ask(lenient, similar)
+        self.assertIn("Answer to: " + stored, above.stdout)
+        self.assertIn("Answered from the semantic cache", above.stderr)
+        self.assertEqual(self.chat_requests(), 3)
+
+
+if __name__ == "__main__":
+    BINARY = sys.argv[1]
+    unittest.main(argv=sys.argv[:1])
@@ -0,0 +1,315 @@
+"""Stand-in servers and a haicl runner for the end-to-end tests.
+
+The stand-ins imitate just enough of the provider APIs (OpenAI chat completions and embeddings,
+Ollama, llama.cpp, and a WebSocket server for the Realtime API) to drive haicl through them on 127.0.0.1. Every request is recorded, so a test
+can check what haicl sent as well as what it printed. Only the Python standard library is used.
+"""
+
+import base64
+import hashlib
+import http.server
+import json
+import os
+import re
+import shutil
+import socket
+import socketserver
+import struct
+import subprocess
+import tempfile
+import threading
+import zlib
+
+EMBEDDING_DIMENSIONS = 64
+
+
+def embedding(text):
+    """Bag-of-words embedding: each lower-cased word adds 1 to a bucket picked by its CRC-32."""
+    vector = [0.0] * EMBEDDING_DIMENSIONS
+    for word in re.findall(r"[a-z0-9]+", text.lower()):
+        vector[zlib.crc32(word.encode()) % EMBEDDING_DIMENSIONS] += 1.0
+    return vector
+
+
+def cosine(a, b):
+    dot = sum(x * y for x, y in zip(a, b))
+    norm = (sum(x * x for x in a) * sum(y * y for y in b)) ** 0.5
+    return dot / norm if norm else 0.0
+
+
+def sse_event(payload):
+    return b"data: " + (payload if isinstance(payload, bytes) else json.dumps(payload).encode()) + b"\n\n"
+
+
+def openai_stream(text, piece_size=8, usage=None, done=True):
+    """Chat completions stream events for `text`, ending with a finish_reason, usage and [DONE]."""
+    events = [sse_event({"choices": [{"index": 0, "delta": {"content": text[i:i + piece_size]}}]})
+              for i in range(0, len(text), piece_size)]
+    if done:
+        events.append(sse_event({"choices": [{"index": 0, "delta": {}, "finish_reason": "stop"}]}))
+        events.append(sse_event({"choices": [], "usage": usage or {"prompt_tokens": 10, "completion_tokens": len(text.split())}}))
+        events.append(sse_event(b"[DONE]"))
+    return events
+
+
+def openai_completion(text, usage=None):
+    return {"id": "chatcmpl-stand-in", "object": "chat.completion",
+            "choices": [{"index": 0, "message": {"role": "assistant", "content": text}, "finish_reason": "stop"}],
+            "usage": usage or {"prompt_tokens": 10, "completion_tokens": len(text.split())}}
+
+
+def openai_embeddings(body):
+    inputs = body["input"] if isinstance(body["input"], list) else [body["input"]]
+    return {"object": "list", "model": body.get("model", ""),
+            "data": [{"object": "embedding", "index": i, "embedding": embedding(text)} for i, text in enumerate(inputs)]}
+
+
+class Request:
+    def __init__(self, method, path, headers, body):
+        self.method = method
+        self.path = path
+        self.headers = headers
+        self.body = body
+
+    def json(self):
+        return json.loads(self.body) if self.body else None
+
+
+class _Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def log_message(self, *args):
+        pass
+
+    def do_GET(self):
+        self._dispatch()
+
+    def do_POST(self):
+        self._dispatch()
+
+    def do_DELETE(self):
+        self._dispatch()
+
+    def _dispatch(self):
+        length = int(self.headers.get("Content-Length", 0))
+        request = Request(self.command, self.path, dict(self.headers), self.rfile.read(length).decode() if length else "")
+        with self.server.lock:
+            self.server.requests.append(request)
+        self.server.app(self, request)
+
+    def send_json(self, payload, status=200):
+        data = json.dumps(payload).encode()
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        self.end_headers()
+        self.wfile.write(data)
+
+    def send_chunks(self, chunks, content_type="text/event-stream", drop_after=None):
+        """Streams `chunks` with chunked encoding; drops the connection after `drop_after` of them."""
+        self.send_response(200)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Transfer-Encoding", "chunked")
+        self.end_headers()
+        try:
+            for i, chunk in enumerate(chunks):
+                if drop_after is not None and i == drop_after:
+                    self.drop()
+                    return
+                self.wfile.write(b"%x\r\n%s\r\n" % (len(chunk), chunk))
+                self.wfile.flush()
+            self.wfile.write(b"0\r\n\r\n")
+        except (BrokenPipeError, ConnectionResetError):
+            self.close_connection = True
+
+    def drop(self):
+        """Cuts the connection mid-response, like a proxy timing out."""
+        self.wfile.flush()
+        self.connection.shutdown(socket.SHUT_RDWR)
+        self.close_connection = True
+
+
+class _Server(socketserver.ThreadingMixIn, http.server.HTTPServer):
+    daemon_threads = True
+
+
+class StandIn:
+    """HTTP server on an ephemeral port; `app(handler, request)` writes each reply."""
+
+    def __init__(self, app):
+        self._server = _Server(("127.0.0.1", 0), _Handler)
+        self._server.app = app
+        self._server.requests = []
+        self._server.lock = threading.Lock()
+        self._thread = threading.Thread(target=self._server.serve_forever, daemon=True)
+
+    def __enter__(self):
+        self._thread.start()
+        return self
+
+    def __exit__(self, *exc):
+        self._server.shutdown()
+        self._server.server_close()
+
+    @property
+    def url(self):
+        return "http://127.0.0.1:%d" % self._server.server_address[1]
+
+    def requests(self, path_prefix=""):
+        with self._server.lock:
+            return [r for r in self._server.requests if r.path.startswith(path_prefix)]
+
+
+WEBSOCKET_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC11D65"
+OP_CONTINUATION, OP_TEXT, OP_CLOSE, OP_PING, OP_PONG = 0x0, 0x1, 0x8, 0x9, 0xA
+
+
+class WebSocketConnection:
+    """One accepted WebSocket connection: the opening request, what the client sent, and frame writers."""
+
+    def __init__(self, sock, request_line, headers):
+        self.sock = sock
+        self.request_line = request_line
+        self.headers = headers
+        self.messages = []        # Text messages, reassembled
+        self.pongs = []           # Payloads of the client's pongs
+        self.unmasked_frames = 0  # Client frames must always be masked
+        self.closed = threading.Event()
+        self._lock = threading.Lock()
+
+    def send_frame(self, opcode, payload, fin=True):
+        header = bytes([(0x80 if fin else 0) | opcode])
+        if len(payload) < 126:
+            header += bytes([len(payload)])
+        elif len(payload) < 65536:
+            header += bytes([126]) + struct.pack(">H", len(payload))
+        else:
+            header += bytes([127]) + struct.pack(">Q", len(payload))
+        with self._lock:
+            self.sock.sendall(header + payload)
+
+    def send_json(self, payload):
+        self.send_frame(OP_TEXT, json.dumps(payload).encode())
+
+    def drop(self):
+        """Cuts the connection without a close frame, like a proxy timing out."""
+        self.sock.shutdown(socket.SHUT_RDWR)
+
+
+class _WebSocketHandler(socketserver.StreamRequestHandler):
+    def handle(self):
+        request_line = self.rfile.readline().decode().rstrip("\r\n")
+        headers = {}
+        for line in iter(self.rfile.readline, b"\r\n"):
+            if not line:
+                return
+            name, _, value = line.decode().partition(":")
+            headers[name.strip().lower()] = value.strip()
+        self.request.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        connection = WebSocketConnection(self.request, request_line, headers)
+        with self.server.lock:
+            self.server.connections.append(connection)
+        accept = self.server.accept_key or base64.b64encode(hashlib.sha1((headers.get("sec-websocket-key", "") + WEBSOCKET_GUID).encode()).digest()).decode()
+        self.request.sendall(("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                              "Sec-WebSocket-Accept: %s\r\n\r\n" % accept).encode())
+        try:
+            if self.server.on_open:
+                self.server.on_open(connection)
+            self._read_frames(connection)
+        except (EOFError, OSError):
+            pass
+        finally:
+            connection.closed.set()
+
+    def _read_exact(self, size):
+        data = self.rfile.read(size)
+        if len(data) < size:
+            raise EOFError
+        return data
+
+    def _read_frames(self, connection):
+        message = b""
+        while True:
+            b0, b1 = self._read_exact(2)
+            size = b1 & 0x7F
+            if size == 126:
+                size = struct.unpack(">H", self._read_exact(2))[0]
+            elif size == 127:
+                size = struct.unpack(">Q", self._read_exact(8))[0]
+            key = self._read_exact(4) if b1 & 0x80 else b"\0\0\0\0"
+            if not b1 & 0x80:
+                connection.unmasked_frames += 1
+            payload = bytes(c ^ key[i % 4] for i, c in enumerate(self._read_exact(size)))
+            opcode = b0 & 0x0F
+            if opcode == OP_CLOSE:
+                connection.send_frame(OP_CLOSE, payload[:2])
+                return
+            if opcode == OP_PING:
+                connection.send_frame(OP_PONG, payload)
+            elif opcode == OP_PONG:
+                connection.pongs.append(payload)
+            else:
+                message += payload
+                if b0 & 0x80:
+                    connection.messages.append(message.decode())
+                    self.server.app(connection, message.decode())
+                    message = b""
+
+
+class _WebSocketServer(socketserver.ThreadingMixIn, socketserver.TCPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+
+class WebSocketStandIn:
+    """WebSocket server on an ephemeral port. `on_open(connection)` runs after each handshake and
+    `app(connection, message)` for each text message. `accept_key` replaces the correct
+    Sec-WebSocket-Accept, to test that the client checks it."""
+
+    def __init__(self, app, on_open=None, accept_key=None):
+        self._server = _WebSocketServer(("127.0.0.1", 0), _WebSocketHandler)
+        self._server.app = app
+        self._server.on_open = on_open
+        self._server.accept_key = accept_key
+        self._server.connections = []
+        self._server.lock = threading.Lock()
+        self._thread = threading.Thread(target=self._server.serve_forever, daemon=True)
+
+    def __enter__(self):
+        self._thread.start()
+        return self
+
+    def __exit__(self, *exc):
+        self._server.shutdown()
+        self._server.server_close()
+
+    @property
+    def url(self):
+        return "ws://127.0.0.1:%d" % self._server.server_address[1]
+
+    def connections(self):
+        with self._server.lock:
+            return list(self._server.connections)
+
+
+class Haicl:
+    """Runs the haicl binary with a private HOME holding `config` (and the caches, history, ledger)."""
+
+    def __init__(self, binary, config):
+        self.binary = binary
+        self.home = tempfile.mkdtemp(prefix="haicl-test-")
+        config_dir = os.path.join(self.home, ".config", "haicl")
+        os.makedirs(config_dir)
+        with open(os.path.join(config_dir, "config.json"), "w") as f:
+            json.dump(config, f)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        shutil.rmtree(self.home, ignore_errors=True)
+
+    def run(self, *args, stdin=None, timeout=60):
+        env = {k: v for k, v in os.environ.items() if not k.endswith("_API_KEY") and k != "XDG_CACHE_HOME"}
+        env["HOME"] = self.home
+        return subprocess.run([self.binary] + list(args), input=stdin, capture_output=True, text=True, env=env, timeout=timeout)
@@ -0,0 +1,58 @@
+"""Token counts of the BPE tokenizer under the cl100k and o200k pre-tokenization patterns.
+
+Usage: tokenizer_test.py <path to haicl>
+"""
+
+import base64
+import json
+import os
+import sys
+import unittest
+
+from stand_in import Haicl
+
+# Every byte is a token, plus whole words that are only found if pre-tokenization keeps them together.
+WORDS = [b"HelloWorld", b"Hello", b"World", b"don't"]
+
+
+def write_rank_file(path, padding=0):
+    tokens = [bytes([b]) for b in range(256)] + WORDS
+    # Filler tokens starting with a byte that never occurs in UTF-8, to reach a given vocabulary size.
+    tokens += [b"\xf8" + i.to_bytes(3, "big") for i in range(padding)]
+    with open(path, "w") as f:
+        f.writelines("%s %d\n" % (base64.b64encode(token).decode(), rank) for rank, token in enumerate(tokens))
+
+
+class TokenizerTest(unittest.TestCase):
+    def haicl(self, padding=0, **tokenizer):
+        haicl = Haicl(BINARY, {})  # The config is written once the rank file's path is known
+        self.addCleanup(haicl.__exit__)
+        tokenizer["rank_file"] = os.path.join(haicl.home, "test.tiktoken")
+        write_rank_file(tokenizer["rank_file"], padding)
+        with open(os.path.join(haicl.home, ".config", "haicl", "config.json"), "w") as f:
+            json.dump({"tokenizer": tokenizer}, f)
+        return haicl
+
+    def count(self, haicl, text):
+        result = haicl.run("--count-tokens", "-p", text)
+        self.assertEqual(result.returncode, 0, result.stderr)
+        return int(result.stdout.split()[0])
+
+    def test_cl100k_keeps_words_and_splits_contractions(self):
+        haicl = self.haicl(pattern="cl100k")
+        self.assertEqual(self.count(haicl, "HelloWorld"), 1)
+        self.assertEqual(self.count(haicl, "don't"), len("don") + len("'t"))
+
+    def test_o200k_splits_at_case_changes_and_keeps_contractions(self):
+        haicl = self.haicl(pattern="o200k")
+        self.assertEqual(self.count(haicl, "HelloWorld"), 2)
+        self.assertEqual(self.count(haicl, "don't"), 1)
+
+    def test_pattern_follows_the_vocabulary_size(self):
+        self.assertEqual(self.count(self.haicl(), "HelloWorld"), 1)
+        self.assertEqual(self.count(self.haicl(padding=200000), "HelloWorld"), 2)
+
+
+if __name__ == "__main__":
+    BINARY = sys.argv[1]
+    unittest.main(argv=sys.argv[:1])